@@ -0,0 +1,179 @@
+/* OpenGarage Firmware
+ *
+ * Delta firmware update
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <Updater.h>
+#include "Delta.h"
+
+#define OP_COPY   0
+#define OP_ADD    1
+#define OP_INSERT 2
+#define OP_SEEK   3
+#define OP_NONE   0xFF
+
+static uint32_t get_u32(const uint8_t *p) {
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+bool DeltaPatcher::is_patch(const uint8_t *data, size_t len) {
+	return len >= 4 && data[0] == 'O' && data[1] == 'G' && data[2] == 'D' && data[3] == '1';
+}
+
+DeltaPatcher::DeltaPatcher()
+	: header_len(0), err(OK), old_size(0), new_size(0), old_pos(0), out_bytes(0), op_value(0), op_shift(0),
+	  op(OP_NONE), op_left(0), cache_addr(0xFFFFFFFF), out_len(0) {
+}
+
+// reads the old image through a cache of one aligned block
+bool DeltaPatcher::read_old(uint32_t addr, uint8_t *to, size_t len) {
+	while(len) {
+		uint32_t block = addr & ~(uint32_t)(sizeof(cache)-1);
+		if(block != cache_addr) {
+			if(!ESP.flashRead(block, cache, sizeof(cache))) return fail(FLASH_FAILED);
+			if(block == 0) cache[2] = cache[3] = 0;  // flash mode and size
+			cache_addr = block;
+		}
+		size_t n = block + sizeof(cache) - addr;
+		if(n > len) n = len;
+		memcpy(to, cache + (addr - block), n);
+		to += n;
+		addr += n;
+		len -= n;
+	}
+	return true;
+}
+
+// checks the header and that the running firmware is the one the patch is for
+bool DeltaPatcher::start() {
+	if(!is_patch(header, header_len)) return fail(CORRUPT);
+	old_size = get_u32(header+4);
+	new_size = get_u32(header+40);
+	uint32_t sketch = (ESP.getSketchSize() + 0xFFF) & ~0xFFFu;
+	if(!old_size || old_size > sketch) return fail(WRONG_BASE);
+	if(!new_size || new_size > Update.size()) return fail(FLASH_FAILED);  // does not fit
+	uint8_t buf[64];
+	br_sha256_init(&sha);
+	for(uint32_t addr=0;addr<old_size;addr+=sizeof(buf)) {
+		size_t n = old_size - addr < sizeof(buf) ? old_size - addr : sizeof(buf);
+		if(!read_old(addr, buf, n)) return false;
+		br_sha256_update(&sha, buf, n);
+		if(!(addr & 0x3FFF)) yield();
+	}
+	uint8_t digest[br_sha256_SIZE];
+	br_sha256_out(&sha, digest);
+	if(memcmp(digest, header+8, br_sha256_SIZE)) return fail(WRONG_BASE);
+	br_sha256_init(&sha);
+	return true;
+}
+
+bool DeltaPatcher::flush() {
+	if(!out_len) return true;
+	br_sha256_update(&sha, out, out_len);
+	if(Update.write(out, out_len) != out_len) return fail(FLASH_FAILED);
+	out_len = 0;
+	return true;
+}
+
+// appends to the new image, and verifies it once complete
+bool DeltaPatcher::put(const uint8_t *data, size_t len) {
+	while(len) {
+		size_t n = sizeof(out) - out_len;
+		if(n > len) n = len;
+		memcpy(out + out_len, data, n);
+		out_len += n;
+		out_bytes += n;
+		data += n;
+		len -= n;
+		if(out_len == sizeof(out) && !flush()) return false;
+	}
+	if(out_bytes == new_size) {
+		if(!flush()) return false;
+		uint8_t digest[br_sha256_SIZE];
+		br_sha256_out(&sha, digest);
+		if(memcmp(digest, header+44, br_sha256_SIZE)) return fail(BAD_IMAGE);
+	}
+	return true;
+}
+
+// n old bytes, with add (if not NULL) added to them
+bool DeltaPatcher::copy(uint32_t n, const uint8_t *add) {
+	uint8_t buf[64];
+	while(n) {
+		size_t k = n < sizeof(buf) ? n : sizeof(buf);
+		if(!read_old(old_pos, buf, k)) return false;
+		if(add) {
+			for(size_t i=0;i<k;i++) buf[i] += add[i];
+			add += k;
+		}
+		if(!put(buf, k)) return false;
+		old_pos += k;
+		n -= k;
+	}
+	return true;
+}
+
+bool DeltaPatcher::write(const uint8_t *data, size_t len) {
+	if(err) return false;
+	while(len) {
+		if(header_len < DELTA_HEADER_SIZE) {
+			size_t n = DELTA_HEADER_SIZE - header_len;
+			if(n > len) n = len;
+			memcpy(header + header_len, data, n);
+			header_len += n;
+			data += n;
+			len -= n;
+			if(header_len == DELTA_HEADER_SIZE && !start()) return false;
+		} else if(op == OP_NONE) {
+			if(out_bytes == new_size) return fail(CORRUPT);  // data after the image
+			uint8_t c = *data++;
+			len--;
+			if(op_shift >= 28 && (c & 0xF0)) return fail(CORRUPT);
+			op_value |= (uint32_t)(c & 0x7F) << op_shift;
+			op_shift += 7;
+			if(c & 0x80) continue;
+			uint32_t n = op_value >> 2;
+			byte code = op_value & 3;
+			op_value = 0;
+			op_shift = 0;
+			if(code == OP_SEEK) {
+				int32_t d = (n & 1) ? -(int32_t)((n >> 1) + 1) : (int32_t)(n >> 1);
+				if((d < 0 && (uint32_t)-d > old_pos) || (d > 0 && old_pos + d > old_size)) return fail(CORRUPT);
+				old_pos += d;
+				continue;
+			}
+			if(n > new_size - out_bytes || (code != OP_INSERT && n > old_size - old_pos)) return fail(CORRUPT);
+			if(code == OP_COPY) {
+				if(!copy(n, NULL)) return false;
+			} else if(n) {
+				op = code;
+				op_left = n;
+			}
+		} else {
+			size_t n = op_left < len ? op_left : len;
+			if(!(op == OP_ADD ? copy(n, data) : put(data, n))) return false;
+			data += n;
+			len -= n;
+			op_left -= n;
+			if(!op_left) op = OP_NONE;
+		}
+	}
+	return true;
+}
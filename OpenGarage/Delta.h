@@ -0,0 +1,89 @@
+/* OpenGarage Firmware
+ *
+ * Delta firmware update header file
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _DELTA_H
+#define _DELTA_H
+
+#include <Arduino.h>
+#include <bearssl/bearssl_hash.h>
+
+/* A patch, made by ota_delta.mjs, turns the running firmware into a new
+ * image. All numbers are little-endian:
+ *
+ *   "OGD1", old size (4), SHA-256 of the old image (32),
+ *   new size (4), SHA-256 of the new image (32), then ops
+ *
+ * Each op starts with a LEB128 varint n*4+op:
+ *   0 copy    n bytes from the old image
+ *   1 add     n bytes follow, each added to the next old byte
+ *   2 insert  n bytes follow, taken as they are
+ *   3 seek    moves in the old image by n/2 (n odd: -(n+1)/2)
+ *
+ * Bytes 2 and 3 of the old image (flash mode and size, which flashing
+ * rewrites) are taken as 0. */
+#define DELTA_HEADER_SIZE 76
+
+/** Rebuilds the new image into the updater while the patch streams in.
+ *  The old image is read from flash. Its hash is checked before anything
+ *  is written, the hash of the new image once it is complete; a patch
+ *  that does not verify never gets past Update.end(). */
+class DeltaPatcher {
+public:
+	enum Error : byte { OK, WRONG_BASE, CORRUPT, FLASH_FAILED, BAD_IMAGE };
+
+	static bool is_patch(const uint8_t *data, size_t len);
+
+	DeltaPatcher();
+	// false on the first error, and for all data after it
+	bool write(const uint8_t *data, size_t len);
+	// the whole new image is written and verified
+	bool done() const { return !err && header_len == DELTA_HEADER_SIZE && out_bytes == new_size; }
+	Error error() const { return err; }
+	uint32_t image_size() const { return new_size; }
+
+private:
+	bool start();
+	bool read_old(uint32_t addr, uint8_t *to, size_t len);
+	bool copy(uint32_t n, const uint8_t *add);
+	bool put(const uint8_t *data, size_t len);
+	bool flush();
+	bool fail(Error e) { err = e; return false; }
+
+	uint8_t header[DELTA_HEADER_SIZE];
+	uint8_t header_len;
+	Error err;
+	uint32_t old_size;
+	uint32_t new_size;
+	uint32_t old_pos;     // next byte of the old image
+	uint32_t out_bytes;   // of the new image, so far
+	uint32_t op_value;    // varint being read
+	byte op_shift;
+	byte op;              // add or insert with data still to come, else 0xFF
+	uint32_t op_left;
+	uint8_t cache[256];   // old image bytes at cache_addr
+	uint32_t cache_addr;
+	uint8_t out[256];     // new image bytes not yet written
+	uint16_t out_len;
+	br_sha256_context sha;
+};
+
+#endif  // _DELTA_H
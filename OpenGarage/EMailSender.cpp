@@ -167,30 +167,25 @@ void EMailSender::setSMTPPort(uint16_t smtp_port){
 	this->smtp_port = smtp_port;
 };
 void EMailSender::setSMTPServer(const char* smtp_server){
-	delete [] this->smtp_server;
-	this->smtp_server = new char[strlen(smtp_server)+1];
-	strcpy(this->smtp_server, smtp_server);
+	free(this->smtp_server); // allocated with strdup(), like the default server
+	this->smtp_server = strdup(smtp_server);
 };
 
 void EMailSender::setEMailLogin(const char* email_login){
-	delete [] this->email_login;
-	this->email_login = new char[strlen(email_login)+1];
-	strcpy(this->email_login, email_login);
+	free(this->email_login);
+	this->email_login = strdup(email_login);
 };
 void EMailSender::setEMailFrom(const char* email_from){
-	delete [] this->email_from;
-	this->email_from = new char[strlen(email_from)+1];
-	strcpy(this->email_from, email_from);
+	free(this->email_from);
+	this->email_from = strdup(email_from);
 };
 void EMailSender::setNameFrom(const char* name_from){
-	delete [] this->name_from;
-	this->name_from = new char[strlen(name_from)+1];
-	strcpy(this->name_from, name_from);
+	free(this->name_from);
+	this->name_from = strdup(name_from);
 };
 void EMailSender::setEMailPassword(const char* email_password){
-	delete [] this->email_password;
-	this->email_password = new char[strlen(email_password)+1];
-	strcpy(this->email_password, email_password);
+	free(this->email_password);
+	this->email_password = strdup(email_password);
 };
 
 void EMailSender::setIsSecure(bool isSecure) {
@@ -1113,3 +1108,201 @@ EMailSender::Response EMailSender::send(const char* to[], byte sizeOfTo,  byte s
   return response;
 }
 
+
+#ifndef SSLCLIENT_WRAPPER
+// reply expected by each SMTPStep, and the error reported when it does not come
+static const char* const smtpExpect[] = {"", "220", "250", "334", "334", "235", "250", "25", "354", "250", "221"};
+static const char* const smtpError[] = {"", "Connection Error", "Identification error", "SMTP AUTH error",
+		"SMTP AUTH error", "SMTP AUTH error", "MAIL FROM error", "RCPT TO error", "SMTP DATA error",
+		"Sending message error", "SMTP QUIT error"};
+
+bool EMailSender::beginSend(const char* to, EMailMessage &email) {
+	abortSend();
+	sendTo = to;
+	sendEmail = email;
+	sendResponse = Response();
+	sendStep = SMTP_CONNECT;
+	sendStatus = SEND_BUSY;
+	return true;
+}
+
+void EMailSender::abortSend() {
+	if (sendClient) {
+		sendClient->stop();
+		delete sendClient;
+		sendClient = 0;
+	}
+	if (sendStatus == SEND_BUSY) sendStatus = SEND_IDLE;
+}
+
+void EMailSender::finishSend(bool ok, const String &code, const String &desc) {
+	EMAIL_DEBUG_PRINTLN(desc);
+	sendResponse.status = ok;
+	sendResponse.code = code;
+	sendResponse.desc = desc;
+	sendClient->flush();
+	sendClient->stop();
+	delete sendClient;
+	sendClient = 0;
+	sendStatus = ok ? SEND_DONE : SEND_FAILED;
+}
+
+void EMailSender::nextSMTPStep(SMTPStep step) {
+	sendStep = step;
+	sendStepStart = millis();
+	_serverResponce = "";
+}
+
+// collects whatever the server has sent so far; true once the last line of
+// a reply is in _serverResponce (lines of a multi-line reply read "250-...")
+bool EMailSender::readSMTPReply() {
+	while (sendClient->available()) {
+		char c = sendClient->read();
+		if (c == '\r') continue;
+		if (c != '\n') {
+			_serverResponce += c;
+			continue;
+		}
+		EMAIL_DEBUG_PRINTLN(_serverResponce);
+		if (_serverResponce.length() > 3 && _serverResponce[3] == '-') {
+			_serverResponce = "";
+			continue;
+		}
+		return true;
+	}
+	return false;
+}
+
+EMailSender::SendStatus EMailSender::poll() {
+	if (sendStatus != SEND_BUSY) return sendStatus;
+
+	if (sendStep == SMTP_CONNECT) {
+		sendClient = new EMAIL_NETWORK_CLASS();
+#if !defined(FORCE_DISABLE_SSL) && (EMAIL_NETWORK_TYPE == NETWORK_ESP8266 || EMAIL_NETWORK_TYPE == NETWORK_ESP8266_242) && !defined(ARDUINO_ESP8266_RELEASE_2_4_2)
+		if (this->isSecure == false){
+			sendClient->setInsecure();
+			if (sendClient->probeMaxFragmentLength(this->smtp_server, this->smtp_port, 512)) {
+				sendClient->setBufferSizes(512, 512);
+			} else {
+				sendClient->setBufferSizes(2048, 2048);
+			}
+		}
+#endif
+		if (!sendClient->connect(this->smtp_server, this->smtp_port)) {
+			finishSend(false, F("2"), F("Could not connect to mail server"));
+			return sendStatus;
+		}
+		EMAIL_DEBUG_PRINTLN("Connected");
+		nextSMTPStep(SMTP_GREETING);
+		return sendStatus;
+	}
+
+	if (!readSMTPReply()) {
+		if (millis() - sendStepStart > 10000) {
+			finishSend(false, F("1"), String(smtpError[sendStep]) + "! " + F("SMTP Response TIMEOUT!"));
+		} else if (!sendClient->connected()) {
+			finishSend(false, F("1"), String(smtpError[sendStep]) + "! " + F("Connection closed"));
+		}
+		return sendStatus;
+	}
+	if (!_serverResponce.startsWith(smtpExpect[sendStep])) {
+		finishSend(false, smtpExpect[sendStep], String(smtpError[sendStep]) + " (" + _serverResponce + ")");
+		return sendStatus;
+	}
+
+	switch (sendStep) {
+	case SMTP_GREETING:
+		sendClient->print(this->useEHLO ? F("EHLO ") : F("HELO "));
+		sendClient->println(publicIPDescriptor);
+		nextSMTPStep(SMTP_HELO);
+		break;
+	case SMTP_HELO:
+		if (useAuth && this->isSASLLogin) {
+			int size = 1 + strlen(this->email_login) + strlen(this->email_password) + 2;
+			char *logPass = (char *) malloc(size);
+			int n = 0;
+			logPass[n++] = ' ';
+			logPass[n++] = 0;
+			for (unsigned int i = 0; i < strlen(this->email_login); i++) logPass[n++] = this->email_login[i];
+			logPass[n++] = 0;
+			for (unsigned int i = 0; i < strlen(this->email_password); i++) logPass[n++] = this->email_password[i];
+			sendClient->print(F("AUTH PLAIN "));
+			sendClient->println(encode64_f(logPass, size));
+			free(logPass);
+			nextSMTPStep(SMTP_AUTH_PASS);
+			break;
+		}
+		if (useAuth) {
+			sendClient->println(F("AUTH LOGIN"));
+			nextSMTPStep(SMTP_AUTH);
+			break;
+		}
+		// no authentication: go on with MAIL FROM
+		[[fallthrough]];
+	case SMTP_AUTH_PASS:
+		sendClient->print(F("MAIL FROM: <"));
+		sendClient->print(this->email_from);
+		sendClient->println(F(">"));
+		nextSMTPStep(SMTP_MAIL_FROM);
+		break;
+	case SMTP_AUTH:
+		sendClient->println(encode64(this->email_login));
+		nextSMTPStep(SMTP_AUTH_USER);
+		break;
+	case SMTP_AUTH_USER:
+		sendClient->println(encode64(this->email_password));
+		nextSMTPStep(SMTP_AUTH_PASS);
+		break;
+	case SMTP_MAIL_FROM:
+		sendClient->print(F("RCPT TO: <"));
+		sendClient->print(sendTo);
+		sendClient->println(F(">"));
+		nextSMTPStep(SMTP_RCPT_TO);
+		break;
+	case SMTP_RCPT_TO:
+		sendClient->println(F("DATA"));
+		nextSMTPStep(SMTP_DATA);
+		break;
+	case SMTP_DATA:
+		sendClient->print(F("From: "));
+		if (this->name_from) sendClient->print(this->name_from);
+		sendClient->print(F(" <"));
+		sendClient->print(this->email_from);
+		sendClient->println(F(">"));
+		sendClient->print(F("To: <"));
+		sendClient->print(sendTo);
+		sendClient->println(F(">"));
+		sendClient->print(F("Subject: "));
+		sendClient->println(sendEmail.subject);
+		sendClient->println(F("MIME-Version: 1.0"));
+		sendClient->println(F("Content-Type: Multipart/mixed; boundary=frontier"));
+		sendClient->println(F("--frontier"));
+		sendClient->print(F("Content-Type: "));
+		sendClient->print(sendEmail.mime);
+		sendClient->println(F("; charset=\"UTF-8\""));
+		sendClient->println(F("Content-Transfer-Encoding: 7bit"));
+		sendClient->println();
+		if (sendEmail.mime == F("text/html")) {
+			sendClient->print(F("<!DOCTYPE html><html lang=\"en\">"));
+			sendClient->print(sendEmail.message);
+			sendClient->println(F("</html>"));
+		} else {
+			sendClient->println(sendEmail.message);
+		}
+		sendClient->println();
+		sendClient->println(F("."));
+		nextSMTPStep(SMTP_MESSAGE);
+		break;
+	case SMTP_MESSAGE:
+		sendClient->println(F("QUIT"));
+		nextSMTPStep(SMTP_QUIT);
+		break;
+	case SMTP_QUIT:
+		finishSend(true, F("0"), F("Message sent!"));
+		break;
+	default:
+		break;
+	}
+	return sendStatus;
+}
+#endif
@@ -460,6 +460,32 @@ public:
 	EMailSender::Response send(String to[], byte sizeOfTo,  byte sizeOfCc, EMailMessage &email, Attachments att = {0, 0});
 	EMailSender::Response send(String to[], byte sizeOfTo,  byte sizeOfCc, byte sizeOfCCn, EMailMessage &email, Attachments att = {0, 0});
 
+	/** Non-blocking sending, for callers that cannot stall their loop for a
+	 *  whole SMTP session: beginSend() copies the message and returns at
+	 *  once, then every poll() moves the dialogue at most one command
+	 *  forward. Only the server reply is waited for across calls; the
+	 *  TCP/TLS connect in the first poll() still blocks. One recipient,
+	 *  no attachments. */
+	enum SendStatus {
+		SEND_IDLE,
+		SEND_BUSY,
+		SEND_DONE,
+		SEND_FAILED
+	};
+
+#ifndef SSLCLIENT_WRAPPER
+	bool beginSend(const char* to, EMailMessage &email);
+	SendStatus poll();
+	void abortSend();
+#endif
+	SendStatus status() const {
+		return sendStatus;
+	}
+	// outcome of the last beginSend(), valid once status() is DONE or FAILED
+	const EMailSender::Response &result() const {
+		return sendResponse;
+	}
+
 	void setIsSecure(bool isSecure = false);
 
 	void setUseAuth(bool useAuth = true) {
@@ -520,6 +546,35 @@ private:
 #else
     Response awaitSMTPResponse(EMAIL_NETWORK_CLASS &client, const char* resp = "", const char* respDesc = "", uint16_t timeOut = 10000);
 #endif
+
+	// SMTP steps of the non-blocking sender, each named after the reply it waits for
+	enum SMTPStep {
+		SMTP_CONNECT,
+		SMTP_GREETING,
+		SMTP_HELO,
+		SMTP_AUTH,
+		SMTP_AUTH_USER,
+		SMTP_AUTH_PASS,
+		SMTP_MAIL_FROM,
+		SMTP_RCPT_TO,
+		SMTP_DATA,
+		SMTP_MESSAGE,
+		SMTP_QUIT
+	};
+
+	SendStatus sendStatus = SEND_IDLE;
+	Response sendResponse;
+#ifndef SSLCLIENT_WRAPPER
+	EMAIL_NETWORK_CLASS *sendClient = 0;
+	SMTPStep sendStep = SMTP_CONNECT;
+	uint32_t sendStepStart = 0;
+	String sendTo;
+	EMailMessage sendEmail;
+
+	bool readSMTPReply();
+	void nextSMTPStep(SMTPStep step);
+	void finishSend(bool ok, const String &code, const String &desc);
+#endif
 };
 
 #endif
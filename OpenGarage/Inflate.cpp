@@ -0,0 +1,239 @@
+/* OpenGarage Firmware
+ *
+ * Gzip decompressor
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "Inflate.h"
+
+// DEFLATE (RFC 1951) with canonical Huffman decoding, one bit at a time
+
+struct Inflater::Tree {
+	uint16_t counts[16];    // number of codes of each length
+	uint16_t symbols[288];  // symbols ordered by code
+};
+
+struct Inflater::State {
+	Tree lt, dt;            // literal/length and distance trees of the current block
+	uint8_t lengths[288+32];
+	uint8_t window[1];      // wsize bytes
+};
+
+static const uint8_t length_bits[29] PROGMEM = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t length_base[29] PROGMEM = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t dist_bits[30] PROGMEM = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint16_t dist_base[30] PROGMEM = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+	1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+// order of the code length code lengths
+static const uint8_t clc_order[19] PROGMEM = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static void build_tree(uint16_t *counts, uint16_t *symbols, const uint8_t *lengths, uint num) {
+	uint16_t offs[16];
+	memset(counts, 0, 16*sizeof(uint16_t));
+	for(uint i=0;i<num;i++) counts[lengths[i]]++;
+	counts[0] = 0;
+	for(uint i=0, sum=0;i<16;i++) {
+		offs[i] = sum;
+		sum += counts[i];
+	}
+	for(uint i=0;i<num;i++) {
+		if(lengths[i]) symbols[offs[lengths[i]]++] = i;
+	}
+}
+
+Inflater::Inflater(byte window_bits)
+	: wsize((size_t)1 << window_bits), src(NULL), end(NULL), out(NULL), wpos(0), total(0), tag(0), bitcount(0), error(false) {
+	state = (State*)malloc(sizeof(State) + wsize);
+}
+
+Inflater::~Inflater() {
+	free(state);
+}
+
+size_t Inflater::size_P(const uint8_t *src, size_t len) {
+	if(len < 18) return 0;
+	uint32_t size;
+	memcpy_P(&size, src+len-4, 4);  // little-endian, like the controller
+	return size;
+}
+
+int Inflater::getbit() {
+	if(!bitcount) {
+		if(src >= end) {
+			error = true;
+			return 0;
+		}
+		tag = pgm_read_byte(src++);
+		bitcount = 8;
+	}
+	int bit = tag & 1;
+	tag >>= 1;
+	bitcount--;
+	return bit;
+}
+
+uint Inflater::getbits(byte n, uint base) {
+	uint v = 0;
+	for(byte i=0;i<n;i++) v |= (uint)getbit() << i;
+	return v + base;
+}
+
+int Inflater::decode(const Tree &t) {
+	int sum = 0, cur = 0;
+	for(byte len=1;len<16;len++) {
+		cur = 2*cur + getbit();
+		sum += t.counts[len];
+		cur -= t.counts[len];
+		if(cur < 0) return t.symbols[sum + cur];
+	}
+	error = true;
+	return -1;
+}
+
+// writes to the window, which goes out whenever it is full
+void Inflater::put(uint8_t c) {
+	state->window[wpos++] = c;
+	total++;
+	if(wpos == wsize) {
+		out->write(state->window, wsize);
+		wpos = 0;
+	}
+}
+
+bool Inflater::build_dynamic_trees() {
+	uint hlit = getbits(5, 257);
+	uint hdist = getbits(5, 1);
+	uint hclen = getbits(4, 4);
+	if(hlit > 286 || hdist > 30) return false;
+	uint8_t *lengths = state->lengths;
+	Tree &ct = state->dt;  // the code length tree is only needed until dt is built
+	memset(lengths, 0, 19);
+	for(uint i=0;i<hclen;i++) lengths[pgm_read_byte(&clc_order[i])] = getbits(3, 0);
+	build_tree(ct.counts, ct.symbols, lengths, 19);
+	for(uint n=0;n<hlit+hdist;) {
+		int sym = decode(ct);
+		if(error) return false;
+		uint8_t fill = 0;
+		uint count;
+		if(sym < 16) {
+			lengths[n++] = sym;
+			continue;
+		} else if(sym == 16) {
+			if(!n) return false;
+			fill = lengths[n-1];
+			count = getbits(2, 3);
+		} else if(sym == 17) {
+			count = getbits(3, 3);
+		} else {
+			count = getbits(7, 11);
+		}
+		if(n + count > hlit + hdist) return false;
+		while(count--) lengths[n++] = fill;
+	}
+	if(!lengths[256]) return false;  // no end of block code
+	build_tree(state->lt.counts, state->lt.symbols, lengths, hlit);
+	build_tree(state->dt.counts, state->dt.symbols, lengths+hlit, hdist);
+	return !error;
+}
+
+bool Inflater::inflate_block(const Tree &lt, const Tree &dt) {
+	for(;;) {
+		int sym = decode(lt);
+		if(error) return false;
+		if(sym < 256) {
+			put(sym);
+			continue;
+		}
+		if(sym == 256) return true;
+		sym -= 257;
+		if(sym >= 29) return false;
+		uint len = getbits(pgm_read_byte(&length_bits[sym]), pgm_read_word(&length_base[sym]));
+		int d = decode(dt);
+		if(error || d < 0 || d >= 30) return false;
+		uint dist = getbits(pgm_read_byte(&dist_bits[d]), pgm_read_word(&dist_base[d]));
+		if(dist > wsize || dist > total) return false;  // compressed with a larger window, or corrupt
+		while(len--) put(state->window[(wpos + wsize - dist) & (wsize-1)]);
+	}
+}
+
+bool Inflater::inflate_stored() {
+	bitcount = 0;  // the block starts on a byte boundary
+	if(end - src < 4) return false;
+	uint16_t len = pgm_read_byte(src) | pgm_read_byte(src+1) << 8;
+	uint16_t nlen = pgm_read_byte(src+2) | pgm_read_byte(src+3) << 8;
+	src += 4;
+	if(len != (uint16_t)~nlen || end - src < len) return false;
+	while(len--) put(pgm_read_byte(src++));
+	return true;
+}
+
+bool Inflater::gunzip_P(const uint8_t *data, size_t len, Print &to) {
+	if(!state || len < 18) return false;
+	src = data;
+	end = data + len - 8;  // CRC-32 and size follow the deflate stream
+	out = &to;
+	wpos = total = 0;
+	bitcount = 0;
+	error = false;
+	// gzip header (RFC 1952)
+	if(pgm_read_byte(src) != 0x1f || pgm_read_byte(src+1) != 0x8b || pgm_read_byte(src+2) != 8) return false;
+	byte flags = pgm_read_byte(src+3);
+	src += 10;
+	if(flags & 0x04) src += 2 + (pgm_read_byte(src) | pgm_read_byte(src+1) << 8);  // FEXTRA
+	if(flags & 0x08) while(src < end && pgm_read_byte(src++));  // FNAME
+	if(flags & 0x10) while(src < end && pgm_read_byte(src++));  // FCOMMENT
+	if(flags & 0x02) src += 2;  // FHCRC
+	bool last;
+	do {
+		last = getbit();
+		byte type = getbits(2, 0);
+		bool ok;
+		if(type == 0) {
+			ok = inflate_stored();
+		} else if(type == 1) {
+			// fixed codes
+			uint8_t *lengths = state->lengths;
+			memset(lengths, 8, 144);
+			memset(lengths+144, 9, 112);
+			memset(lengths+256, 7, 24);
+			memset(lengths+280, 8, 8);
+			build_tree(state->lt.counts, state->lt.symbols, lengths, 288);
+			memset(lengths, 5, 30);
+			build_tree(state->dt.counts, state->dt.symbols, lengths, 30);
+			ok = inflate_block(state->lt, state->dt);
+		} else if(type == 2) {
+			ok = build_dynamic_trees() && inflate_block(state->lt, state->dt);
+		} else {
+			ok = false;
+		}
+		if(!ok || error) return false;
+	} while(!last);
+	if(wpos) out->write(state->window, wpos);
+	return total == size_P(data, len);
+}
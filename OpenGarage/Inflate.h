@@ -0,0 +1,72 @@
+/* OpenGarage Firmware
+ *
+ * Gzip decompressor header file
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _INFLATE_H
+#define _INFLATE_H
+
+#include <Arduino.h>
+
+/** Decompresses gzip data stored in flash, for clients that cannot take
+ *  a compressed page. The window and the Huffman tables are taken from
+ *  the heap for the lifetime of the object, so create it only when needed
+ *  and check ok() first. The data must have been compressed with a window
+ *  of at most 1<<window_bits bytes.
+ *
+ *    Inflater inflater(ASSET_WINDOW_BITS);
+ *    if(inflater.ok()) inflater.gunzip_P(data, len, out);
+ */
+class Inflater {
+public:
+	Inflater(byte window_bits);
+	~Inflater();
+
+	bool ok() const { return state != NULL; }
+	// writes the decompressed data to out; false if the data is malformed
+	bool gunzip_P(const uint8_t *src, size_t len, Print &out);
+	// decompressed size, from the gzip trailer
+	static size_t size_P(const uint8_t *src, size_t len);
+
+private:
+	struct Tree;
+	struct State;
+
+	int getbit();
+	uint getbits(byte n, uint base);
+	int decode(const Tree &t);
+	void put(uint8_t c);
+	bool build_dynamic_trees();
+	bool inflate_block(const Tree &lt, const Tree &dt);
+	bool inflate_stored();
+
+	State *state;
+	size_t wsize;
+	const uint8_t *src;
+	const uint8_t *end;
+	Print *out;
+	size_t wpos;   // next byte in the window
+	size_t total;  // bytes decompressed so far
+	uint8_t tag;   // bits not yet read of the current byte
+	byte bitcount;
+	bool error;
+};
+
+#endif  // _INFLATE_H
@@ -0,0 +1,156 @@
+/* OpenGarage Firmware
+ *
+ * JSON writer
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "JsonWriter.h"
+
+JsonWriter::JsonWriter(char *buf, size_t size, Print *out)
+	: buf(buf), size(size), len(0), out(out), first(true), full(false) {
+}
+
+void JsonWriter::put(char c) {
+	if(len + 1 >= size) { // keep room for the terminating zero
+		if(out) flush();
+		else { full = true; return; }
+	}
+	buf[len++] = c;
+}
+
+void JsonWriter::put_P(PGM_P s) {
+	char c;
+	while((c = pgm_read_byte(s++)) != 0) put(c);
+}
+
+void JsonWriter::flush() {
+	if(!out || !len) return;
+	out->write((const uint8_t*)buf, len);
+	len = 0;
+}
+
+const char *JsonWriter::c_str() {
+	buf[len] = 0;
+	return buf;
+}
+
+void JsonWriter::comma() {
+	if(!first) put(',');
+	first = false;
+}
+
+void JsonWriter::key(const __FlashStringHelper *key) {
+	comma();
+	put('"');
+	put_P((PGM_P)key);
+	put('"');
+	put(':');
+}
+
+void JsonWriter::key_ram(const char *key) {
+	comma();
+	put('"');
+	escaped(key);
+	put('"');
+	put(':');
+}
+
+void JsonWriter::beginObject(const __FlashStringHelper *key) {
+	if(key) this->key(key);
+	else comma();
+	put('{');
+	first = true;
+}
+
+void JsonWriter::endObject() {
+	put('}');
+	first = false;
+}
+
+void JsonWriter::beginArray(const __FlashStringHelper *key) {
+	if(key) this->key(key);
+	else comma();
+	put('[');
+	first = true;
+}
+
+void JsonWriter::beginArray(const char *key) {
+	key_ram(key);
+	put('[');
+	first = true;
+}
+
+void JsonWriter::endArray() {
+	put(']');
+	first = false;
+}
+
+void JsonWriter::escaped(const char *s) {
+	static const char hex[] = "0123456789abcdef";
+	if(!s) return;
+	for(;*s;s++) {
+		char c = *s;
+		if(c == '"' || c == '\\') {
+			put('\\');
+			put(c);
+		} else if((unsigned char)c < 0x20) {
+			put('\\'); put('u'); put('0'); put('0');
+			put(hex[(c>>4)&0xF]);
+			put(hex[c&0xF]);
+		} else {
+			put(c);
+		}
+	}
+}
+
+void JsonWriter::value_uint(unsigned long v) {
+	char tmp[sizeof(v)*3];  // a byte has at most 3 decimal digits
+	byte n = 0;
+	do {
+		tmp[n++] = '0' + v%10;
+		v /= 10;
+	} while(v);
+	while(n) put(tmp[--n]);
+}
+
+void JsonWriter::value_int(long v) {
+	if(v < 0) {
+		put('-');
+		value_uint(-(unsigned long)v);
+	} else {
+		value_uint(v);
+	}
+}
+
+// two decimals, like String(float)
+void JsonWriter::value_float(float v) {
+	if(isnan(v) || isinf(v)) {
+		put_P(PSTR("null"));
+		return;
+	}
+	if(v < 0) {
+		put('-');
+		v = -v;
+	}
+	unsigned long hundredths = (unsigned long)(v*100 + 0.5f);
+	value_uint(hundredths/100);
+	put('.');
+	put('0' + (hundredths/10)%10);
+	put('0' + hundredths%10);
+}
@@ -0,0 +1,102 @@
+/* OpenGarage Firmware
+ *
+ * JSON writer header file
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _JSONWRITER_H
+#define _JSONWRITER_H
+
+#include <Arduino.h>
+
+/** Writes JSON into a caller-supplied buffer without touching the heap.
+ *  Keys are flash strings (F("...")); commas between members are added
+ *  automatically. When the buffer fills up, it is passed on to 'out' if
+ *  one is given, otherwise the writer stops and overflow() turns true.
+ *  The output is then cut off, so check overflow() before sending it.
+ *
+ *    char buf[JSON_BUFFER_SIZE];
+ *    JsonWriter json(buf, sizeof(buf));
+ *    json.beginObject();
+ *    json.add(F("dist"), distance);
+ *    json.endObject();
+ *    otf_send_json(res, json);
+ */
+class JsonWriter {
+public:
+	JsonWriter(char *buf, size_t size, Print *out = NULL);
+
+	void beginObject(const __FlashStringHelper *key = NULL);
+	void endObject();
+	void beginArray(const __FlashStringHelper *key = NULL);
+	void beginArray(const char *key);
+	void endArray();
+
+	void add(const __FlashStringHelper *key, long value) { this->key(key); value_int(value); }
+	void add(const __FlashStringHelper *key, unsigned long value) { this->key(key); value_uint(value); }
+	void add(const __FlashStringHelper *key, int value) { add(key, (long)value); }
+	void add(const __FlashStringHelper *key, unsigned int value) { add(key, (unsigned long)value); }
+	void add(const __FlashStringHelper *key, float value) { this->key(key); value_float(value); }
+	void add(const __FlashStringHelper *key, const char *value) { this->key(key); value_str(value); }
+	void add(const __FlashStringHelper *key, const String &value) { this->key(key); value_str(value.c_str()); }
+	void add(const __FlashStringHelper *key, const __FlashStringHelper *value) { this->key(key); put('"'); put_P((PGM_P)value); put('"'); }
+	// for keys that only exist in RAM, e.g. option names
+	void add(const char *key, long value) { key_ram(key); value_int(value); }
+	void add(const char *key, unsigned long value) { key_ram(key); value_uint(value); }
+	void add(const char *key, unsigned int value) { add(key, (unsigned long)value); }
+	void add(const char *key, const char *value) { key_ram(key); value_str(value); }
+
+	// array elements
+	void item(long value) { comma(); value_int(value); }
+	void item(unsigned long value) { comma(); value_uint(value); }
+	void item(int value) { item((long)value); }
+	void item(unsigned int value) { item((unsigned long)value); }
+
+	// string value assembled from several parts, e.g. a default value
+	void beginString(const __FlashStringHelper *key) { this->key(key); put('"'); }
+	void beginString(const char *key) { key_ram(key); put('"'); }
+	void append(const char *s) { escaped(s); }
+	void endString() { put('"'); }
+
+	const char *c_str();  // null-terminated result (only the unflushed part when streaming)
+	size_t length() const { return len; }
+	bool overflow() const { return full; }
+	void flush();         // hands buffered output to 'out'
+
+private:
+	void key(const __FlashStringHelper *key);
+	void key_ram(const char *key);
+	void comma();
+	void put(char c);
+	void put_P(PGM_P s);
+	void escaped(const char *s);
+	void value_int(long v);
+	void value_uint(unsigned long v);
+	void value_float(float v);
+	void value_str(const char *s) { put('"'); escaped(s); put('"'); }
+
+	char *buf;
+	size_t size;
+	size_t len;
+	Print *out;
+	bool first;  // no member written yet at the current level
+	bool full;
+};
+
+#endif  // _JSONWRITER_H
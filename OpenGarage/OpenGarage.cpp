@@ -24,6 +24,16 @@
 
 byte  OpenGarage::state = OG_STATE_INITIAL;
 File  OpenGarage::log_file;
+uint32_t OpenGarage::log_seg_first[LOG_SEGMENTS];
+uint32_t OpenGarage::log_seg_base[LOG_SEGMENTS];
+uint32_t OpenGarage::log_next_seq = 1;
+uint32_t OpenGarage::log_flushed_seq = 1;
+LogStruct OpenGarage::log_cache[LOG_CACHE_SIZE];
+byte  OpenGarage::log_cache_count = 0;
+ulong OpenGarage::log_flush_timeout = 0;
+uint32_t OpenGarage::log_read_seq = 0;
+byte  OpenGarage::log_head = 0;
+byte  OpenGarage::log_read_seg = 0;
 byte  OpenGarage::alarm = 0;
 byte  OpenGarage::alarm_action = 0;
 byte  OpenGarage::led_reverse = 0;
@@ -31,72 +41,80 @@ byte  OpenGarage::has_swrx = 0;
 Ticker ud_ticker;
 
 static const char* config_fname = CONFIG_FNAME;
+static const char* config_bin_fname = CONFIG_BIN_FNAME;
+static const char* config_tmp_fname = CONFIG_TMP_FNAME;
+static const char* config_jnl_fname = CONFIG_JNL_FNAME;
 static const char* log_fname = LOG_FNAME;
 
 DallasTemperature* OpenGarage::ds18b20 = NULL;
 DHTesp* OpenGarage::dht = NULL;
 extern OpenGarage og;
-/* Options name, default integer value, max value, default string value
- * Integer options don't have string value
- * String options don't have integer or max value
- */
-OptionStruct OpenGarage::options[] = {
-	{"fwv", OG_FWV,      255, ""},
-	{"sn1", OG_SN1_CEILING,1, ""},
-	{"sn2", OG_SN2_NONE,   2, ""},
-	{"sno", OG_SNO_1ONLY,  3, ""},
-	{"secv",0,             2, ""},
-	{"dth", 50,        65535, ""},
-	{"vth", 150,       65535, ""},
-	{"riv", 1,            30, ""},
-	{"alm", OG_ALM_5,      2, ""},
-	{"aoo", 0,             1, ""},
-	{"lsz", DEFAULT_LOG_SIZE,400,""},
-	{"tsn", OG_TSN_NONE, 255, ""},
-	{"htp", 80,        65535, ""},
-	{"cdt", 1000,       5000, ""},
-	{"dri", 500,        3000, ""},
-	{"sfi", OG_SFI_CONSENSUS,1,""},
-	{"cmr", 10,          100, ""},
-	{"sto", 0,             1, ""},
-	{"mod", OG_MOD_AP,   255, ""},
-	{"ati", 30,          720, ""},
-	{"ato", OG_AUTO_NONE,255, ""},
-	{"atib", 3,           24, ""},
-	{"atob", OG_AUTO_NONE,255, ""},
-	{"noto", OG_NOTIFY_DO|OG_NOTIFY_DC,255, ""},
-	{"bas", OG_LIGHT_BLINK_FOREVER, OG_LIGHT_BLINK_MAX, ""},
-	{"usi", 0,             1, ""},
-	{"ssid", 0, 0, ""},  // string options have 0 max value
-	{"pass", 0, 0, ""},
-	{"cld",  0, 2, ""},
-	{"auth", 0, 0, ""},
-	{"bdmn", 0, 0, DEFAULT_BLYNK_DMN},
-	{"bprt", DEFAULT_BLYNK_PRT,65535, ""},
-	{"dkey", 0, 0, DEFAULT_DKEY},
-	{"name", 0, 0, DEFAULT_NAME},
-	{"iftt", 0, 0, ""},
-	{"mqen", 0, 1, ""},
-	{"mqtt", 0, 0, ""},
-	{"mqpt", 1883, 65535, ""},
-	{"mqur", 0, 0, ""},
-	{"mqpw", 0, 0, ""},
-	{"mqtp", 0, 0, ""},
-	{"dben", 0, 1, ""},
-	{"emen", 0, 1, ""},
-	{"smtp", 0, 0, DEFAULT_SMTP_SERVER},
-	{"sprt", DEFAULT_SMTP_PORT, 65535, ""},
-	{"send", 0, 0, ""},
-	{"apwd", 0, 0, ""},
-	{"recp", 0, 0, ""},
-	{"dvip", 0, 0, ""},
-	{"gwip", 0, 0, ""},
-	{"subn", 0, 0, "255.255.255.0"},
-	{"dns1", 0, 0, "8.8.8.8"},
-	{"ntp1", 0, 0, ""},
-	{"host", 0, 0, ""},
+/* Option tables, expanded from OG_OPTIONS in defines.h. Names and limits
+ * stay in flash; integer options only take up 16 bits in RAM, string
+ * options a String. */
+#define OPTION_DEF_INT(id, name, ival, min, max) {name, OPTION_TYPE_INT, min, max},
+#define OPTION_DEF_STR(id, name, sval, len) {name, OPTION_TYPE_STR, 0, len},
+const OptionStruct OpenGarage::options[] PROGMEM = { OG_OPTIONS(OPTION_DEF_INT, OPTION_DEF_STR) };
+
+#define OPTION_IVAL(id, name, ival, min, max) ival,
+#define OPTION_IVAL_OK(id, name, ival, min, max) && (min) <= (ival) && (ival) <= (max) && (max) <= 0xFFFF
+uint16_t OpenGarage::ivals[] = { OG_OPTIONS(OPTION_IVAL, OPTION_NONE) };
+static_assert(true OG_OPTIONS(OPTION_IVAL_OK, OPTION_NONE), "integer option defaults are within their 16-bit limits");
+
+#define OPTION_SVAL_P(id, name, sval, len) static const char option_sval_##id[] PROGMEM = sval;
+#define OPTION_SVAL(id, name, sval, len) String(FPSTR(option_sval_##id)),
+OG_OPTIONS(OPTION_NONE, OPTION_SVAL_P)
+String OpenGarage::svals[] = { OG_OPTIONS(OPTION_NONE, OPTION_SVAL) };
+byte OpenGarage::options_dirty[];
+
+/* Perfect hash of the option names for find_option(): a name packed into
+ * 32 bits (the config file tag), times a multiplier, gives its slot in a
+ * 256-entry table in the top 8 bits. The multiplier is searched for at
+ * compile time so that no two names share a slot. */
+static constexpr uint32_t option_key(const char *name) {
+	uint32_t key = 0;
+	for(byte i=0;i<4 && name[i];i++) key |= (uint32_t)(byte)name[i] << (8*i);
+	return key;
+}
+
+#define OPTION_KEY(id, name, ...) option_key(name),
+#define OPTION_NAME_LEN_OK(id, name, ...) && sizeof(name) <= 5
+static constexpr uint32_t option_keys[] = { OG_OPTIONS(OPTION_KEY, OPTION_KEY) };
+static_assert(true OG_OPTIONS(OPTION_NAME_LEN_OK, OPTION_NAME_LEN_OK), "option names are at most 4 characters");
+
+struct OptionHash {
+	uint32_t mult;
+	byte slot[256];  // option index, or 0xFF
 };
 
+static constexpr OptionHash make_option_hash() {
+	OptionHash h = {};
+	for(uint32_t mult=0x9E3779B1;;mult+=2) {
+		for(uint i=0;i<256;i++) h.slot[i] = 0xFF;
+		byte i = 0;
+		for(;i<NUM_OPTIONS;i++) {
+			byte s = (option_keys[i]*mult) >> 24;
+			if(h.slot[s] != 0xFF) break;
+			h.slot[s] = i;
+		}
+		if(i == NUM_OPTIONS) {
+			h.mult = mult;
+			return h;
+		}
+	}
+}
+
+static constexpr OptionHash option_hash_c = make_option_hash();
+static const OptionHash option_hash PROGMEM = option_hash_c;
+
+static int find_option_key(uint32_t key) {
+	byte i = pgm_read_byte(&option_hash.slot[(key*option_hash_c.mult) >> 24]);
+	if(i >= NUM_OPTIONS) return -1;
+	uint32_t k;
+	memcpy_P(&k, OpenGarage::options[i].name, sizeof(k));
+	return k == key ? i : -1;
+}
+
 /* Variables and functions for handling Ultrasonic Distance sensor */
 #define KAVG 7  // k average
 volatile uint32_t ud_start = 0;
@@ -114,7 +132,7 @@ void ud_start_trigger() {
 		DEBUG_PRINTLN("a timeout occurred");
 		// A timeout occurred because the ECHO pin never went LOW.
 		// Check if the user wants to cap the value or ignore it.
-		if (og.options[OPTION_STO].ival != 0) {
+		if (og.ival(OPTION_STO) != 0) {
 			// Cap the duration to the maximum value.
 			ud_buffer[ud_i] = UD_TIMEOUT_US;
 			// Advance the circular buffer.
@@ -144,7 +162,7 @@ IRAM_ATTR void ud_isr() {
 		ud_buffer[ud_i] = micros() - ud_start; // calculate elapsed time
 		if(ud_buffer[ud_i]>UD_TIMEOUT_US) {
 			// timedout
-			if(og.options[OPTION_STO].ival==0) {
+			if(og.ival(OPTION_STO)==0) {
 				// ignore
 				return;
 			} else {
@@ -211,19 +229,37 @@ void OpenGarage::begin() {
 }
 
 void OpenGarage::options_setup() {
-	if(!FILESYS.exists(config_fname)) { // if config file does not exist
+	bool loaded = false;
+	if(FILESYS.exists(config_tmp_fname)) {
+		// a save was cut short: a complete new file replaces the old one and its journal
+		loaded = options_load(config_tmp_fname);
+		if(loaded) {
+			FILESYS.remove(config_jnl_fname);
+			FILESYS.remove(config_bin_fname);
+			FILESYS.rename(config_tmp_fname, config_bin_fname);
+		} else {
+			FILESYS.remove(config_tmp_fname);
+		}
+	}
+	if(loaded || FILESYS.exists(config_bin_fname)) {
+		DEBUG_PRINTLN(F("load options"));
+		if(!loaded && !options_load(config_bin_fname)) options_write_all(); // damaged, start over with the defaults
+		else if(!options_replay()) options_write_all(); // damaged journal, keep the changes read so far
+	} else if(options_import_legacy()) {
+		DEBUG_PRINTLN(F("imported text config file"));
+		options_write_all();
+		FILESYS.remove(config_fname);
+	} else { // if config file does not exist
 		DEBUG_PRINTLN(F("create config file"));
-		options_save(); // save default option values
+		options_write_all(); // save default option values
 		return;
 	}
-	DEBUG_PRINTLN(F("load options"));
-	options_load();
 	DEBUG_PRINTLN(F("done"));
-	if(options[OPTION_FWV].ival != OG_FWV)  {
+	if(ival(OPTION_FWV) != OG_FWV)  {
 		// if firmware version has changed
 		// re-save options, thus preserving
 		// shared options with previous firmwares
-		options[OPTION_FWV].ival = OG_FWV;
+		set_ival(OPTION_FWV, OG_FWV);
 		options_save();
 		return;
 	}
@@ -231,7 +267,10 @@ void OpenGarage::options_setup() {
 
 void OpenGarage::options_reset() {
 	DEBUG_PRINT(F("reset to factory default..."));
-	if(!FILESYS.remove(config_fname)) {
+	FILESYS.remove(config_tmp_fname);
+	FILESYS.remove(config_jnl_fname);
+	FILESYS.remove(config_fname);
+	if(!FILESYS.remove(config_bin_fname)) {
 		DEBUG_PRINTLN(F("failed to remove config file"));
 		return;
 	}else{DEBUG_PRINTLN(F("Removed config file"));}
@@ -239,67 +278,348 @@ void OpenGarage::options_reset() {
 }
 
 void OpenGarage::log_reset() {
-	if(!FILESYS.remove(log_fname)) {
-		DEBUG_PRINTLN(F("failed to remove log file"));
-		return;
-	}else{DEBUG_PRINTLN(F("Removed log file"));}
-	DEBUG_PRINTLN(F("ok"));
+	char name[16];
+	read_log_end();
+	for(byte i=0;i<LOG_SEGMENTS;i++) {
+		sprintf(name, LOG_SEG_FNAME, i);
+		FILESYS.remove(name);
+		log_seg_first[i] = 0;
+	}
+	log_cache_count = 0;
+	log_flushed_seq = log_next_seq;
+	FILESYS.remove(log_fname);
+	DEBUG_PRINTLN(F("Removed log files"));
 }
 
-int OpenGarage::find_option(String name) {
-	for(byte i=0;i<NUM_OPTIONS;i++) {
-		if(name == options[i].name) {
-		  return i;
+bool OpenGarage::option_valid(byte i, const char *value) {
+	OptionStruct o;
+	get_option(i, o);
+	if(o.type == OPTION_TYPE_STR) return strlen(value) <= o.max;
+	long v = strtol(value, NULL, 10);  // like String::toInt(), so an empty value is 0
+	return v >= o.min && v <= o.max;
+}
+
+void OpenGarage::set_ival(byte i, uint16_t v) {
+	uint16_t &iv = ivals[option_slots[i]];
+	if(iv == v) return;
+	iv = v;
+	options_dirty[i>>3] |= 1<<(i&7);
+}
+
+void OpenGarage::set_sval(byte i, const char *v) {
+	String &sv = svals[option_slots[i]];
+	if(!v) v = "";
+	if(sv == v) return;
+	sv = v;
+	options_dirty[i>>3] |= 1<<(i&7);
+}
+
+int OpenGarage::find_option(const char *name) {
+	if(strlen(name) > 4) return -1;
+	return find_option_key(option_key(name));
+}
+
+/* The config file is a header followed by one entry per option: the
+ * option name zero-padded to 4 bytes, a 16-bit value length and the value,
+ * a 32-bit integer or the string bytes. Entries are looked up by name, so
+ * options can be added or reordered; unknown names are skipped.
+ * Changes made after the file was written are appended to a journal: a
+ * header naming the CRC of the config file, then one entry per change,
+ * laid out as above and followed by a CRC-16 of the entry. */
+struct __attribute__((packed)) ConfigHeader {
+	uint16_t magic;   // CONFIG_MAGIC
+	uint8_t  version; // CONFIG_VERSION
+	uint8_t  count;   // number of entries
+	uint16_t length;  // bytes after the header
+	uint16_t crc;     // CRC-16/CCITT of those bytes
+};
+
+struct __attribute__((packed)) ConfigEntry {
+	char     tag[4];
+	uint16_t len;
+};
+
+struct __attribute__((packed)) ConfigJournalHeader {
+	uint16_t magic;    // CONFIG_JNL_MAGIC
+	uint16_t base_crc; // crc of the config file the changes apply to
+};
+
+static uint16_t config_crc;             // crc of the config file in place
+static bool config_crc_valid = false;   // false until the config file is loaded or written
+static size_t config_jnl_size = 0;      // bytes in the journal, 0 if there is none
+
+// gathers small pieces into flash-page sized writes
+class ConfigWriter {
+public:
+	ConfigWriter(File& file) : file(file), len(0) {}
+	void put(const void *data, size_t n) {
+		const uint8_t *p = (const uint8_t*)data;
+		while(n) {
+			if(len == sizeof(buf)) flush();
+			size_t k = sizeof(buf)-len < n ? sizeof(buf)-len : n;
+			memcpy(buf+len, p, k);
+			len += k; p += k; n -= k;
 		}
 	}
-	return -1;
+	void flush() {
+		if(len) file.write(buf, len);
+		len = 0;
+	}
+private:
+	File& file;
+	uint8_t buf[256];
+	size_t len;
+};
+
+static uint16_t crc16(uint16_t crc, const uint8_t *p, size_t len) {
+	while(len--) {
+		crc ^= (uint16_t)(*p++) << 8;
+		for(byte i=0;i<8;i++) crc = (crc & 0x8000) ? (crc<<1) ^ 0x1021 : crc<<1;
+	}
+	return crc;
 }
 
-void OpenGarage::options_load() {
-	File file = FILESYS.open(config_fname, "r");
+// checks the CRC in a first pass and then reads the entries, without a heap buffer
+bool OpenGarage::options_load(const char *fname) {
+	File file = FILESYS.open(fname, "r");
 	DEBUG_PRINT(F("loading config file..."));
 	if(!file) {
 		DEBUG_PRINTLN(F("failed"));
-		return;
+		return false;
+	}
+	ConfigHeader h;
+	char buf[64];
+	bool ok = file.read((uint8_t*)&h, sizeof(h)) == sizeof(h) && h.magic == CONFIG_MAGIC && h.version == CONFIG_VERSION &&
+	          file.size() == sizeof(h) + h.length;
+	if(ok) {
+		uint16_t crc = 0xFFFF;
+		size_t left = h.length;
+		while(left) {
+			size_t n = file.read((uint8_t*)buf, left < sizeof(buf) ? left : sizeof(buf));
+			if(!n) break;
+			crc = crc16(crc, (const uint8_t*)buf, n);
+			left -= n;
+		}
+		ok = !left && crc == h.crc && file.seek(sizeof(h), SeekSet);
+	}
+	if(!ok) {
+		file.close();
+		DEBUG_PRINTLN(F("invalid"));
+		return false;
 	}
+	for(byte n=0;n<h.count;n++) {
+		ConfigEntry e;
+		if(file.read((uint8_t*)&e, sizeof(e)) != sizeof(e)) break;
+		uint32_t key;
+		memcpy(&key, e.tag, sizeof(key));
+		int i = find_option_key(key);
+		OptionStruct o;
+		if(i >= 0) get_option(i, o);
+		if(i >= 0 && o.type == OPTION_TYPE_INT && e.len == sizeof(uint32_t)) {  // this is an integer option
+			uint32_t v;
+			file.read((uint8_t*)&v, sizeof(v));
+			ivals[option_slots[i]] = v;
+		} else if(i >= 0 && o.type == OPTION_TYPE_STR) {  // this is a string option
+			String &sv = svals[option_slots[i]];
+			sv = "";  // keeps the buffer
+			for(uint16_t left=e.len;left;) {
+				size_t k = file.read((uint8_t*)buf, left < sizeof(buf) ? left : sizeof(buf));
+				if(!k) break;
+				sv.concat(buf, k);
+				left -= k;
+			}
+		} else {  // unknown option
+			file.seek(e.len, SeekCur);
+		}
+	}
+	file.close();
+	config_crc = h.crc;
+	config_crc_valid = true;
+	DEBUG_PRINTLN(F("ok"));
+	return true;
+}
+
+/* Applies the changes in the journal. A journal left over from another
+ * config file is dropped. Returns false if it ends in a damaged entry. */
+bool OpenGarage::options_replay() {
+	config_jnl_size = 0;
+	File file = FILESYS.open(config_jnl_fname, "r");
+	if(!file) return true;
+	ConfigJournalHeader jh;
+	if(file.read((uint8_t*)&jh, sizeof(jh)) != sizeof(jh) || jh.magic != CONFIG_JNL_MAGIC || jh.base_crc != config_crc) {
+		file.close();
+		FILESYS.remove(config_jnl_fname);
+		return true;
+	}
+	size_t pos = sizeof(jh), size = file.size();
+	uint8_t rec[sizeof(ConfigEntry)+CONFIG_JNL_VALUE_MAX];
+	const uint8_t *value = rec + sizeof(ConfigEntry);
+	while(pos < size) {
+		ConfigEntry e;
+		uint16_t crc;
+		if(file.read(rec, sizeof(e)) != sizeof(e)) break;
+		memcpy(&e, rec, sizeof(e));
+		if(e.len > CONFIG_JNL_VALUE_MAX || file.read(rec+sizeof(e), e.len) != e.len ||
+		   file.read((uint8_t*)&crc, sizeof(crc)) != sizeof(crc) || crc != crc16(0xFFFF, rec, sizeof(e)+e.len)) break;
+		pos += sizeof(e) + e.len + sizeof(crc);
+		uint32_t key;
+		memcpy(&key, e.tag, sizeof(key));
+		int i = find_option_key(key);
+		if(i < 0) continue;
+		OptionStruct o;
+		get_option(i, o);
+		if(o.type == OPTION_TYPE_INT && e.len == sizeof(uint32_t)) {
+			uint32_t v;
+			memcpy(&v, value, sizeof(v));
+			ivals[option_slots[i]] = v;
+		} else if(o.type == OPTION_TYPE_STR) {
+			String &sv = svals[option_slots[i]];
+			sv = "";
+			sv.concat((const char*)value, e.len);
+		}
+	}
+	file.close();
+	config_jnl_size = pos;
+	DEBUG_PRINT(F("config journal: "));
+	DEBUG_PRINTLN(pos);
+	return pos == size;
+}
+
+// reads the name:value lines of the text config file
+bool OpenGarage::options_import_legacy() {
+	File file = FILESYS.open(config_fname, "r");
+	if(!file) return false;
 	byte nopts = 0;
 	while(file.available()) {
 		String name = file.readStringUntil(':');
-		String sval = file.readStringUntil('\n');
-		sval.trim();
+		String value = file.readStringUntil('\n');
+		value.trim();
 		DEBUG_PRINT(name);
 		DEBUG_PRINT(":");
-		DEBUG_PRINTLN(sval);
+		DEBUG_PRINTLN(value);
 		nopts++;
 		if(nopts>NUM_OPTIONS+1) break;
-		int idx = find_option(name);
+		int idx = find_option(name.c_str());
 		if(idx<0) continue;
-		if(options[idx].max) {  // this is an integer option
-		  options[idx].ival = sval.toInt();
+		OptionStruct o;
+		get_option(idx, o);
+		if(o.type == OPTION_TYPE_INT) {  // this is an integer option
+		  ivals[option_slots[idx]] = value.toInt();
 		} else {  // this is a string option
-		  options[idx].sval = sval;
+		  svals[option_slots[idx]] = value;
 		}
 	}
 	file.close();
+	return true;
 }
 
+static void config_entry(byte i, ConfigEntry &e, uint32_t &v, const uint8_t *&value) {
+	OptionStruct o;
+	OpenGarage::get_option(i, o);
+	memcpy(e.tag, o.name, sizeof(e.tag));
+	if(o.type == OPTION_TYPE_INT) {
+		v = OpenGarage::ival(i);
+		value = (const uint8_t*)&v;
+		e.len = sizeof(v);
+	} else {
+		const String &sv = OpenGarage::sval(i);
+		value = (const uint8_t*)sv.c_str();
+		e.len = sv.length();
+	}
+}
+
+/* Appends the changed options to the journal, a few bytes each. The whole
+ * file is rewritten instead when there is no config file to append to yet,
+ * a value is long, or the journal has grown to CONFIG_JNL_SIZE. */
 void OpenGarage::options_save() {
-	File file = FILESYS.open(config_fname, "w");
+	ConfigEntry e;
+	uint32_t v;
+	const uint8_t *value;
+	size_t n = 0;
+	bool fits = config_crc_valid;
+	for(byte i=0;i<NUM_OPTIONS;i++) {
+		if(!(options_dirty[i>>3] & (1<<(i&7)))) continue;
+		config_entry(i, e, v, value);
+		if(e.len > CONFIG_JNL_VALUE_MAX) fits = false;
+		n += sizeof(e) + e.len + sizeof(uint16_t);
+	}
+	if(!n) return;
+	size_t size = config_jnl_size ? config_jnl_size : sizeof(ConfigJournalHeader);
+	if(!fits || size + n > CONFIG_JNL_SIZE) {
+		options_write_all();
+		return;
+	}
+	File file = FILESYS.open(config_jnl_fname, config_jnl_size ? "a" : "w");
+	if(!file) {
+		options_write_all();
+		return;
+	}
+	ConfigWriter out(file);
+	if(!config_jnl_size) {
+		ConfigJournalHeader jh = {CONFIG_JNL_MAGIC, config_crc};
+		out.put(&jh, sizeof(jh));
+	}
+	for(byte i=0;i<NUM_OPTIONS;i++) {
+		if(!(options_dirty[i>>3] & (1<<(i&7)))) continue;
+		config_entry(i, e, v, value);
+		uint16_t crc = crc16(crc16(0xFFFF, (const uint8_t*)&e, sizeof(e)), value, e.len);
+		out.put(&e, sizeof(e));
+		out.put(value, e.len);
+		out.put(&crc, sizeof(crc));
+	}
+	out.flush();
+	bool ok = file.size() == size + n;
+	file.close();
+	if(!ok) {  // the next load would stop at the damage
+		options_write_all();
+		return;
+	}
+	config_jnl_size = size + n;
+	memset(options_dirty, 0, sizeof(options_dirty));
+}
+
+/* Writes a new config file next to the old one, then drops the journal and
+ * swaps the files. After a power loss, options_setup() picks up the new file
+ * if it is complete, else the old file and journal are still intact. */
+void OpenGarage::options_write_all() {
+	ConfigHeader h = {CONFIG_MAGIC, CONFIG_VERSION, NUM_OPTIONS, 0, 0xFFFF};
+	ConfigEntry e;
+	uint32_t v;
+	const uint8_t *value;
+	for(byte i=0;i<NUM_OPTIONS;i++) {
+		config_entry(i, e, v, value);
+		h.crc = crc16(crc16(h.crc, (const uint8_t*)&e, sizeof(e)), value, e.len);
+		h.length += sizeof(e) + e.len;
+	}
+	File file = FILESYS.open(config_tmp_fname, "w");
 	DEBUG_PRINTLN(F("saving config file..."));
 	if(!file) {
 		DEBUG_PRINTLN(F("failed"));
 		return;
 	}
-	OptionStruct *o = options;
-	for(byte i=0;i<NUM_OPTIONS;i++,o++) {
-		file.print(o->name + ":");
-		if(o->max)
-		  file.println(o->ival);
-		else
-		  file.println(o->sval);
+	ConfigWriter out(file);
+	out.put(&h, sizeof(h));
+	for(byte i=0;i<NUM_OPTIONS;i++) {
+		config_entry(i, e, v, value);
+		out.put(&e, sizeof(e));
+		out.put(value, e.len);
 	}
-	DEBUG_PRINTLN(F("ok"));
+	out.flush();
+	bool ok = file.size() == sizeof(h) + h.length;
 	file.close();
+	if(!ok) {
+		DEBUG_PRINTLN(F("failed"));
+		FILESYS.remove(config_tmp_fname);
+		return;
+	}
+	FILESYS.remove(config_jnl_fname);
+	FILESYS.remove(config_bin_fname);
+	FILESYS.rename(config_tmp_fname, config_bin_fname);
+	config_crc = h.crc;
+	config_crc_valid = true;
+	config_jnl_size = 0;
+	memset(options_dirty, 0, sizeof(options_dirty));
+	DEBUG_PRINTLN(F("ok"));
 }
 
 uint OpenGarage::read_distance() {
@@ -314,7 +634,7 @@ uint OpenGarage::read_distance() {
 	}
 
 	// noise filtering methods
-	if(options[OPTION_SFI].ival == OG_SFI_MEDIAN) {
+	if(ival(OPTION_SFI) == OG_SFI_MEDIAN) {
 		// partial sorting of buf to perform median filtering
 		byte out, in;
 		for(out=1; out<=KAVG/2; out++){
@@ -339,7 +659,7 @@ uint OpenGarage::read_distance() {
 			sum += v;
 		}
 		// calculate margin
-		uint32_t margin = (float)options[OPTION_CMR].ival/0.01716f;
+		uint32_t margin = (float)ival(OPTION_CMR)/0.01716f;
 		margin = (margin<60)?60:margin;
 		if(vmax-vmin<=margin) {
 			last_returned = (sum/KAVG)*0.01716f;
@@ -350,10 +670,10 @@ uint OpenGarage::read_distance() {
 
 void OpenGarage::init_sensors() {
 	// set up distance sensors
-	ud_ticker.attach_ms(options[OPTION_DRI].ival, ud_ticker_cb);
+	ud_ticker.attach_ms(ival(OPTION_DRI), ud_ticker_cb);
 	attachInterrupt(PIN_ECHO, ud_isr, CHANGE);
 
-	switch(options[OPTION_TSN].ival) {
+	switch(ival(OPTION_TSN)) {
 	case OG_TSN_DHT11:
 		dht = new DHTesp();
 		dht->setup(PIN_TH, DHTesp::DHT11);
@@ -372,7 +692,7 @@ void OpenGarage::init_sensors() {
 
 void OpenGarage::read_TH_sensor(float& C, float& H) {
 	float v;
-	switch(options[OPTION_TSN].ival) {
+	switch(ival(OPTION_TSN)) {
 	case OG_TSN_DHT11:
 	case OG_TSN_DHT22:
 		if(dht) {
@@ -394,57 +714,327 @@ void OpenGarage::read_TH_sensor(float& C, float& H) {
 	}
 }
 
-void OpenGarage::write_log(const LogStruct& data) {
-	File file;
-	uint curr = 0;
-	DEBUG_PRINTLN(F("saving log data..."));
-	if(!FILESYS.exists(log_fname)) {  // create log file
-		file = FILESYS.open(log_fname, "w");
-		if(!file) {
-			DEBUG_PRINTLN(F("failed"));
-			return;
+/* The door event log is append-only: LOG_SEGMENTS files used as a ring,
+ * each a header followed by up to LOG_SEG_RECORDS 6-byte records. The
+ * header holds the sequence number of the first record and the time stamp
+ * the records are relative to; a record that does not fit in 24 bits of
+ * seconds from there starts a new segment. No flash page is rewritten for
+ * an event. A record torn by a power loss fails its CRC and is cut off by
+ * log_setup() at the next boot. When the head segment is full, the oldest
+ * one is started over. */
+struct __attribute__((packed)) LogSegHeader {
+	uint16_t magic;     // LOG_SEG_MAGIC
+	uint8_t  version;   // LOG_SEG_VERSION
+	uint8_t  reserved;
+	uint32_t first_seq;
+	uint32_t base_tstamp;
+};
+
+/* bits  0-23  seconds since the segment base time stamp
+ *      24-26  door status
+ *      27-35  distance, 511 and above stored as 511
+ *      36-37  sn2 (0 low, 1 high, 3 none)
+ *      38-39  reserved
+ *      40-47  CRC-8 of the sequence number and bits 0-39 */
+struct __attribute__((packed)) LogRecord {
+	uint8_t b[6];
+};
+
+#define LOG_DELTA_MAX  0xFFFFFFUL
+
+// file layout of /log2.dat, from firmware 1.2.4 and before
+struct LegacyLogStruct {
+	uint32_t tstamp;
+	uint32_t status;
+	uint32_t dist;
+	uint8_t  sn2;
+};
+
+static uint8_t crc8(uint8_t crc, const uint8_t *p, size_t len) {
+	while(len--) {
+		crc ^= *p++;
+		for(byte i=0;i<8;i++) crc = (crc & 0x80) ? (crc<<1) ^ 0x07 : crc<<1;
+	}
+	return crc;
+}
+
+static uint8_t log_record_crc(const LogRecord &r, uint32_t seq) {
+	return crc8(crc8(0, (const uint8_t*)&seq, sizeof(seq)), r.b, 5);
+}
+
+static bool log_fits(ulong tstamp, uint32_t base) {
+	return tstamp >= base && tstamp-base <= LOG_DELTA_MAX;
+}
+
+static void log_encode(LogRecord &r, uint32_t seq, uint32_t base, const LogStruct &l) {
+	uint64_t v = (uint64_t)(l.tstamp-base);
+	v |= (uint64_t)(l.status > 7 ? 7 : l.status) << 24;
+	v |= (uint64_t)(l.dist > 511 ? 511 : l.dist) << 27;
+	v |= (uint64_t)(l.sn2 == 255 ? 3 : l.sn2 & 3) << 36;
+	for(byte i=0;i<5;i++) r.b[i] = v >> (i*8);
+	r.b[5] = log_record_crc(r, seq);
+}
+
+static bool log_read_record(File& file, uint32_t seq, uint32_t base, LogStruct& data) {
+	LogRecord r;
+	if(file.read(r.b, sizeof(r)) != sizeof(r) || r.b[5] != log_record_crc(r, seq)) return false;
+	uint64_t v = 0;
+	for(byte i=0;i<5;i++) v |= (uint64_t)r.b[i] << (i*8);
+	data.tstamp = base + (v & LOG_DELTA_MAX);
+	data.status = (v >> 24) & 7;
+	data.dist = (v >> 27) & 511;
+	data.sn2 = (v >> 36) & 3;
+	if(data.sn2 == 3) data.sn2 = 255;
+	return true;
+}
+
+// finds the head segment and the next sequence number by scanning the segments
+void OpenGarage::log_setup() {
+	char name[16];
+	bool found = false;
+	log_head = 0;
+	for(byte i=0;i<LOG_SEGMENTS;i++) {
+		log_seg_first[i] = 0;
+		sprintf(name, LOG_SEG_FNAME, i);
+		File file = FILESYS.open(name, "r");
+		if(!file) continue;
+		LogSegHeader h;
+		if(file.read((uint8_t*)&h, sizeof(h)) == sizeof(h) && h.magic == LOG_SEG_MAGIC && h.version == LOG_SEG_VERSION && h.first_seq) {
+			log_seg_first[i] = h.first_seq;
+			log_seg_base[i] = h.base_tstamp;
+			if(!found || h.first_seq > log_seg_first[log_head]) log_head = i;
+			found = true;
+		}
+		file.close();
+	}
+	if(!found) {
+		log_flushed_seq = 1;
+		log_import_legacy();
+		log_next_seq = log_flushed_seq;
+		log_cache_fill();
+		return;
+	}
+	// going back from the head in ring order, each segment must end where the next one starts;
+	// the rest is left over from an interrupted rotation
+	uint32_t head_first = log_seg_first[log_head];
+	uint32_t next_first = head_first;
+	for(byte i=1;i<LOG_SEGMENTS;i++) {
+		byte seg = (log_head+LOG_SEGMENTS-i) % LOG_SEGMENTS;
+		uint32_t first = log_seg_first[seg];
+		if(!first || first >= next_first || next_first-first > LOG_SEG_RECORDS) {
+			for(;i<LOG_SEGMENTS;i++) log_seg_first[(log_head+LOG_SEGMENTS-i) % LOG_SEGMENTS] = 0;
+			break;
 		}
-		// fill log file
-		uint next = curr+1;
-		file.write((const byte*)&next, sizeof(next));
-		file.write((const byte*)&data, sizeof(LogStruct));
+		next_first = first;
+	}
+	// count the intact records of the head segment and cut off a torn one
+	sprintf(name, LOG_SEG_FNAME, log_head);
+	File file = FILESYS.open(name, "r+");
+	uint32_t seq = head_first;
+	LogStruct l;
+	file.seek(sizeof(LogSegHeader), SeekSet);
+	while(seq-head_first < LOG_SEG_RECORDS && log_read_record(file, seq, log_seg_base[log_head], l)) seq++;
+	size_t good = sizeof(LogSegHeader) + (seq-head_first)*sizeof(LogRecord);
+	if(file.size() > good) {
+		DEBUG_PRINTLN(F("log: dropped torn record"));
+		file.truncate(good);
+	}
+	file.close();
+	log_next_seq = log_flushed_seq = seq;
+	DEBUG_PRINT(F("log: next record "));
+	DEBUG_PRINTLN(log_next_seq);
+	log_cache_fill();
+}
+
+// loads the newest records from flash into the cache
+void OpenGarage::log_cache_fill() {
+	log_cache_count = 0;
+	uint32_t first = log_first_seq();
+	if(log_next_seq-first > LOG_CACHE_SIZE) first = log_next_seq-LOG_CACHE_SIZE;
+	for(uint32_t seq=first;seq<log_next_seq;seq++) {
+		LogStruct &l = log_cache[seq % LOG_CACHE_SIZE];
+		if(!log_seek(seq) || !log_read_record(log_file, seq, log_seg_base[log_read_seg], l)) l.tstamp = 0;
+	}
+	read_log_end();
+	log_cache_count = log_next_seq-first;
+}
+
+// copies the ring of /log2.dat, oldest first
+void OpenGarage::log_import_legacy() {
+	File old = FILESYS.open(log_fname, "r");
+	if(!old) return;
+	uint32_t curr;
+	uint lsz = ival(OPTION_LSZ);
+	if(lsz > 500) lsz = 500;  // the old size limit
+	if(old.read((uint8_t*)&curr, sizeof(curr)) == sizeof(curr) && curr < lsz) {
+		File file;
+		LegacyLogStruct o;
 		LogStruct l;
-		l.tstamp = 0;
-		for(;next<MAX_LOG_SIZE;next++) {  // pre-fill the log file to maximum size
-			file.write((const byte*)&l, sizeof(LogStruct));
+		for(uint i=0;i<lsz;i++) {
+			old.seek(sizeof(curr) + ((curr+i)%lsz)*sizeof(LegacyLogStruct), SeekSet);
+			if(old.read((uint8_t*)&o, sizeof(o)) != sizeof(o) || !o.tstamp) continue;
+			l.tstamp = o.tstamp;
+			l.status = o.status;
+			l.dist = o.dist;
+			l.sn2 = o.sn2;
+			log_append(file, &l, 1);
 		}
+		if(file) file.close();
+	}
+	old.close();
+	FILESYS.remove(log_fname);
+	DEBUG_PRINT(F("log: imported records "));
+	DEBUG_PRINTLN(log_flushed_seq-1);
+}
+
+// opens the head segment for appending, starting a new segment when it is full or tstamp is out of its range
+bool OpenGarage::log_open_head(File& file, ulong tstamp) {
+	char name[16];
+	if(!log_seg_first[log_head] || log_flushed_seq-log_seg_first[log_head] >= LOG_SEG_RECORDS ||
+	   !log_fits(tstamp, log_seg_base[log_head])) {
+		if(file) file.close();
+		if(log_seg_first[log_head]) log_head = (log_head+1) % LOG_SEGMENTS;
+		if(log_read_seg == log_head) read_log_end();
+		sprintf(name, LOG_SEG_FNAME, log_head);
+		file = FILESYS.open(name, "w");
+		if(!file) return false;
+		LogSegHeader h = {LOG_SEG_MAGIC, LOG_SEG_VERSION, 0, log_flushed_seq, (uint32_t)tstamp};
+		file.write((const uint8_t*)&h, sizeof(h));
+		log_seg_first[log_head] = log_flushed_seq;
+		log_seg_base[log_head] = tstamp;
+	} else if(!file) {
+		sprintf(name, LOG_SEG_FNAME, log_head);
+		file = FILESYS.open(name, "a");
+		if(!file) return false;
+	}
+	return true;
+}
+
+// writes up to n records in one go, as many as fit in the head segment; returns how many were written
+uint OpenGarage::log_append(File& file, const LogStruct* data, uint n) {
+	if(!log_open_head(file, data[0].tstamp)) return 0;
+	uint room = LOG_SEG_RECORDS - (log_flushed_seq-log_seg_first[log_head]);
+	if(n > room) n = room;
+	if(n > LOG_FLUSH_RECORDS) n = LOG_FLUSH_RECORDS;
+	LogRecord buf[LOG_FLUSH_RECORDS];
+	uint32_t base = log_seg_base[log_head];
+	for(uint i=0;i<n;i++) {
+		if(!log_fits(data[i].tstamp, base)) { n = i; break; } // goes to a new segment
+		log_encode(buf[i], log_flushed_seq+i, base, data[i]);
+	}
+	if(file.write((const uint8_t*)buf, n*sizeof(LogRecord)) != n*sizeof(LogRecord)) return 0;
+	log_flushed_seq += n;
+	return n;
+}
+
+// adds a record to the cache; it goes to flash with the next log_flush()
+void OpenGarage::write_log(const LogStruct& data) {
+	uint32_t pending = log_next_seq-log_flushed_seq;
+	if(pending >= LOG_CACHE_SIZE) {
+		DEBUG_PRINTLN(F("log: flash writes failing, record dropped"));
+		return;
+	}
+	if(!pending) log_flush_timeout = millis() + ival(OPTION_LFD)*1000UL;
+	LogStruct &l = log_cache[log_next_seq % LOG_CACHE_SIZE];
+	l = data;
+	if(l.dist > 511) l.dist = 511;  // as stored on flash
+	log_next_seq++;
+	if(log_cache_count < LOG_CACHE_SIZE) log_cache_count++;
+	if(pending+1 >= LOG_FLUSH_RECORDS) log_flush();
+}
+
+void OpenGarage::log_loop() {
+	if(log_next_seq != log_flushed_seq && (long)(millis() - log_flush_timeout) > 0) log_flush();
+}
+
+// appends all pending records to flash with one open file and as few writes as possible; failed records are retried later
+void OpenGarage::log_flush() {
+	if(log_next_seq == log_flushed_seq) return;
+	File file;
+	DEBUG_PRINTLN(F("saving log data..."));
+	while(log_flushed_seq < log_next_seq) {
+		uint pos = log_flushed_seq % LOG_CACHE_SIZE;
+		uint n = log_next_seq-log_flushed_seq;
+		if(n > LOG_CACHE_SIZE-pos) n = LOG_CACHE_SIZE-pos; // up to the end of the ring
+		if(!log_append(file, &log_cache[pos], n)) break;
+	}
+	if(file) file.close();
+	if(log_flushed_seq == log_next_seq) {
+		DEBUG_PRINTLN(F("ok"));
 	} else {
-		file = FILESYS.open(log_fname, "r+");
-		if(!file) {
-			DEBUG_PRINTLN(F("failed"));
-			return;
-		}
-		file.readBytes((char*)&curr, sizeof(curr));
-		uint next = (curr+1) % options[OPTION_LSZ].ival;
-		file.seek(0, SeekSet);
-		file.write((const byte*)&next, sizeof(next));
+		DEBUG_PRINTLN(F("failed"));
+		log_flush_timeout = millis() + ival(OPTION_LFD)*1000UL;
+	}
+}
 
-		file.seek(sizeof(curr)+curr*sizeof(LogStruct), SeekSet);
-		file.write((const byte*)&data, sizeof(LogStruct));
+// opens the segment holding seq, the newest one starting at or before it, and positions log_file at the record
+bool OpenGarage::log_seek(uint32_t seq) {
+	byte seg = LOG_SEGMENTS;
+	for(byte i=0;i<LOG_SEGMENTS;i++) {
+		uint32_t first = log_seg_first[i];
+		if(first && first <= seq && (seg == LOG_SEGMENTS || first > log_seg_first[seg])) seg = i;
 	}
-	DEBUG_PRINTLN(F("ok"));
-	file.close();
+	if(seg == LOG_SEGMENTS || seq-log_seg_first[seg] >= LOG_SEG_RECORDS) return false;
+	if(!log_file || log_read_seg != seg) {
+		char name[16];
+		read_log_end();
+		sprintf(name, LOG_SEG_FNAME, seg);
+		log_file = FILESYS.open(name, "r");
+		if(!log_file) return false;
+		log_read_seg = seg;
+	}
+	size_t pos = sizeof(LogSegHeader) + (seq-log_seg_first[seg])*sizeof(LogRecord);
+	return log_file.position() == pos || log_file.seek(pos, SeekSet);
 }
 
-bool OpenGarage::read_log_start() {
-	if(log_file) log_file.close();
-	log_file = FILESYS.open(log_fname, "r");
-	if(!log_file) return false;
-	uint curr;
-	if(log_file.readBytes((char*)&curr, sizeof(curr)) != sizeof(curr)) return false;
-	if(curr>=MAX_LOG_SIZE) return false;
-	return true;
+uint32_t OpenGarage::log_first_seq() {
+	uint32_t oldest = log_next_seq-log_cache_count;
+	for(byte i=0;i<LOG_SEGMENTS;i++) {
+		if(log_seg_first[i] && log_seg_first[i] < oldest) oldest = log_seg_first[i];
+	}
+	uint32_t lsz = ival(OPTION_LSZ);
+	return (log_next_seq-oldest > lsz) ? log_next_seq-lsz : oldest;
+}
+
+// starts reading at the oldest of the last lsz records, or at record 'from' if that is newer
+bool OpenGarage::read_log_start(uint32_t from) {
+	read_log_end();
+	log_read_seq = log_first_seq();
+	if(from > log_read_seq) log_read_seq = from;
+	return log_read_seq < log_next_seq;
 }
 
+// next intact record in sequence order; records that fail their CRC are skipped
 bool OpenGarage::read_log_next(LogStruct& data) {
-	if(!log_file) return false;
-	if(log_file.readBytes((char*)&data, sizeof(LogStruct)) != sizeof(LogStruct)) return false;
-	return true;
+	while(log_read_seq < log_next_seq) {
+		if(read_log_at(log_read_seq++, data)) return true;
+	}
+	return false;
+}
+
+// random access by sequence number; records older than the cache keep their segment open until read_log_end()
+bool OpenGarage::read_log_at(uint32_t seq, LogStruct& data) {
+	if(seq >= log_next_seq) return false;
+	if(log_next_seq-seq <= log_cache_count) {
+		data = log_cache[seq % LOG_CACHE_SIZE];
+		return data.tstamp != 0;
+	}
+	return log_seek(seq) && log_read_record(log_file, seq, log_seg_base[log_read_seg], data);
+}
+
+/* First record in [lo, hi) stamped later than tstamp, or hi if there is
+ * none. Records are appended in time order, so this is a binary search;
+ * a damaged record takes the place of the next intact one. */
+uint32_t OpenGarage::log_upper_bound(ulong tstamp, uint32_t lo, uint32_t hi) {
+	LogStruct l{};
+	while(lo < hi) {
+		uint32_t mid = lo + (hi-lo)/2;
+		uint32_t probe = mid;
+		while(probe < hi && !read_log_at(probe, l)) probe++;
+		if(probe == hi || l.tstamp > tstamp) hi = mid;
+		else lo = probe+1;
+	}
+	return lo;
 }
 
 bool OpenGarage::read_log_end() {
@@ -462,12 +1052,12 @@ void OpenGarage::play_note(uint freq) {
 }
 
 void OpenGarage::config_ip() {
-	if(options[OPTION_USI].ival) {
+	if(ival(OPTION_USI)) {
 		IPAddress dvip, gwip, subn, dns1;
-		if(dvip.fromString(options[OPTION_DVIP].sval) &&
-		   gwip.fromString(options[OPTION_GWIP].sval) &&
-		   subn.fromString(options[OPTION_SUBN].sval) &&
-		   dns1.fromString(options[OPTION_DNS1].sval)) {
+		if(dvip.fromString(sval(OPTION_DVIP)) &&
+		   gwip.fromString(sval(OPTION_GWIP)) &&
+		   subn.fromString(sval(OPTION_SUBN)) &&
+		   dns1.fromString(sval(OPTION_DNS1))) {
 			WiFi.config(dvip, gwip, subn, dns1, gwip);
 		}
 	}
@@ -32,23 +32,39 @@
 #include <EMailSender.h>
 #include "defines.h"
 
+enum {
+	OPTION_TYPE_INT = 0,
+	OPTION_TYPE_STR
+};
+
+// option name, type and limits, kept in flash; the values live in OpenGarage::ivals and svals
 struct OptionStruct {
-	String name;
-	uint ival;
-	uint max;
-	String sval;
+	char name[5];  // zero padded
+	byte type;
+	uint16_t min;  // integer options only
+	uint16_t max;  // largest value, or longest string
 };
 
 struct LogStruct {
-	ulong tstamp; // time stamp
-	uint status;  // door status
-	uint dist;    // distance
-	byte sn2;     // switch sensor value
+	ulong tstamp;  // time stamp
+	uint16_t dist; // distance
+	byte status;   // door status
+	byte sn2;      // switch sensor value
 };
 
 class OpenGarage {
 public:
-	static OptionStruct options[];
+	static const OptionStruct options[];
+	static constexpr byte option_slots[NUM_OPTIONS] = { OG_OPTIONS(OPTION_INT_ID, OPTION_STR_ID) };
+	// value of an integer or string option, e.g. ival(OPTION_DTH)
+	static uint16_t ival(byte i) { return ivals[option_slots[i]]; }
+	static const String& sval(byte i) { return svals[option_slots[i]]; }
+	// changes an option; options_save() writes the changed ones
+	static void set_ival(byte i, uint16_t v);
+	static void set_sval(byte i, const char *v);
+	static void set_sval(byte i, const String& v) { set_sval(i, v.c_str()); }
+	static void get_option(byte i, OptionStruct& o) { memcpy_P(&o, &options[i], sizeof(o)); }
+	static bool option_valid(byte i, const char *value);  // within the limits of option i
 	static byte state;
 	static byte alarm;
 	static byte alarm_action;
@@ -56,14 +72,15 @@ public:
 	static byte has_swrx;
 	static void begin();
 	static void options_setup();
-	static void options_load();
+	static bool options_load(const char *fname);
 	static void options_save();
+	static bool options_import_legacy();
 	static void options_reset();
-	static void restart() { ESP.restart();}
+	static void restart() { ESP.restart();}  // also a ticker callback: no file I/O here
 	static uint read_distance(); // centimeter
 	static void init_sensors(); // initialize all sensor
 	static void read_TH_sensor(float& C, float &H);
-	static byte get_mode()   { return options[OPTION_MOD].ival; }
+	static byte get_mode()   { return ival(OPTION_MOD); }
 	static byte get_button() { return digitalRead(PIN_BUTTON); }
 	static byte get_switch() { pinMode(PIN_SWITCH, INPUT_PULLUP); return digitalRead(PIN_SWITCH); }
 	static byte get_led()    { return led_reverse?(!digitalRead(PIN_LED)):digitalRead(PIN_LED); }
@@ -71,31 +88,59 @@ public:
 	static void set_relay(byte status) { digitalWrite(PIN_RELAY, status); }
 	static void click_relay() {
 		set_relay(HIGH);
-		delay(options[OPTION_CDT].ival);
+		delay(ival(OPTION_CDT));
 		set_relay(LOW);
 	}
-	static int find_option(String name);
+	static int find_option(const char *name);
+	static void log_setup();
+	static void log_loop();
+	static void log_flush();
 	static void log_reset();
 	static void write_log(const LogStruct& data);
-	static bool read_log_start();
+	static bool read_log_start(uint32_t from=0);
 	static bool read_log_next(LogStruct& data);
 	static bool read_log_end();
+	static uint32_t log_first_seq();   // oldest of the last lsz records
+	static uint32_t log_end_seq() { return log_next_seq; }
+	static bool read_log_at(uint32_t seq, LogStruct& data);
+	static uint32_t log_upper_bound(ulong tstamp, uint32_t lo, uint32_t hi);
 	static void play_note(uint freq);
 	static void set_alarm(byte ov=0, byte action=ACTION_TOGGLE) { // ov = override value //action (0: toggle, 1: close, 2: open)
 		if(ov) alarm = ov*10+1;
-		else alarm = options[OPTION_ALM].ival * 10 + 1;
+		else alarm = ival(OPTION_ALM) * 10 + 1;
 		alarm_action = action;
 	}
 	static void reset_alarm() { alarm = 0; alarm_action = 0; }
 	static void reset_to_ap() {
-		options[OPTION_MOD].ival = OG_MOD_AP;
+		set_ival(OPTION_MOD, OG_MOD_AP);
 		options_save();
+		log_flush();
 		restart();
 	}
 	static void config_ip();
 	static void play_startup_tune();
 	private:
+	static uint16_t ivals[NUM_INT_OPTIONS];
+	static String svals[NUM_STR_OPTIONS];
+	static byte options_dirty[(NUM_OPTIONS+7)/8]; // changed since the last save
+	static void options_write_all();
+	static bool options_replay();
 	static File log_file;
+	static uint32_t log_seg_first[LOG_SEGMENTS]; // sequence number of the first record per segment, 0 if unused
+	static uint32_t log_seg_base[LOG_SEGMENTS];  // time stamp the records of a segment are relative to
+	static uint32_t log_next_seq;  // sequence number of the next record written
+	static uint32_t log_flushed_seq; // sequence number of the next record written to flash
+	static LogStruct log_cache[LOG_CACHE_SIZE]; // ring of the newest records by sequence number, tstamp 0 if unreadable
+	static byte log_cache_count;
+	static ulong log_flush_timeout;
+	static uint32_t log_read_seq;  // next record read_log_next() returns
+	static byte log_head;          // segment being appended to
+	static byte log_read_seg;      // segment open in log_file
+	static bool log_open_head(File& file, ulong tstamp);
+	static uint log_append(File& file, const LogStruct* data, uint n);
+	static bool log_seek(uint32_t seq);
+	static void log_cache_fill();
+	static void log_import_legacy();
 	static void button_handler();
 	static void led_handler();
 
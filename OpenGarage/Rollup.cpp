@@ -0,0 +1,311 @@
+/* OpenGarage Firmware
+ *
+ * Usage statistics
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <FS.h>
+#include "Rollup.h"
+
+struct RollupTier {
+	const char *fname;
+	const char *tmp_fname;
+	uint32_t period;
+	uint16_t count;
+};
+
+static const RollupTier tiers[NUM_ROLLUP_TIERS] = {
+	{ROLLUP_HOUR_FNAME, ROLLUP_HOUR_TMP_FNAME, 3600, ROLLUP_HOURS},
+	{ROLLUP_DAY_FNAME, ROLLUP_DAY_TMP_FNAME, 86400, ROLLUP_DAYS}
+};
+
+struct __attribute__((packed)) RollupFileHeader {
+	uint16_t magic;    // ROLLUP_MAGIC
+	uint8_t  version;  // ROLLUP_VERSION
+	uint8_t  reserved;
+	uint32_t period;
+	uint16_t count;
+	uint16_t reserved2;
+};
+
+static RollupBucket cur[NUM_ROLLUP_TIERS];
+static byte vehicle_secs[NUM_ROLLUP_TIERS];  // not yet counted in vehicle_mins
+static ulong last_update = 0;  // 0 until the first update with a valid time
+static ulong open_since = 0;   // 0 while the door is closed
+
+static size_t record_pos(size_t i) {
+	return sizeof(RollupFileHeader) + i * sizeof(RollupBucket);
+}
+
+static size_t num_records(File &file) {
+	size_t size = file.size();
+	return size > sizeof(RollupFileHeader) ? (size - sizeof(RollupFileHeader)) / sizeof(RollupBucket) : 0;
+}
+
+static bool write_header(File &file, byte tier) {
+	RollupFileHeader h = {ROLLUP_MAGIC, ROLLUP_VERSION, 0, tiers[tier].period, tiers[tier].count, 0};
+	return file.write((const uint8_t*)&h, sizeof(h)) == sizeof(h);
+}
+
+// creates the file of a tier without any buckets
+static void create_file(byte tier) {
+	File file = FILESYS.open(tiers[tier].fname, "w");
+	if(!file) return;
+	write_header(file, tier);
+	file.close();
+}
+
+/* Rewrites the file of a tier with only its newest count buckets. Runs once
+ * every count appends, through a temporary file that rollup_setup() finishes
+ * or drops if power is lost half way. */
+static void compact_file(byte tier) {
+	const RollupTier &t = tiers[tier];
+	File in = FILESYS.open(t.fname, "r");
+	if(!in) return;
+	File out = FILESYS.open(t.tmp_fname, "w");
+	bool ok = out && write_header(out, tier);
+	size_t n = num_records(in);
+	if(ok) ok = in.seek(record_pos(n > t.count ? n - t.count : 0), SeekSet);
+	uint8_t buf[10*sizeof(RollupBucket)];
+	size_t len;
+	while(ok && (len = in.read(buf, sizeof(buf))) > 0) ok = out.write(buf, len) == len;
+	in.close();
+	if(out) out.close();
+	if(ok) {
+		FILESYS.remove(t.fname);
+		FILESYS.rename(t.tmp_fname, t.fname);
+	} else {
+		FILESYS.remove(t.tmp_fname);
+	}
+}
+
+/* Appends a bucket to the file of a tier. Buckets are only ever added at the
+ * end, so a period saved before a restart may be followed by a later copy of
+ * itself; readers keep the newest one. */
+static void append_bucket(byte tier, const RollupBucket &b) {
+	File file = FILESYS.open(tiers[tier].fname, "a");
+	if(!file) return;
+	file.write((const uint8_t*)&b, sizeof(b));
+	size_t n = num_records(file);
+	file.close();
+	if(n >= 2*(size_t)tiers[tier].count) compact_file(tier);
+}
+
+// reads the last bucket of a tier if it is for the period beginning at start
+static bool read_last(byte tier, uint32_t start, RollupBucket &b) {
+	File file = FILESYS.open(tiers[tier].fname, "r");
+	if(!file) return false;
+	size_t n = num_records(file);
+	bool ok = n && file.seek(record_pos(n-1), SeekSet) && file.read((uint8_t*)&b, sizeof(b)) == sizeof(b) && b.start == start;
+	file.close();
+	return ok;
+}
+
+static void start_bucket(byte tier, uint32_t start) {
+	RollupBucket &b = cur[tier];
+	memset(&b, 0, sizeof(b));
+	b.start = start;
+	b.tmin = ROLLUP_NO_TEMP;
+	b.tmax = ROLLUP_NO_TEMP;
+	vehicle_secs[tier] = 0;
+}
+
+// adds the interval [from, to) to the current bucket of a tier
+static void add_time(byte tier, ulong from, ulong to, bool door_open, bool vehicle) {
+	if(to <= from) return;
+	RollupBucket &b = cur[tier];
+	ulong dt = to - from;
+	if(door_open) b.open_secs += dt;
+	if(vehicle) {
+		dt += vehicle_secs[tier];
+		b.vehicle_mins += dt / 60;
+		vehicle_secs[tier] = dt % 60;
+	}
+}
+
+// adds the buckets of two periods, e.g. the hours of a day
+static void merge_bucket(RollupBucket &d, const RollupBucket &b) {
+	d.opens += b.opens;
+	d.open_secs += b.open_secs;
+	if(b.max_open > d.max_open) d.max_open = b.max_open;
+	d.vehicle_mins += b.vehicle_mins;
+	if(b.tmin != ROLLUP_NO_TEMP && (d.tmin == ROLLUP_NO_TEMP || b.tmin < d.tmin)) d.tmin = b.tmin;
+	if(b.tmax != ROLLUP_NO_TEMP && (d.tmax == ROLLUP_NO_TEMP || b.tmax > d.tmax)) d.tmax = b.tmax;
+}
+
+template <typename F>
+static uint32_t for_each_bucket(byte tier, uint n, uint32_t before, F fn);
+
+// stores the current bucket and moves on to the one holding now
+static void close_bucket(byte tier, ulong end, ulong now) {
+	RollupBucket &b = cur[tier];
+	if(open_since && end - open_since > b.max_open) b.max_open = end - open_since;
+	append_bucket(tier, b);
+	ulong start = now - now % tiers[tier].period;
+	start_bucket(tier, start > end ? start : end);
+}
+
+void rollup_setup() {
+	for(byte i=0;i<NUM_ROLLUP_TIERS;i++) {
+		const RollupTier &t = tiers[i];
+		if(FILESYS.exists(t.tmp_fname)) {  // a compaction was cut short
+			if(FILESYS.exists(t.fname)) FILESYS.remove(t.tmp_fname);
+			else FILESYS.rename(t.tmp_fname, t.fname);
+		}
+		RollupFileHeader h;
+		File file = FILESYS.open(t.fname, "r");
+		bool ok = file && file.read((uint8_t*)&h, sizeof(h)) == sizeof(h) && h.magic == ROLLUP_MAGIC &&
+		          h.version == ROLLUP_VERSION && h.period == t.period && h.count == t.count;
+		if(file) file.close();
+		if(!ok) create_file(i);
+		cur[i].start = 0;
+	}
+	last_update = 0;
+	open_since = 0;
+}
+
+void rollup_update(ulong now, bool door_open, bool vehicle, const float *temp) {
+	if(now < NTP_VALID_TIME) return;
+	if(!last_update || now < last_update) {  // first valid time, or the clock went back
+		ulong hour = now - now % tiers[ROLLUP_HOURLY].period;
+		ulong day = now - now % tiers[ROLLUP_DAILY].period;
+		if(read_last(ROLLUP_HOURLY, hour, cur[ROLLUP_HOURLY])) vehicle_secs[ROLLUP_HOURLY] = 0;  // saved before a restart
+		else start_bucket(ROLLUP_HOURLY, hour);
+		// the day so far is summed up from its hours rather than written every hour
+		start_bucket(ROLLUP_DAILY, day);
+		last_update = now;
+		for_each_bucket(ROLLUP_HOURLY, 24, 0, [&](const RollupBucket &b) {
+			if(b.start >= day) merge_bucket(cur[ROLLUP_DAILY], b);
+		});
+		open_since = door_open ? now : 0;
+	}
+	bool was_open = open_since != 0;
+	for(byte i=0;i<NUM_ROLLUP_TIERS;i++) {
+		ulong from = last_update;
+		for(;;) {
+			ulong end = cur[i].start + tiers[i].period;
+			if(now < end) {
+				add_time(i, from, now, was_open, vehicle);
+				break;
+			}
+			add_time(i, from, end, was_open, vehicle);
+			close_bucket(i, end, now);
+			from = cur[i].start;
+		}
+	}
+	if(door_open && !was_open) {
+		open_since = now;
+		for(byte i=0;i<NUM_ROLLUP_TIERS;i++) cur[i].opens++;
+	} else if(!door_open && was_open) {
+		for(byte i=0;i<NUM_ROLLUP_TIERS;i++) {
+			if(now - open_since > cur[i].max_open) cur[i].max_open = now - open_since;
+		}
+		open_since = 0;
+	}
+	if(temp && !isnan(*temp)) {
+		int16_t t = (int16_t)lroundf(*temp * 10);
+		for(byte i=0;i<NUM_ROLLUP_TIERS;i++) {
+			RollupBucket &b = cur[i];
+			if(b.tmin == ROLLUP_NO_TEMP || t < b.tmin) b.tmin = t;
+			if(b.tmax == ROLLUP_NO_TEMP || t > b.tmax) b.tmax = t;
+		}
+	}
+	last_update = now;
+}
+
+// writes the current hour, e.g. before a restart; the day is summed up again from its hours
+void rollup_save() {
+	if(!last_update) return;
+	append_bucket(ROLLUP_HOURLY, cur[ROLLUP_HOURLY]);
+}
+
+void rollup_reset() {
+	for(byte i=0;i<NUM_ROLLUP_TIERS;i++) FILESYS.remove(tiers[i].fname);
+	rollup_setup();
+}
+
+/* Calls fn for up to n buckets older than before (any if 0), newest first:
+ * the current one from RAM, then the file read backwards. Of several copies
+ * of a period only the newest counts. Returns the start of the last bucket
+ * given if older ones follow, 0 otherwise. */
+template <typename F>
+static uint32_t for_each_bucket(byte tier, uint n, uint32_t before, F fn) {
+	if(tier >= NUM_ROLLUP_TIERS || !last_update || !n) return 0;
+	const RollupTier &t = tiers[tier];
+	uint32_t oldest = cur[tier].start - (t.count-1)*t.period;
+	uint32_t newest = before ? before : UINT32_MAX;  // only older buckets follow
+	uint given = 0;
+	if(cur[tier].start < newest) {
+		fn(cur[tier]);
+		given++;
+		newest = cur[tier].start;
+	}
+	File file = FILESYS.open(t.fname, "r");
+	if(!file) return 0;
+	bool more = false;
+	RollupBucket b;
+	for(size_t i=num_records(file);i--;) {
+		if(!file.seek(record_pos(i), SeekSet) || file.read((uint8_t*)&b, sizeof(b)) != sizeof(b)) break;
+		if(b.start >= newest) continue;  // an older copy, or written before the clock went back
+		if(b.start < oldest) break;
+		if(given == n) {
+			more = true;
+			break;
+		}
+		fn(b);
+		given++;
+		newest = b.start;
+	}
+	file.close();
+	return more ? newest : 0;
+}
+
+static void print_temp(Print &out, int16_t t) {
+	if(t == ROLLUP_NO_TEMP) out.print(F("null"));
+	else out.print(t);
+}
+
+uint32_t rollup_print_json(Print &out, byte tier, uint n, uint32_t before) {
+	bool first = true;
+	return for_each_bucket(tier, n, before, [&](const RollupBucket &b) {
+		if(!first) out.print(',');
+		first = false;
+		out.print('[');
+		out.print(b.start);
+		out.print(',');
+		out.print(b.opens);
+		out.print(',');
+		out.print(b.open_secs);
+		out.print(',');
+		out.print(b.max_open);
+		out.print(',');
+		out.print(b.vehicle_mins);
+		out.print(',');
+		print_temp(out, b.tmin);
+		out.print(',');
+		print_temp(out, b.tmax);
+		out.print(']');
+	});
+}
+
+uint32_t rollup_write_binary(Print &out, byte tier, uint n, uint32_t before) {
+	return for_each_bucket(tier, n, before, [&](const RollupBucket &b) {
+		out.write((const uint8_t*)&b, sizeof(b));
+	});
+}
@@ -0,0 +1,61 @@
+/* OpenGarage Firmware
+ *
+ * Usage statistics header file
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ROLLUP_H
+#define _ROLLUP_H
+
+#include <Arduino.h>
+#include "defines.h"
+
+/** Door usage summed up per hour and per day (UTC). Each tier is a file
+ *  that completed periods are appended to, and that is cut back to its
+ *  newest buckets once it holds twice as many, so months of history take
+ *  bounded flash and two buckets of RAM. The current buckets are updated on
+ *  every status check; an hour is written when it ends, a day when it ends. */
+enum {
+	ROLLUP_HOURLY = 0,
+	ROLLUP_DAILY,
+	NUM_ROLLUP_TIERS
+};
+
+struct __attribute__((packed)) RollupBucket {
+	uint32_t start;        // UTC time the period begins, 0 if the slot is unused
+	uint32_t open_secs;    // total time the door was open
+	uint32_t max_open;     // longest time the door stayed open, in seconds
+	uint16_t opens;        // number of times the door opened
+	uint16_t vehicle_mins; // minutes a vehicle was detected
+	int16_t  tmin;         // lowest temperature in 0.1 C, ROLLUP_NO_TEMP if none
+	int16_t  tmax;         // highest temperature in 0.1 C
+};
+
+#define ROLLUP_NO_TEMP  INT16_MIN
+
+void rollup_setup();
+void rollup_update(ulong now, bool door_open, bool vehicle, const float *temp);
+void rollup_save();
+void rollup_reset();
+// newest first, at most n buckets older than before (any if 0), skipping periods without data;
+// return the start of the last bucket written if older ones follow, 0 otherwise
+uint32_t rollup_print_json(Print &out, byte tier, uint n, uint32_t before);
+uint32_t rollup_write_binary(Print &out, byte tier, uint n, uint32_t before);
+
+#endif  // _ROLLUP_H
@@ -2,6 +2,7 @@
 import { promises as fs } from "fs";
 import path from "path";
 import zlib from "zlib";
+import crypto from "crypto";
 import { minify } from "html-minifier-terser";
 
 const WEB_DIR = path.resolve("html");        // <-- adjust if needed
@@ -19,11 +20,55 @@ const MINIFY_OPTIONS = {
   decodeEntities: true,
 };
 
+// URL paths of the pages; any other page is served at /<name>.html
+const ROUTES = {
+  "ap_home.html":     "/",
+  "ap_update.html":   "/update",
+  "sta_home.html":    "/",
+  "sta_logs.html":    "/vl",
+  "sta_options.html": "/vo",
+  "sta_update.html":  "/update",
+};
+// ap_ pages are served in AP mode, sta_ pages in station mode
+const MODES = [["ap_", "AP_ASSETS"], ["sta_", "STA_ASSETS"]];
+
+// Libraries the pages used to load from the CDN, served from flash as one
+// bundle per type so the pages work without internet access. Paths are
+// relative to CDN_URL and to html/vendor. A build never downloads them:
+// `node compress_htmls.mjs --fetch-vendor` fetches the missing files and
+// pins their SHA-256 in html/vendor/SHA256SUMS, to be committed with them.
+// A vendor file that is not pinned or does not match fails the build, and so
+// does a missing one unless --allow-cdn is given: the pages then keep their
+// CDN tags and htmls.h carries a #warning so that no firmware build misses it.
+const CDN_URL   = "https://code.jquery.com/";
+const VENDOR_DIR = path.resolve("html/vendor");
+const SUMS_FILE  = path.join(VENDOR_DIR, "SHA256SUMS");
+const FETCH_VENDOR = process.argv.includes("--fetch-vendor");
+const ALLOW_CDN = process.argv.includes("--allow-cdn");
+const BUNDLES = [
+  { ext: "css", parts: ["mobile/1.3.1/jquery.mobile-1.3.1.min.css"] },
+  { ext: "js",  parts: ["jquery-1.9.1.min.js", "mobile/1.3.1/jquery.mobile-1.3.1.min.js"] },
+];
+
+// shared files are served at /s/<content hash>.<ext> and never change
+const STATIC_TYPES = {
+  css: "text/css",
+  js:  "application/javascript",
+  svg: "image/svg+xml",
+  png: "image/png",
+  gif: "image/gif",
+};
+// Gzip window; clients that accept neither gzip nor Brotli get the gzip
+// data inflated on the controller, which needs a window of this size in
+// RAM (ASSET_WINDOW_BITS in defines.h must match)
+const GZIP_WINDOW_BITS = 13;
+const DATA_URI = /data:image\/(svg\+xml|png|gif);base64,([A-Za-z0-9+\/=]+)/g;
+
 function toCIdent(name) {
   return name.replace(/[^a-zA-Z0-9_]/g, "_").replace(/^(\d)/, "_$1");
 }
 function toPathKey(file) {
-  return "/" + path.basename(file);
+  return ROUTES[file] || "/" + path.basename(file).replace(/^(ap|sta)_/, "");
 }
 function chunkBytes(arr, per = 16) {
   const out = [];
@@ -34,6 +79,160 @@ function chunkBytes(arr, per = 16) {
   return out.join(",\n  ");
 }
 
+// gzip for every client, and Brotli where it is smaller; null where a
+// variant does not pay off
+function compress(buf) {
+  const gz = zlib.gzipSync(buf, { level: 9, windowBits: GZIP_WINDOW_BITS });
+  const br = zlib.brotliCompressSync(buf, { params: {
+    [zlib.constants.BROTLI_PARAM_QUALITY]: zlib.constants.BROTLI_MAX_QUALITY,
+    [zlib.constants.BROTLI_PARAM_SIZE_HINT]: buf.length,
+  } });
+  const smallest = Math.min(gz.length, buf.length);
+  return { gz: gz.length < buf.length ? gz : null, br: br.length < smallest ? br : null };
+}
+
+// size comparison, printed at the end
+const sizes = [];
+
+function emitBlob(ident, comment, data) {
+  return `
+// ${comment}
+const uint8_t ${ident}[] PROGMEM __attribute__((aligned(4))) = {
+  ${chunkBytes([...data])}
+};
+const size_t ${ident}_len = ${data.length};
+`;
+}
+
+function contentHash(buf) {
+  return crypto.createHash("sha256").update(buf).digest("hex").slice(0, 16);
+}
+
+// pinned digests by vendor path, in sha256sum format
+let vendorSums = null;
+let sumsChanged = false;
+async function loadSums() {
+  if (vendorSums) return vendorSums;
+  vendorSums = new Map();
+  let text = "";
+  try {
+    text = await fs.readFile(SUMS_FILE, "utf8");
+  } catch {}
+  for (const line of text.split("\n")) {
+    const m = line.match(/^([0-9a-f]{64}) [ *](.+)$/);
+    if (m) vendorSums.set(m[2], m[1]);
+  }
+  return vendorSums;
+}
+async function saveSums() {
+  if (!sumsChanged) return;
+  const lines = [...vendorSums].sort(([a], [b]) => a.localeCompare(b)).map(([rel, d]) => `${d}  ${rel}\n`);
+  await fs.writeFile(SUMS_FILE, lines.join(""));
+}
+
+// only with --fetch-vendor; any failure stops the script
+async function downloadVendor(rel, file) {
+  const res = await fetch(CDN_URL + rel, { signal: AbortSignal.timeout(30000) });
+  if (!res.ok) throw new Error(`cannot download ${CDN_URL + rel}: HTTP ${res.status}`);
+  const buf = Buffer.from(await res.arrayBuffer());
+  await fs.mkdir(path.dirname(file), { recursive: true });
+  await fs.writeFile(file, buf);
+  console.log(`Downloaded ${CDN_URL + rel}`);
+  return buf;
+}
+
+// a vendor file from html/vendor, checked against its pinned digest; null if absent
+async function vendorFile(rel) {
+  const sums = await loadSums();
+  const file = path.join(VENDOR_DIR, rel);
+  let buf = null;
+  try {
+    buf = await fs.readFile(file);
+  } catch {}
+  if (!buf && FETCH_VENDOR) buf = await downloadVendor(rel, file);
+  if (!buf) {
+    if (!ALLOW_CDN) throw new Error(`no html/vendor/${rel}, run: node compress_htmls.mjs --fetch-vendor (or --allow-cdn to keep loading it from ${CDN_URL})`);
+    console.warn(`WARNING: no html/vendor/${rel}, run: node compress_htmls.mjs --fetch-vendor`);
+    return null;
+  }
+  const digest = crypto.createHash("sha256").update(buf).digest("hex");
+  const pinned = sums.get(rel);
+  if (!pinned && FETCH_VENDOR) {
+    sums.set(rel, digest);
+    sumsChanged = true;
+    console.log(`Pinned ${rel} ${digest}`);
+  } else if (pinned !== digest) {
+    throw new Error(`html/vendor/${rel}: SHA-256 ${digest} does not match ${pinned ? "the pinned " + pinned : "any entry"} in html/vendor/SHA256SUMS`);
+  }
+  return buf;
+}
+
+// shared files, deduplicated by content
+const statics = new Map();
+function addStatic(buf, ext) {
+  const hash = contentHash(buf);
+  const key = `/s/${hash}.${ext}`;
+  if (!statics.has(key)) {
+    const { gz, br } = compress(buf);
+    const data = gz || buf;  // images are often compressed already
+    statics.set(key, { path: key, ext, raw: buf.length, data, gzip: !!gz, br, hash: contentHash(data),
+                       ident: `static_${hash}_${ext}`, uses: [] });
+  }
+  return key;
+}
+
+// builds the bundles; returns a map from CDN path to bundle path
+async function buildBundles() {
+  const links = {};
+  for (const b of BUNDLES) {
+    const bufs = [];
+    const uses = new Set();
+    for (const rel of b.parts) {
+      let buf = await vendorFile(rel);
+      if (buf && b.ext === "css") buf = await inlineCssUrls(buf.toString("utf8"), rel, uses);
+      bufs.push(buf);
+    }
+    if (bufs.includes(null)) {
+      console.warn(`WARNING: no .${b.ext} bundle, pages keep loading ${b.parts.join(", ")} from ${CDN_URL}`);
+      continue;
+    }
+    const key = addStatic(Buffer.concat(bufs.flatMap(buf => [buf, Buffer.from("\n")])), b.ext);
+    statics.get(key).uses = [...uses];
+    for (const rel of b.parts) links[rel] = key;
+  }
+  await saveSums();
+  return links;
+}
+
+// moves the images a stylesheet refers to into shared files
+async function inlineCssUrls(css, rel, uses) {
+  const base = path.posix.dirname(rel);
+  let out = "";
+  let last = 0;
+  for (const m of css.matchAll(/url\(\s*["']?([^"')]+?\.(png|gif|svg))["']?\s*\)/g)) {
+    const buf = await vendorFile(path.posix.join(base, m[1]));
+    if (!buf) return null;
+    const key = addStatic(buf, m[2]);
+    uses.add(key);
+    out += css.slice(last, m.index) + `url(${key})`;
+    last = m.index + m[0].length;
+  }
+  return Buffer.from(out + css.slice(last), "utf8");
+}
+
+// points the CDN tags of a page at the bundles, one tag per bundle
+function linkBundles(html, links) {
+  const seen = new Set();
+  return html.replace(/<(link|script)\b[^>]*?(?:href|src)=["']?(?:https?:)?\/\/code\.jquery\.com\/([^"' >]+)[^>]*>(<\/script>)?/g,
+    (tag, kind, rel) => {
+      const key = links[rel];
+      if (!key) return tag;
+      if (seen.has(key)) return "";
+      seen.add(key);
+      return kind === "link" ? `<link rel="stylesheet" href="${key}">` : `<script src="${key}"></script>`;
+    });
+}
+
 async function main() {
   console.log("--------------------------------------------------");
   console.log("OpenGarage HTML Compressor");
@@ -49,23 +248,39 @@ async function main() {
   let headerBody = `#pragma once
 #include <Arduino.h>
 
+// everything, including the strings, is in flash
 typedef struct {
-  const char* path;
-  const uint8_t* data;
-  const size_t len;
+  const char* path;     // URL path
+  const uint8_t* data;  // 4-byte aligned
+  size_t len;
+  const char* hash;     // content hash, 16 hex digits
   const char* contentType;
-  const char* contentEncoding;
+  const char* contentEncoding;  // NULL if the data is not compressed
+  const char* cacheControl;
+  const uint8_t* br;    // Brotli variant, NULL if it would not be smaller
+  size_t brLen;
 } GzAsset;
 
+static const char asset_type_html[] PROGMEM = "text/html; charset=utf-8";
+static const char asset_encoding_gzip[] PROGMEM = "gzip";
+static const char asset_encoding_br[] PROGMEM = "br";
+static const char asset_cache_page[] PROGMEM = "public, max-age=86400";
+static const char asset_cache_static[] PROGMEM = "public, max-age=31536000, immutable";
 `;
+  const links = await buildBundles();
+  const cdn = BUNDLES.flatMap(b => b.parts).filter(rel => !links[rel]);
+  if (cdn.length) {
+    headerBody += `#warning "htmls.h was built without html/vendor: the pages load ${cdn.join(", ")} from ${CDN_URL}"\n`;
+  }
 
   for (const fname of files) {
     const inPath = path.join(WEB_DIR, fname);
     const raw = await fs.readFile(inPath, "utf8");
     const origSize = Buffer.byteLength(raw, "utf8");
 
-    const minified = await minify(raw, MINIFY_OPTIONS);
-    const gz = zlib.gzipSync(Buffer.from(minified, "utf8"), { level: 9 });
+    const minified = (await minify(linkBundles(raw, links), MINIFY_OPTIONS))
+      .replace(DATA_URI, (uri, type, b64) => addStatic(Buffer.from(b64, "base64"), type.replace("+xml", "")));
+    const { gz, br } = compress(Buffer.from(minified, "utf8"));
     const gzSize = gz.length;
 
     totalOrig += origSize;
@@ -76,26 +291,51 @@ typedef struct {
 
     const ident = toCIdent(path.basename(fname, ".html")) + "_html_gz";
     const keyPath = toPathKey(fname);
+    const hash = contentHash(gz);
 
-    headerBody += `
-// ${fname} (minified+gz, ${gz.length} bytes)
-const uint8_t ${ident}[] PROGMEM = {
-  ${chunkBytes([...gz])}
-};
-const size_t ${ident}_len = ${gz.length};
+    headerBody += emitBlob(ident, `${fname} (minified+gz, ${gz.length} bytes)`, gz);
+    if (br) headerBody += emitBlob(`${ident}_br`, `${fname} (minified+br, ${br.length} bytes)`, br);
+    headerBody += `static const char ${ident}_path[] PROGMEM = "${keyPath}";
+static const char ${ident}_hash[] PROGMEM = "${hash}";
 
 `;
+    sizes.push({ name: keyPath + (fname.startsWith("ap_") ? " (AP)" : ""), raw: Buffer.byteLength(minified), gz: gzSize, br: br && br.length });
 
-    items.push({ path: keyPath, ident, lenIdent: `${ident}_len` });
+    items.push({ fname, path: keyPath, ident, lenIdent: `${ident}_len`, type: "asset_type_html",
+                 encoding: "asset_encoding_gzip", cache: "asset_cache_page", size: gzSize, br: !!br,
+                 uses: [...new Set(minified.match(/\/s\/[0-9a-f]{16}\.[a-z]+/g) || [])] });
   }
 
-  // output asset
-  /*headerBody += `\nstatic const GzAsset HTML_ASSETS[] PROGMEM = {\n`;
-  for (const it of items) {
-    headerBody += `  { "${it.path}", ${it.ident}, ${it.lenIdent}, "text/html; charset=utf-8", "gzip" },\n`;
+  // shared files, served in both modes
+  for (const ext of new Set([...statics.values()].map(st => st.ext))) {
+    headerBody += `static const char asset_type_${ext}[] PROGMEM = "${STATIC_TYPES[ext]}";\n`;
+  }
+  const shared = [];
+  for (const st of statics.values()) {
+    headerBody += emitBlob(st.ident, `${st.path} (${st.raw} bytes${st.gzip ? ", gz" : ""})`, st.data);
+    if (st.br) headerBody += emitBlob(`${st.ident}_br`, `${st.path} (br, ${st.br.length} bytes)`, st.br);
+    headerBody += `static const char ${st.ident}_path[] PROGMEM = "${st.path}";
+static const char ${st.ident}_hash[] PROGMEM = "${st.hash}";
+
+`;
+    totalGz += st.data.length;
+    sizes.push({ name: st.path, raw: st.raw, gz: st.gzip ? st.data.length : null, br: st.br && st.br.length });
+    shared.push({ path: st.path, ident: st.ident, lenIdent: `${st.ident}_len`, type: `asset_type_${st.ext}`,
+                  encoding: st.gzip ? "asset_encoding_gzip" : "NULL", cache: "asset_cache_static", br: !!st.br });
+  }
+
+  // asset tables, sorted by path for a binary search
+  for (const [prefix, table] of MODES) {
+    const list = items.filter(it => it.fname.startsWith(prefix)).concat(shared)
+      .sort((a, b) => (a.path < b.path ? -1 : a.path > b.path ? 1 : 0));
+    headerBody += `\nstatic const GzAsset ${table}[] PROGMEM = {\n`;
+    for (const it of list) {
+      const br = it.br ? `${it.ident}_br, ${it.ident}_br_len` : "NULL, 0";
+      headerBody += `  { ${it.ident}_path, ${it.ident}, ${it.lenIdent}, ${it.ident}_hash, ${it.type}, ${it.encoding}, ${it.cache}, ${br} },\n`;
+    }
+    headerBody += `};\n`;
+    headerBody += `static const size_t ${table}_COUNT = ${list.length};\n`;
   }
-  headerBody += `};\n\n`;
-  headerBody += `static const size_t HTML_ASSETS_COUNT = ${items.length};\n`;*/
 
   await fs.mkdir(path.dirname(OUT_H), { recursive: true });
   await fs.writeFile(OUT_H, headerBody, "utf8");
@@ -107,6 +347,29 @@ const size_t ${ident}_len = ${gz.length};
   console.log(`Total compressed size: ${totalGz} bytes`);
   const savings = totalOrig > 0 ? (100 * (1 - totalGz / totalOrig)).toFixed(2) : "0.00";
   console.log(`Total flash memory savings: ${savings}%`);
+
+  // flash taken by each variant against the bytes a client saves with it
+  const col = (v, w = 8) => String(v ?? "-").padStart(w);
+  let flash = 0;
+  let flashBr = 0;
+  console.log("\nEncodings (bytes):");
+  console.log(`  ${"asset".padEnd(24)}${col("plain")}${col("gzip")}${col("br")}${col("br saves", 10)}${col("flash")}`);
+  for (const sz of sizes) {
+    const sent = sz.gz ?? sz.raw;
+    const stored = sent + (sz.br ?? 0);
+    flash += stored;
+    flashBr += sz.br ?? 0;
+    console.log(`  ${sz.name.padEnd(24)}${col(sz.raw)}${col(sz.gz)}${col(sz.br)}${col(sz.br ? sent - sz.br : null, 10)}${col(stored)}`);
+  }
+  console.log(`  Total flash ${flash} bytes, ${flashBr} of them for Brotli`);
+
+  // what a browser with an empty cache fetches from the controller for each page
+  console.log(`\nCold page load${cdn.length ? ` (not counting ${cdn.length} files from ${CDN_URL})` : ""}:`);
+  for (const it of items) {
+    const uses = new Set(it.uses.flatMap(p => [p, ...statics.get(p).uses]));  // with the images of the stylesheet
+    const shared = [...uses].reduce((sum, p) => sum + statics.get(p).data.length, 0);
+    console.log(`  ${it.fname.padEnd(18)} ${String(it.size).padStart(7)} + ${String(shared).padStart(7)} shared = ${it.size + shared} bytes in ${1 + uses.size} requests`);
+  }
 }
 
 main().catch(err => {
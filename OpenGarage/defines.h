@@ -45,10 +45,35 @@
 #define DEFAULT_DKEY    "opendoor"
 // File System
 #define FILESYS         SPIFFS
-// Config file name
+// Config file name, binary since firmware 1.2.5
+#define CONFIG_BIN_FNAME "/config.bin"
+#define CONFIG_TMP_FNAME "/config.tmp"  // written first, then renamed to CONFIG_BIN_FNAME
+#define CONFIG_MAGIC     0x434F  // "OC"
+#define CONFIG_VERSION   1
+#define CONFIG_JNL_FNAME "/config.jnl"  // options changed since CONFIG_BIN_FNAME was written
+#define CONFIG_JNL_MAGIC 0x4A4F  // "OJ"
+#define CONFIG_JNL_SIZE  1024    // journal size at which the config file is rewritten
+#define CONFIG_JNL_VALUE_MAX 80  // longer values are saved by rewriting the config file
+// Text config file of firmware 1.2.4 and before, imported once
 #define CONFIG_FNAME    "/config.dat"
-// Log file name
+// Log file name of firmware 1.2.4 and before, imported once into the segments
 #define LOG_FNAME       "/log2.dat"
+// Log segment file names, LOG_SEGMENTS of them used as a ring
+#define LOG_SEG_FNAME   "/logs%u.dat"
+// Usage statistics, one file per tier
+#define ROLLUP_HOUR_FNAME "/rollh.dat"
+#define ROLLUP_DAY_FNAME  "/rolld.dat"
+#define ROLLUP_HOUR_TMP_FNAME "/rollh.tmp"
+#define ROLLUP_DAY_TMP_FNAME  "/rolld.tmp"
+#define ROLLUP_HOURS      336  // two weeks
+#define ROLLUP_DAYS       400
+#define ROLLUP_MAGIC      0x524F  // "OR"
+#define ROLLUP_VERSION    2
+#define ROLLUP_PAGE       48   // periods per /js2 reply unless n says otherwise
+#define ROLLUP_ROW_MAX    61   // longest JSON period: [4294967295,65535,4294967295,4294967295,65535,-32768,-32768],
+#define ROLLUP_PAGE_MAX   ((OTF::Response::MAX_RESPONSE_LENGTH - HTTP_REPLY_HEAD) / ROLLUP_ROW_MAX)
+
+#define NTP_VALID_TIME  1577836800UL  // earlier times mean the clock is not set yet
 
 #define DEFAULT_NTP1    "time.google.com"
 #define DEFAULT_NTP2    "time.cloudflare.com"
@@ -160,7 +185,17 @@ enum { // cloud settings
 #define BLYNK_PIN_LOCK  V9
 
 #define DEFAULT_LOG_SIZE  100
-#define MAX_LOG_SIZE      500
+#define MAX_LOG_SIZE      2000
+#define LOG_SEGMENTS      5
+#define LOG_SEG_RECORDS   512     // (LOG_SEGMENTS-1) full segments hold at least MAX_LOG_SIZE records
+#define LOG_SEG_MAGIC     0x474F  // "OG"
+#define LOG_SEG_VERSION   2
+#define LOG_CACHE_SIZE    32      // most recent records kept in RAM
+#define LOG_HOLD_RECORDS  4       // door events kept until the clock is set, later ones are dropped
+#define LOG_ROW_MAX       27      // longest /jl record: [4294967295,255,65535,255],
+#define LOG_PAGE_ROWS     ((OTF::Response::MAX_RESPONSE_LENGTH - HTTP_REPLY_HEAD) / LOG_ROW_MAX) // records per /jl reply
+#define LOG_FLUSH_RECORDS 8       // records are written to flash once this many are pending,
+#define DEFAULT_LOG_FLUSH 60      // option lfd: this many seconds after the first of them, or before a restart
 #define ALARM_FREQ       1000
 
 // door status
@@ -197,64 +232,86 @@ enum {
 };
 
 
+/* Option registry, one line per option:
+ *   INT(id, name, default value, min value, max value) for integer options
+ *   STR(id, name, default value, max length) for string options
+ * It expands into the OPTION_id indices below and the option tables in
+ * OpenGarage.cpp. Names are at most 4 characters, they double as the tags
+ * in the config file. */
+#define OG_OPTIONS(INT, STR) \
+	INT(FWV,  "fwv", OG_FWV, 0, 255)                       /* firmware version */ \
+	INT(SN1,  "sn1", OG_SN1_CEILING, 0, 1)                 /* distance sensor mounting method */ \
+	INT(SN2,  "sn2", OG_SN2_NONE, 0, 2)                    /* switch sensor type */ \
+	INT(SNO,  "sno", OG_SNO_1ONLY, 0, 3)                   /* sensor logic */ \
+	INT(SECV, "secv", 0, 0, 2)                             /* security+ version (2.0, 1.0, or none) */ \
+	INT(DTH,  "dth", 50, 0, 65535)                         /* distance threshold for door */ \
+	INT(VTH,  "vth", 150, 0, 65535)                        /* distance threshold for vehicle */ \
+	INT(RIV,  "riv", 1, 1, 30)                             /* status check interval */ \
+	INT(ALM,  "alm", OG_ALM_5, 0, 2)                       /* alarm mode */ \
+	INT(AOO,  "aoo", 0, 0, 1)                              /* no alarm on opening */ \
+	INT(LSZ,  "lsz", DEFAULT_LOG_SIZE, 20, MAX_LOG_SIZE)   /* log size */ \
+	INT(TSN,  "tsn", OG_TSN_NONE, 0, 255)                  /* temperature sensor type */ \
+	INT(HTP,  "htp", 80, 0, 65535)                         /* http port */ \
+	INT(CDT,  "cdt", 1000, 50, 5000)                       /* click delay time */ \
+	INT(DRI,  "dri", 500, 50, 3000)                        /* distance sensor reading interval */ \
+	INT(SFI,  "sfi", OG_SFI_CONSENSUS, 0, 1)               /* sensor filter method */ \
+	INT(CMR,  "cmr", 10, 0, 100)                           /* consensus method margin */ \
+	INT(STO,  "sto", 0, 0, 1)                              /* sensor timeout option */ \
+	INT(MOD,  "mod", OG_MOD_AP, 0, 255)                    /* mode */ \
+	INT(ATI,  "ati", 30, 0, 720)                           /* automation interval (in minutes) */ \
+	INT(ATO,  "ato", OG_AUTO_NONE, 0, 255)                 /* automation options */ \
+	INT(ATIB, "atib", 3, 0, 24)                            /* automation interval B (in hours) */ \
+	INT(ATOB, "atob", OG_AUTO_NONE, 0, 255)                /* automation options B */ \
+	INT(NOTO, "noto", OG_NOTIFY_DO|OG_NOTIFY_DC, 0, 255)   /* notification options */ \
+	INT(BAS,  "bas", OG_LIGHT_BLINK_FOREVER, 0, OG_LIGHT_BLINK_MAX) /* blink count before turning the light off (0 means infinity) */ \
+	INT(USI,  "usi", 0, 0, 1)                              /* use static IP */ \
+	STR(SSID, "ssid", "", 32)                              /* wifi ssid */ \
+	STR(PASS, "pass", "", 64)                              /* wifi password */ \
+	INT(CLD,  "cld", 0, 0, 2)                              /* Cloud connection (0: no; 1: Blynk: 2: OTC) */ \
+	STR(AUTH, "auth", "", 64)                              /* Cloud authentication token */ \
+	STR(BDMN, "bdmn", DEFAULT_BLYNK_DMN, 64)               /* Cloud server (for backward compatibility, it's named bdmn) */ \
+	INT(BPRT, "bprt", DEFAULT_BLYNK_PRT, 0, 65535)         /* Cloud port (for backward compatibility, it's named bprt) */ \
+	STR(DKEY, "dkey", DEFAULT_DKEY, 64)                    /* device key */ \
+	STR(NAME, "name", DEFAULT_NAME, 32)                    /* device name */ \
+	STR(IFTT, "iftt", "", 64)                              /* IFTTT token */ \
+	INT(MQEN, "mqen", 0, 0, 1)                             /* MQTT enable */ \
+	STR(MQTT, "mqtt", "", 64)                              /* MQTT server */ \
+	INT(MQPT, "mqpt", 1883, 0, 65535)                      /* MQTT port */ \
+	STR(MQUR, "mqur", "", 64)                              /* MQTT user name (optional) */ \
+	STR(MQPW, "mqpw", "", 64)                              /* MQTT password (optional) */ \
+	STR(MQTP, "mqtp", "", 64)                              /* MQTT topic (optional) */ \
+	INT(DBEN, "dben", 0, 0, 1)                             /* Debug enable (MQTT debug output) */ \
+	INT(MQBN, "mqbn", 0, 0, 1)                             /* MQTT binary status payload */ \
+	INT(EMEN, "emen", 0, 0, 1)                             /* Email enable */ \
+	STR(SMTP, "smtp", DEFAULT_SMTP_SERVER, 64)             /* SMTP Server */ \
+	INT(SPRT, "sprt", DEFAULT_SMTP_PORT, 0, 65535)         /* SMTP Port */ \
+	STR(SEND, "send", "", 64)                              /* Sender Email */ \
+	STR(APWD, "apwd", "", 64)                              /* SMTP App Password */ \
+	STR(RECP, "recp", "", 64)                              /* Recipient Email */ \
+	STR(DVIP, "dvip", "", 15)                              /* device IP */ \
+	STR(GWIP, "gwip", "", 15)                              /* gateway IP */ \
+	STR(SUBN, "subn", "255.255.255.0", 15)                 /* subnet */ \
+	STR(DNS1, "dns1", "8.8.8.8", 64)                       /* dns1 IP */ \
+	STR(NTP1, "ntp1", "", 64)                              /* custom NTP server */ \
+	STR(HOST, "host", "", 32)                              /* custom host name */ \
+	STR(OURL, "ourl", "", 100)                             /* firmware update manifest url (optional) */ \
+	INT(OUWS, "ouws", 9, 0, 23)                            /* firmware update window start (UTC hour) */ \
+	INT(OUWE, "ouwe", 12, 0, 23)                           /* firmware update window end (UTC hour) */ \
+	INT(LFD,  "lfd", DEFAULT_LOG_FLUSH, 10, 600)           /* log flush delay (seconds), the most a power loss can lose */
+
+#define OPTION_ID(id, ...) OPTION_##id,
+#define OPTION_NONE(...)
 typedef enum {
-	OPTION_FWV = 0, // firmware version
-	OPTION_SN1,     // distance sensor mounting method
-	OPTION_SN2,     // switch sensor type
-	OPTION_SNO,     // sensor logic
-	OPTION_SECV,    // security+ version (2.0, 1.0, or none)
-	OPTION_DTH,     // distance threshold for door
-	OPTION_VTH,     // distance threshold for vehicle
-	OPTION_RIV,     // status check interval
-	OPTION_ALM,     // alarm mode
-	OPTION_AOO,     // no alarm on opening
-	OPTION_LSZ,     // log size
-	OPTION_TSN,     // temperature sensor type
-	OPTION_HTP,     // http port
-	OPTION_CDT,     // click delay time
-	OPTION_DRI,     // distance sensor reading interval
-	OPTION_SFI,     // sensor filter method
-	OPTION_CMR,     // consensus method margin
-	OPTION_STO,     // sensor timeout option
-	OPTION_MOD,     // mode
-	OPTION_ATI,     // automation interval (in minutes)
-	OPTION_ATO,     // automation options
-	OPTION_ATIB,    // automation interval B (in hours)
-	OPTION_ATOB,    // automation options B
-	OPTION_NOTO,    // notification options
-	OPTION_BAS,     // blink count before turning the light off (0 means infinity)
-	OPTION_USI,     // use static IP
-	OPTION_SSID,    // wifi ssid
-	OPTION_PASS,    // wifi password
-	OPTION_CLD,     // Cloud connection (0: no; 1: Blynk: 2: OTC)
-	OPTION_AUTH,    // Cloud authentication token
-	OPTION_BDMN,    // Cloud server (for backward compatibility, it's named bdmn)
-	OPTION_BPRT,    // Cloud port (for backward compatibility, it's named bprt)
-	OPTION_DKEY,    // device key
-	OPTION_NAME,    // device name
-	OPTION_IFTT,    // IFTTT token
-	OPTION_MQEN,    // MQTT enable
-	OPTION_MQTT,    // MQTT server
-	OPTION_MQPT,    // MQTT port
-	OPTION_MQUR,    // MQTT user name (optional)
-	OPTION_MQPW,    // MQTT password (optional)
-	OPTION_MQTP,    // MQTT topic (optional)
-	OPTION_DBEN,    // Debug enable (MQTT debug output)
-	OPTION_EMEN,	// Email enable
-	OPTION_SMTP,	// SMTP Server
-	OPTION_SPRT,	// SMTP Port
-	OPTION_SEND,	// Sender Email
-	OPTION_APWD,	// SMTP App Password
-	OPTION_RECP,	// Recipient Email
-	OPTION_DVIP,    // device IP
-	OPTION_GWIP,    // gateway IP
-	OPTION_SUBN,    // subnet
-	OPTION_DNS1,    // dns1 IP
-	OPTION_NTP1,    // custom NTP server
-	OPTION_HOST,    // custom host name
+	OG_OPTIONS(OPTION_ID, OPTION_ID)
 	NUM_OPTIONS     // number of options
 } OG_OPTION_enum;
 
+// positions in the integer and string value tables
+#define OPTION_INT_ID(id, ...) OPTION_INT_##id,
+#define OPTION_STR_ID(id, ...) OPTION_STR_##id,
+enum { OG_OPTIONS(OPTION_INT_ID, OPTION_NONE) NUM_INT_OPTIONS };
+enum { OG_OPTIONS(OPTION_NONE, OPTION_STR_ID) NUM_STR_OPTIONS };
+
 // if button is pressed for 1 seconds, report IP
 #define BUTTON_REPORTIP_TIMEOUT 800
 // if button is pressed for at least 5 seconds, reset to AP mode
@@ -268,6 +325,79 @@ typedef enum {
 #define TIME_SYNC_TIMEOUT 3600 //Issues connecting to MQTT can throw off the time function, sync more often
 
 #define TMP_BUFFER_SIZE 100
+// binary status (/bc and MQTT OUT/BIN): layout version and flag bits
+#define BIN_STATUS_VERSION  1
+#define BIN_FLAG_SWRX       0x01  // Security+ receiver present
+#define BIN_FLAG_LIGHT      0x02
+#define BIN_FLAG_LOCK       0x04
+#define BIN_FLAG_OBSTRUCT   0x08
+#define BIN_FLAG_SN2        0x10  // sn2 field is valid
+#define BIN_FLAG_TEMP       0x20  // temp and humid fields are valid
+
+#define JSON_BUFFER_SIZE 512 // stack buffer of the status JSON responses
+#define HTTP_BODY_BUFFER 256 // buffer between prints and the OTF response
+#define HTTP_REPLY_HEAD 512  // room in a paged reply for the HTTP headers and the fields around the rows
+#define ASSET_CHUNK_SIZE 1024 // pages are copied from flash into the response in pieces of this size, a multiple of 4
+#define ASSET_WINDOW_BITS 13  // gzip window of the assets, see GZIP_WINDOW_BITS in compress_htmls.mjs
+#define ASSET_PLAIN_MAX 14336 // largest page sent uncompressed, must fit the OTF response with its headers
+#define SSE_MAX_CLIENTS 2    // concurrent /events subscribers
+#define SSE_REFRESH_INTERVAL 30000 // ms, resend the status even if unchanged
+#define HTTP_POOL_SIZE 3             // keep-alive connections on the update server port
+#define HTTP_POOL_LINE_SIZE 64       // longer request lines and headers are cut
+#define HTTP_KEEPALIVE_TIMEOUT 5000  // ms a pooled connection may stay idle
+#define HTTP_KEEPALIVE_MAX 100       // requests served per pooled connection
+#define OTA_REPORT_INTERVAL 1000     // ms between firmware upload progress reports
+#define OTA_CHECK_INTERVAL  3600     // seconds between update manifest checks in the update window
+#define OTA_CHUNK_SIZE      16384    // bytes asked for in each ranged download request
+#define OTA_READ_MAX        2048     // bytes of a download taken per loop pass
+#define OTA_RETRY_MIN       10       // seconds before a failed request is retried, doubled for each further one
+#define OTA_RETRY_MAX       600
+#define OTA_HTTP_TIMEOUT    15000    // ms without data before a download request fails
+#define OTA_CONNECT_TIMEOUT 1000     // ms a download request may block the loop to look up and connect to the server
+
+// notification channels, served from the outbox in main.cpp
+enum {
+	NOTIFY_CH_BLYNK = 0,
+	NOTIFY_CH_IFTTT,
+	NOTIFY_CH_EMAIL,
+	NOTIFY_CH_MQTT,
+	NUM_NOTIFY_CHANNELS
+};
+
+// notification channel states
+enum {
+	NOTIFY_STATE_IDLE = 0,
+	NOTIFY_STATE_WAIT,     // request sent, waiting for the server
+	NOTIFY_STATE_BACKOFF,  // last attempt failed, waiting to retry
+};
+
+#define NOTIFY_OUTBOX_SIZE   4     // queued messages; the oldest is dropped when full
+#define NOTIFY_MSG_SIZE      128   // including the terminating zero
+#define NOTIFY_MAX_RETRIES   3
+#define NOTIFY_RETRY_DELAY   5000  // ms before the first retry, doubled for each further one
+#define NOTIFY_HTTP_TIMEOUT  10000 // ms to wait for a server response
+
+// main loop stages, timed for the /jp profiling endpoint
+enum {
+	LOOP_STAGE_MDNS = 0,
+	LOOP_STAGE_TIME,
+	LOOP_STAGE_STATUS,
+	LOOP_STAGE_OTF,
+	LOOP_STAGE_UPDATE,
+	LOOP_STAGE_BLYNK,
+	LOOP_STAGE_MQTT,
+	LOOP_STAGE_NOTIFY,
+	LOOP_STAGE_OTA,
+	LOOP_STAGE_SECPLUS,
+	LOOP_STAGE_UI,
+	LOOP_STAGE_ALARM,
+	LOOP_STAGE_LOOP,  // the whole do_loop() pass
+	NUM_LOOP_STAGES
+};
+// bucket i counts stage runs taking [2^(i-1), 2^i) microseconds, the last bucket everything longer
+#define LOOP_PROF_BUCKETS 24
+// seconds between <topic>/OUT/PERF reports (sent only when debug is enabled)
+#define PERF_PUBLISH_INTERVAL 60
 
 //#define SERIAL_DEBUG
 /** Serial debug functions */
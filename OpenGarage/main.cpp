@@ -31,10 +31,16 @@
 #include <OpenThingsFramework.h>
 #include <Request.h>
 #include <Response.h>
+#include <stdarg.h>
 
 #include "pitches.h"
 #include "OpenGarage.h"
 #include "espconnect.h"
+#include "JsonWriter.h"
+#include "Rollup.h"
+#include "Inflate.h"
+#include "Delta.h"
+#include <bearssl/bearssl_hash.h>
 #include <garagelib.cpp>
 
 OpenGarage og;
@@ -52,6 +58,7 @@ static Ticker restart_ticker;
 
 static WiFiClient wificlient;
 static WiFiClient httpclient;
+static EMailSender emailSend("", ""); // kept across loop passes while a message is being sent
 PubSubClient mqttclient(wificlient);
 String mqtt_topic;
 String mqtt_debug_topic;  // Pre-constructed to avoid heap fragmentation in callback
@@ -81,7 +88,6 @@ extern bool fullbuffer;
 static ulong start_utc_time = 0;
 static ulong curr_utc_time = 0;
 static ulong curr_utc_hour= 0;
-static HTTPClient http;
 static bool light_blink_enabled = true;
 // security+ objects
 SecPlus1::Garage secplus1_garage(PIN_SW_RX, PIN_SW_TX);
@@ -90,6 +96,62 @@ SecPlus2::Garage secplus2_garage(0x777, PIN_SW_RX, PIN_SW_TX);
 void do_setup();
 void mqtt_debug_callback(const char* message);
 
+/* Notifications are queued in a small outbox and delivered from notify_loop(),
+ * one step per loop pass, so a slow server does not stall the main loop.
+ * Each channel works through the outbox in order on its own, retrying a
+ * failed message with a growing delay before giving up on it. */
+struct NotifyMessage {
+	char text[NOTIFY_MSG_SIZE];
+	byte pending; // bit mask of channels that still have to deliver it
+};
+
+struct NotifyChannel {
+	byte state;     // NOTIFY_STATE_*
+	byte slot;      // outbox slot being delivered
+	byte attempts;  // failed attempts on the current message
+	ulong timeout;  // millis() deadline of the current wait or backoff
+	uint16_t sent;
+	uint16_t failed;
+	uint16_t retries;
+	uint16_t dropped;
+};
+
+static const char* const notify_channel_names[NUM_NOTIFY_CHANNELS] = {"blynk", "ifttt", "email", "mqtt"};
+static NotifyMessage notify_outbox[NOTIFY_OUTBOX_SIZE];
+static byte notify_head = 0;  // oldest message
+static byte notify_count = 0;
+static NotifyChannel notify_channels[NUM_NOTIFY_CHANNELS];
+
+// loop stage profiling: log2 histograms of stage run times, in static memory
+static const char* const loop_stage_names[NUM_LOOP_STAGES] = {
+	"mdns", "time", "status", "otf", "update", "blynk", "mqtt", "notify", "ota", "secplus", "ui", "alarm", "loop"
+};
+static uint32_t loop_prof_hist[NUM_LOOP_STAGES][LOOP_PROF_BUCKETS];
+static uint32_t loop_prof_max[NUM_LOOP_STAGES]; // in microseconds
+static uint64_t loop_prof_sum[NUM_LOOP_STAGES]; // in microseconds
+static uint32_t loop_prof_since = 0; // millis() when the histograms were last cleared
+
+// Records the time since cycle count 'start' against a stage and returns
+// the current cycle count, so consecutive stages can be chained.
+static uint32_t loop_prof_mark(byte stage, uint32_t start) {
+	uint32_t now = ESP.getCycleCount();
+	uint32_t us = (now - start) / ESP.getCpuFreqMHz();
+	byte b = us ? 32 - __builtin_clz(us) : 0;
+	if(b >= LOOP_PROF_BUCKETS) b = LOOP_PROF_BUCKETS-1;
+	loop_prof_hist[stage][b]++;
+	loop_prof_sum[stage] += us;
+	if(us > loop_prof_max[stage]) loop_prof_max[stage] = us;
+	return now;
+}
+
+static void loop_prof_reset() {
+	memset(loop_prof_hist, 0, sizeof(loop_prof_hist));
+	memset(loop_prof_max, 0, sizeof(loop_prof_max));
+	memset(loop_prof_sum, 0, sizeof(loop_prof_sum));
+	loop_prof_since = millis();
+}
+
+
 void otf_send_html_P(OTF::Response &res, const __FlashStringHelper *content) {
 	res.writeStatus(200, F("OK"));
 	res.writeHeader(F("Content-Type"), F("text/html"));
@@ -101,50 +163,212 @@ void otf_send_html_P(OTF::Response &res, const __FlashStringHelper *content) {
 	DEBUG_PRINTLN(F(" bytes sent."));
 }
 
-void otf_send_compressed_P(OTF::Response& res, const __FlashStringHelper* content, size_t len) {
-	res.writeStatus(200, F("OK"));
-	res.writeHeader(F("Content-Type"), F("text/html; charset=utf-8"));
+/* True if the If-None-Match value lists etag, or is "*". Entity tags
+ * are compared weakly, as RFC 7232 asks for this header. */
+static bool etag_matches(const char *inm, const char *etag) {
+	if(!inm) return false;
+	if(etag[0] == 'W' && etag[1] == '/') etag += 2;
+	size_t n = strlen(etag);
+	while(*inm) {
+		while(*inm == ' ' || *inm == ',') inm++;
+		if(*inm == '*') return true;
+		if(inm[0] == 'W' && inm[1] == '/') inm += 2;
+		if(strncmp(inm, etag, n) == 0 && (inm[n] == 0 || inm[n] == ',' || inm[n] == ' ')) return true;
+		while(*inm && *inm != ',') inm++;
+	}
+	return false;
+}
+
+// true if Accept-Encoding lists coding, or "*", without q=0
+static bool accepts_encoding(const char *ae, const char *coding) {
+	size_t n = strlen(coding);
+	bool any = false;
+	while(*ae) {
+		while(*ae == ' ' || *ae == ',') ae++;
+		const char *name = ae;
+		while(*ae && *ae != ',' && *ae != ';' && *ae != ' ') ae++;
+		size_t len = ae - name;
+		bool ok = true;
+		for(;*ae && *ae != ',';ae++) {
+			if(*ae == 'q' && ae[1] == '=') ok = atof(ae+2) > 0;
+		}
+		if(len == n && strncasecmp(name, coding, n) == 0) return ok;
+		if(len == 1 && *name == '*') any = ok;
+	}
+	return any;
+}
+
+/* Sends an asset, or a bodyless 304 if the client already has this
+ * version. The data is read from flash in aligned pieces, but OTF::Response
+ * copies the whole reply into its RAM buffer before sending it. The encoding follows
+ * Accept-Encoding: Brotli where there is a variant, then gzip, then the
+ * gzip data inflated on the fly. Without the header gzip is sent, as
+ * before. Each encoding has its own ETag. */
+void otf_send_asset(OTF::Response& res, const GzAsset& a, const char *inm, const char *ae) {
+	const uint8_t *data = a.data;
+	size_t len = a.len;
+	const char *encoding = a.contentEncoding;
+	const char *suffix = "";
+	bool plain = false;  // inflate the gzip data
+	if(encoding && ae) {
+		if(a.br && accepts_encoding(ae, "br")) {
+			data = a.br;
+			len = a.brLen;
+			encoding = asset_encoding_br;
+			suffix = "-br";
+		} else if(!accepts_encoding(ae, "gzip")) {
+			len = Inflater::size_P(a.data, a.len);
+			encoding = NULL;
+			suffix = "-id";
+			plain = true;
+		}
+	}
+	if(plain && len > ASSET_PLAIN_MAX) {
+		res.writeStatus(406, F("Not Acceptable"));  // too large for the response buffer
+		res.writeHeader(F("Vary"), F("Accept-Encoding"));
+		res.writeHeader(F("Content-Length"), 0);
+		res.writeHeader(F("Connection"), F("close"));
+		return;
+	}
+	char etag[24];
+	etag[0] = '"';
+	strncpy_P(etag+1, a.hash, sizeof(etag)-6);
+	etag[sizeof(etag)-6] = 0;
+	strcat(etag, suffix);
+	strcat(etag, "\"");
+	bool unchanged = etag_matches(inm, etag);
+	if(unchanged) {
+		// no Content-Length: on a 304 it would have to be the one of the 200 (RFC 7230 3.3.2)
+		res.writeStatus(304, F("Not Modified"));
+	} else {
+		res.writeStatus(200, F("OK"));
+		res.writeHeader(F("Content-Type"), FPSTR(a.contentType));
+		res.writeHeader(F("Content-Length"), len);
+		if(encoding) res.writeHeader(F("Content-Encoding"), FPSTR(encoding));
+	}
 	res.writeHeader(F("Access-Control-Allow-Origin"), F("*")); // from esp8266 2.4 this has to be sent explicitly
-	res.writeHeader(F("Content-Length"), len);
 	res.writeHeader(F("Vary"), F("Accept-Encoding"));
-	res.writeHeader(F("Content-Encoding"), F("gzip"));
-	res.writeHeader(F("Cache-Control"), F("public, max-age=86400"));
+	res.writeHeader(F("ETag"), etag);
+	res.writeHeader(F("Cache-Control"), FPSTR(a.cacheControl));
 	res.writeHeader(F("Connection"), F("close"));
-	res.writeBodyData(content, len);
+	if(unchanged) {
+		DEBUG_PRINTLN(F("not modified."));
+		return;
+	}
+	if(plain) {
+		Inflater inflater(ASSET_WINDOW_BITS);
+		if(!inflater.ok() || !inflater.gunzip_P(a.data, a.len, res)) {
+			DEBUG_PRINTLN(F("inflate failed."));
+		}
+	} else {
+		for(size_t pos=0;pos<len;pos+=ASSET_CHUNK_SIZE) {
+			size_t n = len-pos < ASSET_CHUNK_SIZE ? len-pos : ASSET_CHUNK_SIZE;
+			res.writeBodyData((const __FlashStringHelper*)(data+pos), n);
+		}
+	}
 	DEBUG_PRINT(len);
 	DEBUG_PRINTLN(F(" bytes sent."));
 }
 
-void otf_send_json(OTF::Response &res, String json) {
+void otf_send_json(OTF::Response &res, const char *json, size_t len) {
 	res.writeStatus(200, F("OK"));
 	res.writeHeader(F("Content-Type"), F("application/json"));
 	res.writeHeader(F("Access-Control-Allow-Origin"), F("*")); // from esp8266 2.4 this has to be sent explicitly
-	res.writeHeader(F("Content-Length"), json.length());
+	res.writeHeader(F("Content-Length"), len);
 	res.writeHeader(F("Connection"), F("close"));
-	res.writeBodyData(json.c_str(), json.length());
+	res.writeBodyData(json, len);
+}
+
+void otf_send_json(OTF::Response &res, const String &json) {
+	otf_send_json(res, json.c_str(), json.length());
+}
+
+// a writer that ran out of room holds cut-off JSON, which is not sent
+void otf_send_json(OTF::Response &res, JsonWriter &json) {
+	if(json.overflow()) {
+		DEBUG_PRINTLN(F("json buffer too small"));
+		res.writeStatus(500, F("Internal Server Error"));
+		res.writeHeader(F("Content-Length"), 0);
+		res.writeHeader(F("Connection"), F("close"));
+		return;
+	}
+	otf_send_json(res, json.c_str(), json.length());
+}
+
+/* Prints a response body into OTF::Response through a small buffer, for
+ * bodies built with many small prints. OTF::Response buffers the whole reply
+ * (MAX_RESPONSE_LENGTH), so callers must bound the body size; paged replies
+ * size their pages from it. Without a Content-Length the body ends when the
+ * connection closes. Call begin() after writing the status line and headers,
+ * print the body, then end(). */
+class ResponseBody : public Print {
+public:
+	ResponseBody(OTF::Response &res) : res(res), len(0) {}
+	void begin() {
+		res.writeHeader(F("Connection"), F("close"));
+	}
+	size_t write(uint8_t c) {
+		buf[len++] = c;
+		if(len == sizeof(buf)) flush();
+		return 1;
+	}
+	size_t write(const uint8_t *data, size_t size) {
+		for(size_t i=0;i<size;) {
+			size_t n = sizeof(buf)-len;
+			if(n > size-i) n = size-i;
+			memcpy(buf+len, data+i, n);
+			len += n;
+			i += n;
+			if(len == sizeof(buf)) flush();
+		}
+		return size;
+	}
+	using Print::write;
+	void flush() {
+		if(!len) return;
+		res.writeBodyData(buf, len);
+		len = 0;
+	}
+	void end() {
+		flush();
+	}
+private:
+	OTF::Response &res;
+	char buf[HTTP_BODY_BUFFER];
+	size_t len;
+};
+
+static_assert(LOG_PAGE_ROWS >= 100, "OTF response buffer too small for /jl pages");
+static_assert(ROLLUP_PAGE_MAX >= ROLLUP_PAGE, "OTF response buffer too small for /js2 pages");
+
+static void fill_result_json(JsonWriter &json, byte code, const char *item) {
+	json.beginObject();
+	json.add(F("result"), code);
+	json.add(F("item"), item ? item : "");
+	json.endObject();
+}
+
+// an item too long for buf is left empty, the result code always fits
+static JsonWriter result_json(char *buf, size_t size, byte code, const char *item) {
+	JsonWriter json(buf, size);
+	fill_result_json(json, code, item);
+	if(!json.overflow()) return json;
+	JsonWriter bare(buf, size);
+	fill_result_json(bare, code, NULL);
+	return bare;
 }
 
 void otf_send_result(OTF::Response &res, byte code, const char *item = NULL) {
-	String json = F("{\"result\":");
-	json += code;
-	if (!item) item = "";
-	json += F(",\"item\":\"");
-	json += item;
-	json += F("\"");
-	json += F("}");
+	char buf[TMP_BUFFER_SIZE];
+	JsonWriter json = result_json(buf, sizeof(buf), code, item);
 	otf_send_json(res, json);
 }
 
 void updateserver_send_result(byte code, const char* item = NULL) {
-	String json = F("{\"result\":");
-	json += code;
-	if (!item) item = "";
-	json += F(",\"item\":\"");
-	json += item;
-	json += F("\"");
-	json += F("}");
+	char buf[TMP_BUFFER_SIZE];
+	JsonWriter json = result_json(buf, sizeof(buf), code, item);
 	updateServer->sendHeader("Access-Control-Allow-Origin", "*"); // from esp8266 2.4 this has to be sent explicitly
-	updateServer->send(200, "application/json", json);
+	updateServer->send(200, "application/json", json.c_str(), json.length());
 }
 
 // this is simplified version to check if MQTT / NTP server is valid domain name
@@ -196,24 +420,62 @@ void restart_in(uint32_t ms) {
 	if(og.state != OG_STATE_WAIT_RESTART) {
 		og.state = OG_STATE_WAIT_RESTART;
 		DEBUG_PRINTLN(F("Prepare to restart..."));
+		og.log_flush(); // not from the ticker callback
+		rollup_save();
+
 		restart_ticker.once_ms(ms, og.restart);
 	}
 }
 
-void on_home(const OTF::Request &req, OTF::Response &res) {
+// asset table of the current mode
+static const GzAsset* assets(size_t& count) {
 	if(curr_mode == OG_MOD_AP) {
-		otf_send_compressed_P(res, (const __FlashStringHelper*)ap_home_html_gz, ap_home_html_gz_len);
-	} else {
-	otf_send_compressed_P(res, (const __FlashStringHelper*)sta_home_html_gz, sta_home_html_gz_len);
+		count = AP_ASSETS_COUNT;
+		return AP_ASSETS;
+	}
+	count = STA_ASSETS_COUNT;
+	return STA_ASSETS;
+}
+
+// binary search of the sorted asset table, false if there is no page at path
+static bool find_asset(const char *path, GzAsset& a) {
+	size_t count;
+	const GzAsset *table = assets(count);
+	size_t lo = 0, hi = count;
+	while(lo < hi) {
+		size_t mid = (lo+hi)/2;
+		memcpy_P(&a, &table[mid], sizeof(a));
+		int c = strcmp_P(path, a.path);
+		if(c == 0) return true;
+		if(c < 0) hi = mid;
+		else lo = mid+1;
 	}
+	return false;
 }
 
-void on_sta_view_options(const OTF::Request &req, OTF::Response &res) {
-	otf_send_compressed_P(res, (const __FlashStringHelper*)sta_options_html_gz, sta_options_html_gz_len);
+// serves every page of the asset table, see register_assets()
+void on_asset(const OTF::Request &req, OTF::Response &res) {
+	GzAsset a;
+	const char *path = req.getPath();
+	if(curr_mode == OG_MOD_STA && req.isCloudRequest() && strcmp_P(path, PSTR("/update")) == 0) {
+		otf_send_result(res, HTML_NOT_PERMITTED, "fw update");
+		return;
+	}
+	if(!find_asset(path, a) && !(curr_mode == OG_MOD_AP && find_asset("/", a))) {  // AP mode shows the home page for any other path
+		otf_send_result(res, HTML_PAGE_NOT_FOUND, path);
+		return;
+	}
+	otf_send_asset(res, a, req.getHeader(F("If-None-Match")), req.getHeader(F("Accept-Encoding")));
 }
 
-void on_sta_view_logs(const OTF::Request &req, OTF::Response &res) {
-	otf_send_compressed_P(res, (const __FlashStringHelper*)sta_logs_html_gz, sta_logs_html_gz_len);
+static void register_assets() {
+	size_t count;
+	const GzAsset *table = assets(count);
+	for(size_t i=0;i<count;i++) {
+		GzAsset a;
+		memcpy_P(&a, &table[i], sizeof(a));
+		otf->on(FPSTR(a.path), on_asset, OTF::HTTP_GET);
+	}
 }
 
 char dec2hexchar(byte dec) {
@@ -221,7 +483,7 @@ char dec2hexchar(byte dec) {
 	else return 'A'+(dec-10);
 }
 
-String get_mac() {
+const String& get_mac() {
 	static String hex = "";
 	if(!hex.length()) {
 		byte mac[6];
@@ -236,7 +498,7 @@ String get_mac() {
 	return hex;
 }
 
-String get_ap_ssid() {
+const String& get_ap_ssid() {
 	static String ap_ssid = "";
 	if(!ap_ssid.length()) {
 		byte mac[6];
@@ -262,154 +524,551 @@ String get_ip() {
 	return ip;
 }
 
-void sta_controller_fill_json(String& json) {
-	json.reserve(STRING_RESERVE_SIZE);
-	json = "";
-	json += F("{\"dist\":");
-	json += distance;
-	if(og.options[OPTION_SN2].ival>OG_SN2_NONE) {
-		json += F(",\"sn2\":");
-		json += sn2_value;
-	}
-	json += F(",\"secv\":");
-	json += og.options[OPTION_SECV].ival;
-	json += F(",\"door\":");
-	json += door_status;
-	json += F(",\"vehicle\":");
-	json += vehicle_status;
-	json += F(",\"rcnt\":");
-	json += read_cnt;
-json += F(",\"fwv\":");
-	json += og.options[OPTION_FWV].ival;
-	json += F(",\"has_swrx\":");
-	json += og.has_swrx;
+void sta_controller_fill_json(JsonWriter& json) {
+	json.beginObject();
+	json.add(F("dist"), distance);
+	if(og.ival(OPTION_SN2)>OG_SN2_NONE) {
+		json.add(F("sn2"), sn2_value);
+	}
+	json.add(F("secv"), og.ival(OPTION_SECV));
+	json.add(F("door"), door_status);
+	json.add(F("vehicle"), vehicle_status);
+	json.add(F("rcnt"), read_cnt);
+	json.add(F("fwv"), og.ival(OPTION_FWV));
+	json.add(F("has_swrx"), og.has_swrx);
 	if(og.has_swrx) {
-		if(og.options[OPTION_SECV].ival>=1) {
-			json += F(",\"light\":");
-			json += light_status;
-			json += F(",\"lock\":");
-			json += lock_status;
-			json += F(",\"obstruct\":");
-			json += obstruction_status;
-			if(og.options[OPTION_SECV].ival==2) {
-				json += F(",\"nopenings\":");
-				json += opening_count;
+		if(og.ival(OPTION_SECV)>=1) {
+			json.add(F("light"), light_status);
+			json.add(F("lock"), lock_status);
+			json.add(F("obstruct"), obstruction_status);
+			if(og.ival(OPTION_SECV)==2) {
+				json.add(F("nopenings"), opening_count);
 			}
-			if(og.options[OPTION_SECV].ival==1) {
-				json += F(",\"pemu\":");
-				json += secplus1_garage.get_panel_emu_status();
+			if(og.ival(OPTION_SECV)==1) {
+				json.add(F("pemu"), secplus1_garage.get_panel_emu_status());
 			}
 		}
 	}
-	json += F(",\"name\":\"");
-	json += og.options[OPTION_NAME].sval;
-	json += F("\",\"mac\":\"");
-	json += get_mac();
-	json += F("\",\"cid\":");
-	json += ESP.getChipId();
-	json += F(",\"rssi\":");
-	json += (int16_t)WiFi.RSSI();
-	json += F(",\"cld\":");
-	byte cld = og.options[OPTION_CLD].ival;
-	json += cld;
+	json.add(F("name"), og.sval(OPTION_NAME));
+	json.add(F("mac"), get_mac());
+	json.add(F("cid"), ESP.getChipId());
+	json.add(F("rssi"), (int16_t)WiFi.RSSI());
+	byte cld = og.ival(OPTION_CLD);
+	json.add(F("cld"), cld);
 	if(cld>CLOUD_NONE) {
-		json += F(",\"clds\":");
-		if(cld==CLOUD_BLYNK) json += (Blynk.connected()?1:0);
-		else if(cld==CLOUD_OTC) json += (otf->getCloudStatus());
-		else json += "0";
+		if(cld==CLOUD_BLYNK) json.add(F("clds"), Blynk.connected()?1:0);
+		else if(cld==CLOUD_OTC) json.add(F("clds"), otf->getCloudStatus());
+		else json.add(F("clds"), 0);
 	}
-	if(og.options[OPTION_TSN].ival) {
-		json += F(",\"temp\":");
-		json += tempC;
-		json += F(",\"humid\":");
-		json += humid;
+	if(og.ival(OPTION_TSN)) {
+		json.add(F("temp"), tempC);
+		json.add(F("humid"), humid);
 	}
-	json += F("}");
+	json.endObject();
 }
 
 void on_sta_controller(const OTF::Request &req, OTF::Response &res) {
 	if(curr_mode == OG_MOD_AP) return;
-	String json;
+	char buf[JSON_BUFFER_SIZE];
+	JsonWriter json(buf, sizeof(buf));
 	sta_controller_fill_json(json);
 	otf_send_json(res, json);
 }
 
-void on_sta_debug(const OTF::Request &req, OTF::Response &res) {
-	String json = "";
-	json.reserve(STRING_RESERVE_SIZE);
-	json += F("{");
-	json += F("\"rcnt\":");
-	json += read_cnt;
-	json += F(",\"fwv\":");
-	json += og.options[OPTION_FWV].ival;
-	json += F(",\"name\":\"");
-	json += og.options[OPTION_NAME].sval;
-	json += F("\",\"mac\":\"");
-	json += get_mac();
-	json += F("\",\"mqtt_topic\":\"");
-	json += mqtt_topic;
-	json += F("\",\"devip\":\"");
-	json += WiFi.localIP().toString();
-	json += F("\",\"cid\":");
-	json += ESP.getChipId();
-	json += F(",\"rssi\":");
-	json += (int16_t)WiFi.RSSI();
-	json += F(",\"bssid\":\"");
-	json += WiFi.BSSIDstr();
-	json += F("\",\"build\":\"");
-	json += (F(__DATE__));
-	json += F("\",\"Freeheap\":");
-	json += (uint16_t)ESP.getFreeHeap();
-	json += F(",\"flash_size\":");
-	json += (uint32_t)ESP.getFlashChipRealSize();
-	json += F(",\"has_swrx\":");
-	json += og.has_swrx;
-	json += F("}");
-	otf_send_json(res, json);
+/* Fixed-layout status for clients that poll often, about a twentieth of
+ * the /jc JSON. Fields are little-endian, as the ESP8266 stores them. */
+struct __attribute__((packed)) BinaryStatus {
+	uint8_t  version;  // BIN_STATUS_VERSION
+	uint8_t  door;
+	uint8_t  vehicle;
+	uint8_t  flags;    // BIN_FLAG_*
+	uint16_t dist;     // cm, not part of the ETag
+	uint8_t  sn2;
+	uint8_t  secv;
+	int8_t   rssi;     // dBm, not part of the ETag
+	uint8_t  rcnt;     // read counter, not part of the ETag
+	int16_t  temp;     // 0.1 C
+	uint16_t humid;    // 0.1 %
+};
+
+static void fill_binary_status(BinaryStatus &s) {
+	memset(&s, 0, sizeof(s));
+	s.version = BIN_STATUS_VERSION;
+	s.door = door_status;
+	s.vehicle = vehicle_status;
+	s.dist = distance;
+	s.secv = og.ival(OPTION_SECV);
+	s.rssi = WiFi.RSSI();
+	s.rcnt = read_cnt;
+	if(og.has_swrx) {
+		s.flags |= BIN_FLAG_SWRX;
+		if(light_status) s.flags |= BIN_FLAG_LIGHT;
+		if(lock_status) s.flags |= BIN_FLAG_LOCK;
+		if(obstruction_status) s.flags |= BIN_FLAG_OBSTRUCT;
+	}
+	if(og.ival(OPTION_SN2)>OG_SN2_NONE) {
+		s.flags |= BIN_FLAG_SN2;
+		s.sn2 = sn2_value;
+	}
+	if(og.ival(OPTION_TSN)) {
+		s.flags |= BIN_FLAG_TEMP;
+		s.temp = (int16_t)lroundf(tempC*10);
+		s.humid = (uint16_t)lroundf(humid*10);
+	}
+}
+
+/* FNV-1a over the fields that change with the state of the garage. The
+ * read counter, signal strength and distance change on nearly every
+ * read; the distance only matters through the door and vehicle status. */
+static uint32_t binary_status_tag(const BinaryStatus &s) {
+	BinaryStatus t = s;
+	t.dist = 0;
+	t.rssi = 0;
+	t.rcnt = 0;
+	const uint8_t *p = (const uint8_t*)&t;
+	uint32_t h = 2166136261u;
+	for(size_t i=0;i<sizeof(t);i++) h = (h ^ p[i]) * 16777619u;
+	return h;
 }
 
-void sta_logs_fill_json(String& json, OTF::Response &res) {
-	json = "";
-	json.reserve(2048); // reserve capacity to reduce the overhead of String's +=
-	json += F("{\"name\":\"");
-	json += og.options[OPTION_NAME].sval;
-	json += F("\",\"starttime\":");
-	json += start_utc_time;
-	json += F(",\"time\":");
-	json += curr_utc_time;
-	json += F(",\"ncols\":");
-	json += og.options[OPTION_SN2].ival>OG_SN2_NONE ? 4 : 3;
-	json += F(",\"logs\":[");
-	if(!og.read_log_start()) {
-		json += F("]}");
+void on_sta_binary_status(const OTF::Request &req, OTF::Response &res) {
+	if(curr_mode == OG_MOD_AP) return;
+	BinaryStatus s;
+	fill_binary_status(s);
+	char etag[16];
+	snprintf(etag, sizeof(etag), "W/\"%08x\"", binary_status_tag(s));
+	const char *match = req.getHeader("If-None-Match");
+	bool unchanged = etag_matches(match, etag);
+	if(unchanged) {
+		res.writeStatus(304, F("Not Modified"));  // no body, and so no Content-Length
+	} else {
+		res.writeStatus(200, F("OK"));
+		res.writeHeader(F("Content-Type"), F("application/octet-stream"));
+		res.writeHeader(F("Content-Length"), sizeof(s));
+	}
+	res.writeHeader(F("Access-Control-Allow-Origin"), F("*")); // from esp8266 2.4 this has to be sent explicitly
+	res.writeHeader(F("ETag"), etag);
+	res.writeHeader(F("Cache-Control"), F("no-cache"));
+	res.writeHeader(F("Connection"), F("close"));
+	if(!unchanged) res.writeBodyData((const char*)&s, sizeof(s));
+}
+
+/* Event stream of the controller variables, served by the update server:
+ * OTF only sends a response after the handler returns, so it cannot keep
+ * a connection open. Subscribers get the /jc JSON right away, then again
+ * whenever the status changes, and every SSE_REFRESH_INTERVAL otherwise. */
+static WiFiClient sse_clients[SSE_MAX_CLIENTS];
+static uint32_t sse_tag = 0;
+static ulong sse_refresh_timeout = 0;
+
+// to one subscriber, or to all if to is NULL
+static void sse_write(WiFiClient *to, const char *buf, size_t len) {
+	for(byte i=0;i<SSE_MAX_CLIENTS;i++) {
+		WiFiClient &client = sse_clients[i];
+		if((to && to != &client) || !client.connected()) continue;
+		if(client.write((const uint8_t*)buf, len) != len) client.stop(); // gone, or too slow to keep up
+	}
+}
+
+static void sse_send_status(WiFiClient *to) {
+	char buf[JSON_BUFFER_SIZE];
+	strcpy_P(buf, PSTR("data: "));
+	JsonWriter json(buf+6, sizeof(buf)-8);
+	sta_controller_fill_json(json);
+	if(json.overflow()) return;
+	size_t len = 6 + json.length();
+	buf[len++] = '\n';
+	buf[len++] = '\n';
+	sse_write(to, buf, len);
+	sse_refresh_timeout = millis() + SSE_REFRESH_INTERVAL;
+}
+
+void sse_loop() {
+	bool any = false;
+	for(byte i=0;i<SSE_MAX_CLIENTS;i++) {
+		if(sse_clients[i].connected()) any = true;
+		else sse_clients[i].stop();
+	}
+	if(!any) return;
+	BinaryStatus s;
+	fill_binary_status(s);
+	uint32_t tag = binary_status_tag(s);
+	if(tag != sse_tag || millis() > sse_refresh_timeout) {
+		sse_tag = tag;
+		sse_send_status(NULL);
+	}
+}
+
+void on_sta_events() {
+	byte i;
+	for(i=0;i<SSE_MAX_CLIENTS;i++) {
+		if(!sse_clients[i].connected()) break;
+	}
+	updateServer->sendHeader("Access-Control-Allow-Origin", "*");
+	if(i==SSE_MAX_CLIENTS) {
+		DEBUG_PRINTLN(F("too many event subscribers"));
+		updateServer->sendHeader("Retry-After", "60");
+		updateServer->send(503, "text/plain", "");
 		return;
 	}
+	WiFiClient &client = sse_clients[i];
+	client = updateServer->client(); // keeps the connection open after we return
+	client.setNoDelay(true);
+	client.print(F("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+	               "Access-Control-Allow-Origin: *\r\n\r\n"));
+	sse_send_status(&client);
+}
+
+/* HTTP/1.1 keep-alive for clients that poll: OTF closes the connection
+ * after every response, so /jc and /bc are also served on the update
+ * server port. There a connection may stay open for further requests,
+ * which http_pool_loop() reads once the update server has let go of it. */
+struct PooledConnection {
+	WiFiClient client;
+	ulong idle_timeout;
+	byte nreq;
+	byte len;
+	bool in_headers;  // request line read, headers follow
+	bool close;       // client sent "Connection: close"
+	char path[8];
+	char etag[16];    // If-None-Match
+	char line[HTTP_POOL_LINE_SIZE];
+};
+static PooledConnection http_pool[HTTP_POOL_SIZE];
+
+// appends to head at n; past its end only the length is counted, like snprintf()
+static size_t head_add(char *head, size_t size, size_t n, const char *fmt, ...) {
+	va_list ap;
+	va_start(ap, fmt);
+	int k = vsnprintf(n < size ? head+n : NULL, n < size ? size-n : 0, fmt, ap);
+	va_end(ap);
+	return n + (k > 0 ? k : 0);
+}
+
+// response headers; returns their length, which may be size or more if they did not fit
+static size_t keepalive_head(char *head, size_t size, bool unchanged, const char *type, size_t blen, const char *etag, bool keep) {
+	size_t n = head_add(head, size, 0, "HTTP/1.1 %s\r\n", unchanged ? "304 Not Modified" : "200 OK");
+	if(!unchanged) n = head_add(head, size, n, "Content-Type: %s\r\nContent-Length: %u\r\n", type, (unsigned)blen);
+	n = head_add(head, size, n, "Access-Control-Allow-Origin: *\r\nCache-Control: no-cache\r\n");
+	if(etag[0]) n = head_add(head, size, n, "ETag: %s\r\n", etag);
+	if(keep) n = head_add(head, size, n, "Connection: keep-alive\r\nKeep-Alive: timeout=%u, max=%u\r\n\r\n",
+	                      HTTP_KEEPALIVE_TIMEOUT/1000, HTTP_KEEPALIVE_MAX);
+	else n = head_add(head, size, n, "Connection: close\r\n\r\n");
+	return n;
+}
+
+// writes a complete /jc or /bc response; false for any other path
+static bool keepalive_respond(WiFiClient &client, const char *path, const char *inm, bool keep) {
+	const size_t HEAD_ROOM = 224;
+	char buf[HEAD_ROOM + JSON_BUFFER_SIZE]; // headers right before the body, sent as one write
+	char *body = buf + HEAD_ROOM;
+	size_t blen;
+	const char *type;
+	char etag[16] = "";
+	bool unchanged = false;
+	if(strcmp(path, "/jc") == 0) {
+		JsonWriter json(body, JSON_BUFFER_SIZE);
+		sta_controller_fill_json(json);
+		if(json.overflow()) {
+			client.print(F("HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"));
+			client.stop();
+			return true;
+		}
+		blen = json.length();
+		type = "application/json";
+	} else if(strcmp(path, "/bc") == 0) {
+		BinaryStatus s;
+		fill_binary_status(s);
+		snprintf(etag, sizeof(etag), "W/\"%08x\"", binary_status_tag(s));
+		unchanged = etag_matches(inm, etag);
+		memcpy(body, &s, sizeof(s));
+		blen = unchanged ? 0 : sizeof(s);
+		type = "application/octet-stream";
+	} else {
+		return false;
+	}
+	char head[HEAD_ROOM];
+	size_t n = keepalive_head(head, sizeof(head), unchanged, type, blen, etag, keep);
+	if(n < sizeof(head)) {
+		memcpy(body-n, head, n);
+		client.write((const uint8_t*)(body-n), n+blen);
+		return true;
+	}
+	// too long to go in front of the body: formatted again for a write of their own
+	char *big = (char*)malloc(n+1);
+	if(!big) {
+		client.stop();
+		return true;
+	}
+	keepalive_head(big, n+1, unchanged, type, blen, etag, keep);
+	client.write((const uint8_t*)big, n);
+	free(big);
+	client.write((const uint8_t*)body, blen);
+	return true;
+}
+
+static const char *keepalive_headers[] = {"Connection", "If-None-Match"};
+
+// first request of a connection, through the update server
+void on_keepalive_api() {
+	WiFiClient &client = updateServer->client();
+	PooledConnection *slot = NULL;
+	for(byte i=0;i<HTTP_POOL_SIZE;i++) {
+		// the update server may still serve a pooled connection's next request itself
+		if(http_pool[i].client.connected() && http_pool[i].client == client) { slot = &http_pool[i]; break; }
+	}
+	if(!slot && !updateServer->header("Connection").equalsIgnoreCase("close")) {
+		for(byte i=0;i<HTTP_POOL_SIZE;i++) {
+			if(http_pool[i].client.connected()) continue;
+			slot = &http_pool[i];
+			slot->client = client;
+			slot->nreq = 0;
+			slot->len = 0;
+			slot->in_headers = false;
+			break;
+		}
+	}
+	bool keep = slot && ++slot->nreq < HTTP_KEEPALIVE_MAX;
+	keepalive_respond(client, updateServer->uri().c_str(), updateServer->header("If-None-Match").c_str(), keep);
+	if(slot) {
+		if(keep) slot->idle_timeout = millis() + HTTP_KEEPALIVE_TIMEOUT;
+		else slot->client.stop();
+	}
+}
+
+static void http_pool_serve(PooledConnection &p) {
+	bool keep = !p.close && ++p.nreq < HTTP_KEEPALIVE_MAX;
+	if(!keepalive_respond(p.client, p.path, p.etag[0] ? p.etag : NULL, keep)) {
+		p.client.print(F("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"));
+		keep = false;
+	}
+	if(keep) p.idle_timeout = millis() + HTTP_KEEPALIVE_TIMEOUT;
+	else p.client.stop();
+}
+
+// follow-up requests on pooled connections; only GET /jc and /bc are expected
+void http_pool_loop() {
+	for(byte i=0;i<HTTP_POOL_SIZE;i++) {
+		PooledConnection &p = http_pool[i];
+		if(!p.client.connected()) { p.client.stop(); continue; }
+		if(p.client == updateServer->client()) continue;
+		if(millis() > p.idle_timeout) { p.client.stop(); continue; }
+		while(p.client.connected() && p.client.available()) {
+			int c = p.client.read();
+			if(c == '\r') continue;
+			if(c != '\n') {
+				if(p.len < sizeof(p.line)-1) p.line[p.len++] = c;
+				continue;
+			}
+			p.line[p.len] = 0;
+			if(!p.in_headers) { // "GET /jc?... HTTP/1.1"
+				char *s = strchr(p.line, ' ');
+				size_t n = s ? strcspn(++s, " ?") : 0;
+				if(strncmp(p.line, "GET ", 4) || n >= sizeof(p.path)) n = 0; // answered with 404
+				strncpy(p.path, s ? s : "", n);
+				p.path[n] = 0;
+				p.etag[0] = 0;
+				p.close = false;
+				p.in_headers = true;
+			} else if(p.len == 0) {
+				p.in_headers = false;
+				http_pool_serve(p);
+			} else if(strncasecmp(p.line, "If-None-Match:", 14) == 0) {
+				char *v = p.line + 14;
+				while(*v == ' ') v++;
+				strncpy(p.etag, v, sizeof(p.etag)-1);
+				p.etag[sizeof(p.etag)-1] = 0;
+			} else if(strncasecmp(p.line, "Connection:", 11) == 0) {
+				char *v = p.line + 11;
+				while(*v == ' ') v++;
+				p.close = strncasecmp(v, "close", 5) == 0;
+			}
+			p.len = 0;
+		}
+	}
+}
+
+void on_sta_debug(const OTF::Request &req, OTF::Response &res) {
+	char buf[JSON_BUFFER_SIZE];
+	JsonWriter json(buf, sizeof(buf));
+	json.beginObject();
+	json.add(F("rcnt"), read_cnt);
+	json.add(F("fwv"), og.ival(OPTION_FWV));
+	json.add(F("name"), og.sval(OPTION_NAME));
+	json.add(F("mac"), get_mac());
+	json.add(F("mqtt_topic"), mqtt_topic);
+	char addr[18];
+	IPAddress ip = WiFi.localIP();
+	snprintf(addr, sizeof(addr), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+	json.add(F("devip"), addr);
+	json.add(F("cid"), ESP.getChipId());
+	json.add(F("rssi"), (int16_t)WiFi.RSSI());
+	const uint8_t *b = WiFi.BSSID();
+	snprintf(addr, sizeof(addr), "%02X:%02X:%02X:%02X:%02X:%02X", b[0], b[1], b[2], b[3], b[4], b[5]);
+	json.add(F("bssid"), addr);
+	json.add(F("build"), F(__DATE__));
+	json.add(F("Freeheap"), (uint16_t)ESP.getFreeHeap());
+	json.add(F("flash_size"), (uint32_t)ESP.getFlashChipRealSize());
+	json.add(F("has_swrx"), og.has_swrx);
+	json.beginObject(F("notify"));
+	json.add(F("queued"), notify_count);
+	for(byte ch=0;ch<NUM_NOTIFY_CHANNELS;ch++) { // [sent, failed, retries, dropped]
+		const NotifyChannel &c = notify_channels[ch];
+		json.beginArray(notify_channel_names[ch]);
+		json.item(c.sent);
+		json.item(c.failed);
+		json.item(c.retries);
+		json.item(c.dropped);
+		json.endArray();
+	}
+	json.endObject();
+	json.endObject();
+	otf_send_json(res, json);
+}
+
+static void print_log_entry(Print &out, const LogStruct &l, bool sn2, bool first) {
+	if(!first) out.print(',');
+	out.print('[');
+	out.print(l.tstamp);
+	out.print(',');
+	out.print(l.status);
+	out.print(',');
+	out.print(l.dist);
+	if(sn2) {
+		out.print(',');
+		out.print(l.sn2);
+	}
+	out.print(']');
+}
+
+/* Newest first, limited to since < tstamp <= until. The window ends are
+ * found by binary search over the record sequence numbers; 'after' is the
+ * 'end' of an earlier reply, 'before' the 'next' cursor of the previous page. */
+static void print_log_query(Print &out, const OTF::Request &req, bool sn2) {
+	const char *after = req.getQueryParameter("after");
+	const char *since = req.getQueryParameter("since");
+	const char *until = req.getQueryParameter("until");
+	const char *limit = req.getQueryParameter("limit");
+	const char *before = req.getQueryParameter("before");
+	uint32_t lo = og.log_first_seq();
+	uint32_t hi = og.log_end_seq();
+	if(before) {
+		uint32_t b = strtoul(before, NULL, 10);
+		if(b < hi) hi = b;
+	}
+	if(after) {
+		uint32_t a = strtoul(after, NULL, 10);
+		if(a > lo) lo = a < hi ? a : hi;
+	}
+	if(until && lo < hi) hi = og.log_upper_bound(strtoul(until, NULL, 10), lo, hi);
+	if(since && lo < hi) lo = og.log_upper_bound(strtoul(since, NULL, 10), lo, hi);
+	uint n = limit ? strtoul(limit, NULL, 10) : 0;
+	if(!n || n > og.ival(OPTION_LSZ)) n = og.ival(OPTION_LSZ);
+	if(n > LOG_PAGE_ROWS) n = LOG_PAGE_ROWS;
 	LogStruct l;
-	for(uint i=0;i<og.options[OPTION_LSZ].ival;i++) {
-		if(!og.read_log_next(l)) break;
-		if(!l.tstamp) continue;
-		json += F("[");
-		json += l.tstamp;
-		json += F(",");
-		json += l.status;
-		json += F(",");
-		json += l.dist;
-		if(og.options[OPTION_SN2].ival>OG_SN2_NONE) {
-		  json += F(",");
-		  json += l.sn2;
-		}
-		json += F("],");
+	uint count = 0;
+	uint32_t seq = hi;
+	out.print(F("\"logs\":["));
+	while(seq > lo && count < n) {
+		seq--;
+		if(!og.read_log_at(seq, l) || !l.tstamp) continue;
+		print_log_entry(out, l, sn2, count==0);
+		count++;
 	}
 	og.read_log_end();
-	json.remove(json.length()-1); // remove the extra ,
-	json += F("]}");
+	out.print(']');
+	if(seq > lo) {
+		out.print(F(",\"next\":"));
+		out.print(seq);
+	}
 }
 
+// at most LOG_PAGE_ROWS records per reply, as many as fit the OTF response buffer
 void on_sta_logs(const OTF::Request &req, OTF::Response &res) {
 	if(curr_mode == OG_MOD_AP) return;
-	String json;
-	sta_logs_fill_json(json, res);
-	otf_send_json(res, json);
+	bool sn2 = og.ival(OPTION_SN2)>OG_SN2_NONE;
+	bool query = req.getQueryParameter("since") || req.getQueryParameter("until") || req.getQueryParameter("limit") ||
+	             req.getQueryParameter("before") || req.getQueryParameter("after");
+	res.writeStatus(200, F("OK"));
+	res.writeHeader(F("Content-Type"), F("application/json"));
+	res.writeHeader(F("Access-Control-Allow-Origin"), F("*")); // from esp8266 2.4 this has to be sent explicitly
+	ResponseBody out(res);
+	out.begin();
+	out.print(F("{\"name\":\""));
+	out.print(og.sval(OPTION_NAME));
+	out.print(F("\",\"starttime\":"));
+	out.print(start_utc_time);
+	out.print(F(",\"time\":"));
+	out.print(curr_utc_time);
+	out.print(F(",\"ncols\":"));
+	out.print(sn2 ? 4 : 3);
+	out.print(F(",\"first\":"));
+	out.print(og.log_first_seq());
+	out.print(F(",\"end\":"));
+	out.print(og.log_end_seq());
+	out.print(',');
+	if(query) {
+		print_log_query(out, req, sn2);
+	} else {
+		// oldest first, the newest LOG_PAGE_ROWS records; 'next' leads to the older ones
+		uint32_t lo = og.log_first_seq();
+		uint32_t hi = og.log_end_seq();
+		uint32_t from = hi-lo > LOG_PAGE_ROWS ? hi-LOG_PAGE_ROWS : lo;
+		out.print(F("\"logs\":["));
+		if(og.read_log_start(from)) {
+			LogStruct l;
+			bool first = true;
+			while(og.read_log_next(l)) {
+				if(!l.tstamp) continue;
+				print_log_entry(out, l, sn2, first);
+				first = false;
+			}
+			og.read_log_end();
+		}
+		out.print(']');
+		if(from > lo) {
+			out.print(F(",\"next\":"));
+			out.print(from);
+		}
+	}
+	out.print('}');
+	out.end();
+}
+
+// hourly or daily usage statistics, newest first, as JSON rows or packed RollupBuckets
+void on_sta_rollups(const OTF::Request &req, OTF::Response &res) {
+	if(curr_mode == OG_MOD_AP) return;
+	const char *t = req.getQueryParameter("t");
+	const char *n = req.getQueryParameter("n");
+	const char *before = req.getQueryParameter("before");
+	const char *fmt = req.getQueryParameter("fmt");
+	byte tier = (t && t[0] == 'h') ? ROLLUP_HOURLY : ROLLUP_DAILY;
+	uint count = n ? strtoul(n, NULL, 10) : ROLLUP_PAGE;
+	if(!count || count > ROLLUP_PAGE_MAX) count = ROLLUP_PAGE_MAX;
+	uint32_t until = before ? strtoul(before, NULL, 10) : 0;
+	bool bin = fmt && strcmp(fmt, "bin") == 0;
+	res.writeStatus(200, F("OK"));
+	res.writeHeader(F("Content-Type"), bin ? F("application/octet-stream") : F("application/json"));
+	res.writeHeader(F("Access-Control-Allow-Origin"), F("*"));
+	ResponseBody out(res);
+	out.begin();
+	if(bin) {
+		rollup_write_binary(out, tier, count, until);
+	} else {
+		out.print(F("{\"time\":"));
+		out.print(curr_utc_time);
+		out.print(F(",\"period\":"));
+		out.print(tier == ROLLUP_HOURLY ? 3600 : 86400);
+		out.print(F(",\"cols\":[\"start\",\"opens\",\"open\",\"maxopen\",\"veh\",\"tmin\",\"tmax\"],\"data\":["));
+		uint32_t next = rollup_print_json(out, tier, count, until);
+		out.print(']');
+		if(next) {
+			out.print(F(",\"next\":"));
+			out.print(next);
+		}
+		out.print('}');
+	}
+	out.end();
 }
 
 bool verify_device_key(const OTF::Request &req) {
@@ -417,7 +1076,7 @@ bool verify_device_key(const OTF::Request &req) {
 		return true;
 	}
 	const char *dkey = req.getQueryParameter("dkey");
-	if(dkey != NULL && strcmp(dkey, og.options[OPTION_DKEY].sval.c_str()) == 0)
+	if(dkey != NULL && strcmp(dkey, og.sval(OPTION_DKEY).c_str()) == 0)
 		return true;
 	return false;
 }
@@ -441,6 +1100,51 @@ void on_clear_log(const OTF::Request &req, OTF::Response &res) {
 	otf_send_result(res, HTML_SUCCESS, nullptr);
 }
 
+void on_sta_perf(const OTF::Request &req, OTF::Response &res) {
+	if(req.getQueryParameter("reset") != NULL) {
+		if(!verify_device_key(req)) {
+			otf_send_result(res, HTML_UNAUTHORIZED, nullptr);
+			return;
+		}
+		loop_prof_reset();
+		otf_send_result(res, HTML_SUCCESS, nullptr);
+		return;
+	}
+	// streamed: with every histogram bucket used it does not fit a stack buffer
+	res.writeStatus(200, F("OK"));
+	res.writeHeader(F("Content-Type"), F("application/json"));
+	res.writeHeader(F("Access-Control-Allow-Origin"), F("*")); // from esp8266 2.4 this has to be sent explicitly
+	ResponseBody out(res);
+	out.begin();
+	char buf[TMP_BUFFER_SIZE];
+	JsonWriter json(buf, sizeof(buf), &out);
+	json.beginObject();
+	json.add(F("cpu"), (uint)ESP.getCpuFreqMHz());
+	json.add(F("secs"), (millis() - loop_prof_since) / 1000);
+	json.beginArray(F("stages"));
+	for(byte i=0;i<NUM_LOOP_STAGES;i++) {
+		uint32_t n = 0;
+		byte last = 0;
+		for(byte b=0;b<LOOP_PROF_BUCKETS;b++) {
+			n += loop_prof_hist[i][b];
+			if(loop_prof_hist[i][b]) last = b;
+		}
+		json.beginObject();
+		json.add(F("name"), loop_stage_names[i]);
+		json.add(F("n"), (ulong)n);
+		json.add(F("avg"), (ulong)(n ? loop_prof_sum[i] / n : 0));
+		json.add(F("max"), (ulong)loop_prof_max[i]);
+		json.beginArray(F("hist")); // trailing empty buckets are omitted
+		for(byte b=0;n && b<=last;b++) json.item((ulong)loop_prof_hist[i][b]);
+		json.endArray();
+		json.endObject();
+	}
+	json.endArray();
+	json.endObject();
+	json.flush();
+	out.end();
+}
+
 void secplus_update_door(SecPlusCommon::DoorStatus door_state) {
 	switch (door_state) {
 		case SecPlusCommon::DoorStatus::OPEN:
@@ -499,7 +1203,7 @@ void on_auto_detect(const OTF::Request &req, OTF::Response &res) {
 void performDoorAction(uint8_t action, bool force_alarm_off = false) {
 	// Check if the requested action is valid based on the current door state
 	bool isValidAction = false;
-	if((og.options[OPTION_SECV].ival == 2) || // For Sec+ 2.0, open/close commands are always valid
+	if((og.ival(OPTION_SECV) == 2) || // For Sec+ 2.0, open/close commands are always valid
 		(action == ACTION_TOGGLE) || // toggle action is always valid
 		(action == ACTION_OPEN && (door_status == DOOR_STATUS_CLOSED || door_status == DOOR_STATUS_CLOSING)) || // can only open from CLOSED or CLOSING states
 		(action == ACTION_CLOSE && (door_status == DOOR_STATUS_OPEN || door_status == DOOR_STATUS_STOPPED))) {
@@ -514,12 +1218,12 @@ void performDoorAction(uint8_t action, bool force_alarm_off = false) {
 	// This is the core logic for deciding whether to trigger the alarm or the door directly.
 	bool shouldTriggerAlarm = true;
 	if (force_alarm_off || // override is on
-		(!og.options[OPTION_ALM].ival) || // alarm not enabled
-		(og.options[OPTION_AOO].ival && (door_status==DOOR_STATUS_CLOSED || door_status==DOOR_STATUS_CLOSING || door_status==DOOR_STATUS_OPENING))) { shouldTriggerAlarm = false;
+		(!og.ival(OPTION_ALM)) || // alarm not enabled
+		(og.ival(OPTION_AOO) && (door_status==DOOR_STATUS_CLOSED || door_status==DOOR_STATUS_CLOSING || door_status==DOOR_STATUS_OPENING))) { shouldTriggerAlarm = false;
 	}
 
 	if (shouldTriggerAlarm) { // if using alarm
-		if (og.options[OPTION_SECV].ival == 2) {
+		if (og.ival(OPTION_SECV) == 2) {
 			og.set_alarm(0, action);
 		} else {
 			og.set_alarm();
@@ -528,7 +1232,7 @@ void performDoorAction(uint8_t action, bool force_alarm_off = false) {
 	}
 
 	// no alarm
-	switch (og.options[OPTION_SECV].ival) {
+	switch (og.ival(OPTION_SECV)) {
 		case 2: // SecPlus 2.0
 			if (action == ACTION_OPEN) secplus2_garage.open_door();
 			else if (action == ACTION_CLOSE) secplus2_garage.close_door();
@@ -546,7 +1250,7 @@ void performDoorAction(uint8_t action, bool force_alarm_off = false) {
 void performLightAction(uint8_t action) {
 	switch(action) {
 		case ACTION_TOGGLE:
-			switch (og.options[OPTION_SECV].ival) {
+			switch (og.ival(OPTION_SECV)) {
 				case 2: // SecPlus 2
 					secplus2_garage.toggle_light();
 					break;
@@ -566,7 +1270,7 @@ void performLightAction(uint8_t action) {
 void performLockAction(uint8_t action) {
 	switch(action) {
 		case ACTION_TOGGLE:
-			switch (og.options[OPTION_SECV].ival) {
+			switch (og.ival(OPTION_SECV)) {
 				case 2: // SecPlus 2
 					secplus2_garage.toggle_lock();
 					break;
@@ -644,49 +1348,31 @@ void sta_change_options_main(const OTF::Request &req, OTF::Response &res) {
 	}
 
 	byte i;
-	OptionStruct *o = og.options;
+	OptionStruct o;
+	char *vals[NUM_OPTIONS];  // the values given, looked up once for both rounds
 
 	byte usi = 0;
 	// FIRST ROUND: check option validity
 	// do not save option values yet
-	for(i=0;i<NUM_OPTIONS;i++,o++) {
-		const char *key = o->name.c_str();
+	for(i=0;i<NUM_OPTIONS;i++) {
+		vals[i] = NULL;
 		// these options cannot be modified here
 		if(i==OPTION_FWV || i==OPTION_MOD  || i==OPTION_SSID ||
 			i==OPTION_PASS || i==OPTION_DKEY)
 			continue;
 
-		if(o->max) {  // integer options
-			char *sval = req.getQueryParameter(key);
-			if(sval != NULL) {
-				uint ival = String(sval).toInt();
-				if(ival>o->max) {	// check max limit
-					otf_send_result(res, HTML_DATA_OUTOFBOUND, key);
-					return;
-				}
-				// check min limit
-				if(i==OPTION_DRI && ival < 50) {
-					otf_send_result(res, HTML_DATA_OUTOFBOUND, key);
-					return;
-				}
-				if(i==OPTION_RIV && ival < 1) {
-					otf_send_result(res, HTML_DATA_OUTOFBOUND, key);
-					return;
-				}
-				if(i==OPTION_LSZ && ival < 20) {
-					// minimal log size is 20
-					otf_send_result(res, HTML_DATA_OUTOFBOUND, key);
-					return;
-				}
-				if(i==OPTION_CDT && ival < 50) {
-					// click delay time should be at least 50 ms
-					otf_send_result(res, HTML_DATA_OUTOFBOUND, key);
-					return;
-				}
-				if(i==OPTION_USI && ival==1) {
-					// mark device IP and gateway IP change
-					usi = 1;
-				}
+		og.get_option(i, o);
+		const char *key = o.name;
+		char *sval = vals[i] = req.getQueryParameter(key);
+		if(sval != NULL) {
+			// check min and max limit, or string length
+			if(!og.option_valid(i, sval)) {
+				otf_send_result(res, HTML_DATA_OUTOFBOUND, key);
+				return;
+			}
+			if(i==OPTION_USI && strtol(sval, NULL, 10)==1) {
+				// mark device IP and gateway IP change
+				usi = 1;
 			}
 		}
 	}
@@ -738,6 +1424,10 @@ void sta_change_options_main(const OTF::Request &req, OTF::Response &res) {
 	char* ckey = req.getQueryParameter(_ckey);
 
 	if(nkey != NULL) {
+		if(!og.option_valid(OPTION_DKEY, nkey)) {
+			otf_send_result(res, HTML_DATA_OUTOFBOUND, _nkey);
+			return;
+		}
 		if(ckey != NULL) {
 			if(strcmp(nkey,ckey)!=0) {
 				otf_send_result(res, HTML_MISMATCH, _ckey);
@@ -750,44 +1440,37 @@ void sta_change_options_main(const OTF::Request &req, OTF::Response &res) {
 	}
 
 	// SECOND ROUND: change option values
-	uint old_secv = og.options[OPTION_SECV].ival;
-	o = og.options;
-	for(i=0;i<NUM_OPTIONS;i++,o++) {
-		const char *key = o->name.c_str();
-		// these options cannot be modified here
-		if(i==OPTION_FWV || i==OPTION_MOD  || i==OPTION_SSID ||
-			i==OPTION_PASS || i==OPTION_DKEY)
-			continue;
-
-		char *sval = req.getQueryParameter(key);
+	uint old_secv = og.ival(OPTION_SECV);
+	for(i=0;i<NUM_OPTIONS;i++) {
+		char *sval = vals[i];
 		if(sval != NULL) {
-			if (o->max) {  // integer options
-				uint ival = String(sval).toInt();
-				o->ival = ival;
+			og.get_option(i, o);
+			if (o.type == OPTION_TYPE_INT) {
+				og.set_ival(i, strtol(sval, NULL, 10));
 			} else {
-				o->sval = String(sval);
+				og.set_sval(i, sval);
 			}
 		}
 	}
 
 	if(usi) {
-		og.options[OPTION_DVIP].sval = dvip;
-		og.options[OPTION_GWIP].sval = gwip;
+		og.set_sval(OPTION_DVIP, dvip);
+		og.set_sval(OPTION_GWIP, gwip);
 		if(subn != NULL) {
-			og.options[OPTION_SUBN].sval = subn;
+			og.set_sval(OPTION_SUBN, subn);
 		}
 		if(dns1 != NULL) {
-			og.options[OPTION_DNS1].sval = dns1;
+			og.set_sval(OPTION_DNS1, dns1);
 		}
 	}
 
 	if(nkey != NULL) {
-			og.options[OPTION_DKEY].sval = nkey;
+			og.set_sval(OPTION_DKEY, nkey);
 	}
 
 	og.options_save();
 
-	uint new_secv = og.options[OPTION_SECV].ival;
+	uint new_secv = og.ival(OPTION_SECV);
 	if(old_secv != new_secv) { // sec+ version changed
 		switch(new_secv) {
 			case 2:
@@ -812,57 +1495,57 @@ void on_sta_change_options(const OTF::Request &req, OTF::Response &res) {
 	sta_change_options_main(req, res);
 }
 
-void sta_options_fill_json(String& json) {
-	json.reserve(STRING_RESERVE_SIZE*2); // reserve capacity to reduce the overhead of String's +=
-	json = "{";
-	OptionStruct *o = og.options;
-	for(byte i=0;i<NUM_OPTIONS;i++,o++) {
-		if(!o->max) {
+void sta_options_fill_json(JsonWriter& json) {
+	json.beginObject();
+	OptionStruct o;
+	for(byte i=0;i<NUM_OPTIONS;i++) {
+		og.get_option(i, o);
+		if(o.type == OPTION_TYPE_STR) {
 			if(i==OPTION_PASS || i==OPTION_DKEY || i==OPTION_MQPW) { // do not output password or device key or MQTT password
 				continue;
 			} else {
-				json += F("\"");
-				json += o->name;
-				json += F("\":");
-				json += F("\"");
+				json.beginString(o.name);
 				// fill in default string values for certain options
-				if(o->sval.length()==0) {
+				const String &sval = og.sval(i);
+				if(sval.length()==0) {
 					switch(i) {
 					case OPTION_MQTP:
-						json += og.options[OPTION_NAME].sval;
+						json.append(og.sval(OPTION_NAME).c_str());
 						break;
 					case OPTION_HOST:
-						json += get_ap_ssid();
+						json.append(get_ap_ssid().c_str());
 						break;
 					//case OPTION_NTP1: // leave NPT1 empty if using default
 					//json += DEFAULT_NTP1;
 					//break;
 					}
 				} else {
-					json += o->sval;
+					json.append(sval.c_str());
 				}
-				json += F("\"");
-				json += ",";
+				json.endString();
 			}
 		} else {  // if this is a int option
-			json += F("\"");
-			json += o->name;
-			json += F("\":");
-			json += o->ival;
-			json += ",";
+			json.add(o.name, (uint)og.ival(i));
 		}
 	}
 	// append has_swrx variable
-	json += F("\"has_swrx\":");
-	json += og.has_swrx;
-	json += F("}");
+	json.add(F("has_swrx"), og.has_swrx);
+	json.endObject();
 }
 
+// streamed, as the option values have no fixed size limit
 void on_sta_options(const OTF::Request &req, OTF::Response &res) {
 	if(curr_mode == OG_MOD_AP) return;
-	String json;
+	res.writeStatus(200, F("OK"));
+	res.writeHeader(F("Content-Type"), F("application/json"));
+	res.writeHeader(F("Access-Control-Allow-Origin"), F("*")); // from esp8266 2.4 this has to be sent explicitly
+	ResponseBody out(res);
+	out.begin();
+	char buf[TMP_BUFFER_SIZE];
+	JsonWriter json(buf, sizeof(buf), &out);
 	sta_options_fill_json(json);
-	otf_send_json(res, json);
+	json.flush();
+	out.end();
 }
 
 void on_ap_scan(const OTF::Request &req, OTF::Response &res) {
@@ -874,9 +1557,19 @@ void on_ap_change_config(const OTF::Request &req, OTF::Response &res) {
 	if(curr_mode == OG_MOD_STA) return;
 	char *ssid = req.getQueryParameter("ssid");
 	if(ssid!=NULL&&strlen(ssid)!=0) {
-		og.options[OPTION_SSID].sval = ssid;
-		og.options[OPTION_PASS].sval = req.getQueryParameter("pass");
-		og.options[OPTION_HOST].sval = req.getQueryParameter("host");
+		static const byte checked[] = {OPTION_SSID, OPTION_PASS, OPTION_HOST, OPTION_AUTH, OPTION_BDMN};
+		for(byte i=0;i<sizeof(checked);i++) {
+			OptionStruct o;
+			og.get_option(checked[i], o);
+			char *value = req.getQueryParameter(o.name);
+			if(value!=NULL && !og.option_valid(checked[i], value)) {
+				otf_send_result(res, HTML_DATA_OUTOFBOUND, o.name);
+				return;
+			}
+		}
+		og.set_sval(OPTION_SSID, ssid);
+		og.set_sval(OPTION_PASS, req.getQueryParameter("pass"));
+		og.set_sval(OPTION_HOST, req.getQueryParameter("host"));
 		// if cloud token is provided, save it
 		char *cld = req.getQueryParameter("cld");
 		char *auth = req.getQueryParameter("auth");
@@ -885,20 +1578,20 @@ void on_ap_change_config(const OTF::Request &req, OTF::Response &res) {
 				char *bdmn = req.getQueryParameter("bdmn");
 				char *bprt = req.getQueryParameter("bprt");
 				if(strcmp(cld, "blynk")==0) {
-					og.options[OPTION_BDMN].sval=(bdmn==NULL||strlen(bdmn)==0)?DEFAULT_BLYNK_DMN:bdmn;
-					og.options[OPTION_BPRT].ival=(bprt==NULL||strlen(bprt)==0)?DEFAULT_BLYNK_PRT:String(bprt).toInt();
-					og.options[OPTION_CLD].ival = CLOUD_BLYNK;
+					og.set_sval(OPTION_BDMN, (bdmn==NULL||strlen(bdmn)==0)?DEFAULT_BLYNK_DMN:bdmn);
+					og.set_ival(OPTION_BPRT, (bprt==NULL||strlen(bprt)==0)?DEFAULT_BLYNK_PRT:String(bprt).toInt());
+					og.set_ival(OPTION_CLD, CLOUD_BLYNK);
 				} else {
-					og.options[OPTION_BDMN].sval=(bdmn==NULL||strlen(bdmn)==0)?DEFAULT_OTC_DMN:bdmn;
-					og.options[OPTION_BPRT].ival=(bprt==NULL||strlen(bprt)==0)?DEFAULT_OTC_PRT:String(bprt).toInt();
-					og.options[OPTION_CLD].ival = CLOUD_OTC;
+					og.set_sval(OPTION_BDMN, (bdmn==NULL||strlen(bdmn)==0)?DEFAULT_OTC_DMN:bdmn);
+					og.set_ival(OPTION_BPRT, (bprt==NULL||strlen(bprt)==0)?DEFAULT_OTC_PRT:String(bprt).toInt());
+					og.set_ival(OPTION_CLD, CLOUD_OTC);
 				}
-				og.options[OPTION_AUTH].sval = auth;
+				og.set_sval(OPTION_AUTH, auth);
 				og.options_save();
-				DEBUG_PRINTLN(og.options[OPTION_CLD].ival);
-				DEBUG_PRINTLN(og.options[OPTION_AUTH].sval);
-				DEBUG_PRINTLN(og.options[OPTION_BDMN].sval);
-				DEBUG_PRINTLN(og.options[OPTION_BPRT].ival);
+				DEBUG_PRINTLN(og.ival(OPTION_CLD));
+				DEBUG_PRINTLN(og.sval(OPTION_AUTH));
+				DEBUG_PRINTLN(og.sval(OPTION_BDMN));
+				DEBUG_PRINTLN(og.ival(OPTION_BPRT));
 			} else {
 				otf_send_result(res, HTML_DATA_OUTOFBOUND, "cld");
 				return;
@@ -909,7 +1602,7 @@ void on_ap_change_config(const OTF::Request &req, OTF::Response &res) {
 		if(og.has_swrx && secv != NULL && strlen(secv)!=0) {
 			uint8_t v = String(secv).toInt();
 			if(v>2) v=2;
-			og.options[OPTION_SECV].ival=v;
+			og.set_ival(OPTION_SECV, v);
 		}
 		otf_send_result(res, HTML_SUCCESS, nullptr);
 		og.state = OG_STATE_TRY_CONNECT;
@@ -932,15 +1625,13 @@ void on_ap_try_connect(const OTF::Request &req, OTF::Response &res) {
 }
 
 void on_ap_debug(const OTF::Request &req, OTF::Response &res) {
-	String json = "";
-	json += F("{");
-	json += F("\"dist\":");
-	json += og.read_distance();
-	json += F(",\"fwv\":");
-	json += og.options[OPTION_FWV].ival;
-	json += F(",\"has_swrx\":");
-	json += og.has_swrx;
-	json += F("}");
+	char buf[TMP_BUFFER_SIZE];
+	JsonWriter json(buf, sizeof(buf));
+	json.beginObject();
+	json.add(F("dist"), og.read_distance());
+	json.add(F("fwv"), og.ival(OPTION_FWV));
+	json.add(F("has_swrx"), og.has_swrx);
+	json.endObject();
 	otf_send_json(res, json);
 }
 
@@ -987,12 +1678,14 @@ void do_setup() {
 	WiFi.persistent(false); // turn off persistent, fixing flash crashing issue
 	og.begin();
 	og.options_setup();
+	og.log_setup();
+	rollup_setup();
 	og.init_sensors();
 	if(og.get_mode() == OG_MOD_AP) og.play_startup_tune();
 	curr_mode = og.get_mode();
 
 	// initialize secplus objects and enable callbacks
-	switch(og.options[OPTION_SECV].ival) {
+	switch(og.ival(OPTION_SECV)) {
 		case 2:
 			secplus2_garage.begin();
 			secplus2_garage.reset_state();
@@ -1009,20 +1702,20 @@ void do_setup() {
 	garagelib_set_debug_callback(mqtt_debug_callback);
 
 	if(!otf) {
-		const String otfDeviceKey = og.options[OPTION_AUTH].sval;
+		const String otfDeviceKey = og.sval(OPTION_AUTH);
 
-		if((og.options[OPTION_CLD].ival==CLOUD_OTC) && (otfDeviceKey.length() >= 32)) {
+		if((og.ival(OPTION_CLD)==CLOUD_OTC) && (otfDeviceKey.length() >= 32)) {
 			// Initialize with remote connection if a device key was specified.
-			otf = new OTF::OpenThingsFramework(og.options[OPTION_HTP].ival, og.options[OPTION_BDMN].sval, og.options[OPTION_BPRT].ival, otfDeviceKey, false);
+			otf = new OTF::OpenThingsFramework(og.ival(OPTION_HTP), og.sval(OPTION_BDMN), og.ival(OPTION_BPRT), otfDeviceKey, false);
 			DEBUG_PRINTLN(F("Started OTF with remote connection"));
 		} else {
 			// Initialize just the local server if no device key was specified.
-			otf = new OTF::OpenThingsFramework(og.options[OPTION_HTP].ival);
+			otf = new OTF::OpenThingsFramework(og.ival(OPTION_HTP));
 			DEBUG_PRINTLN(F("Started OTF with just local connection"));
 		}
 		if(curr_mode == OG_MOD_AP) dns = new DNSServer();
 		DEBUG_PRINT(F("server started @ "));
-		DEBUG_PRINTLN(og.options[OPTION_HTP].ival);
+		DEBUG_PRINTLN(og.ival(OPTION_HTP));
 	}
 	if(!updateServer) {
 		updateServer = new ESP8266WebServer(8080);
@@ -1078,21 +1771,146 @@ void process_ui() {
 	}
 }
 
-void on_update(const OTF::Request &req, OTF::Response &res) {
-	if(curr_mode == OG_MOD_AP) {
-		otf_send_compressed_P(res, (const __FlashStringHelper*)ap_update_html_gz, ap_update_html_gz_len);
+/* Firmware updates, uploaded to the update server or pulled from an update
+ * mirror. The file is written to the updater as it comes in and hashed on
+ * the way. It can also be a patch against the running firmware (see
+ * Delta.h), from which the new image is rebuilt. Progress goes out every
+ * OTA_REPORT_INTERVAL as "ota" events to the /events subscribers and to
+ * <topic>/OUT/OTA. */
+static struct {
+	byte result;     // HTML_SUCCESS as long as the update is fine
+	uint32_t bytes;  // file bytes received
+	uint32_t length; // an upper bound of the file size
+	ulong start_ms;
+	ulong report_ms;
+	char sha256[65]; // hex digest of the file, once complete
+	br_sha256_context sha;
+	DeltaPatcher *delta; // while a patch comes in
+} ota;
+
+static void ota_report(bool done) {
+	ulong now = millis();
+	if(!done && (long)(now - ota.report_ms) < OTA_REPORT_INTERVAL) return;
+	ota.report_ms = now;
+	char buf[TMP_BUFFER_SIZE+80];
+	strcpy_P(buf, PSTR("event: ota\ndata: "));
+	size_t head = strlen(buf);
+	JsonWriter json(buf+head, sizeof(buf)-head-2);
+	json.beginObject();
+	json.add(F("bytes"), (unsigned long)ota.bytes);
+	json.add(F("length"), (unsigned long)ota.length);
+	json.add(F("rate"), (unsigned long)((uint64_t)ota.bytes*1000/(now-ota.start_ms+1))); // bytes per second
+	if(done) {
+		json.add(F("result"), ota.result);
+		if(ota.sha256[0]) json.add(F("sha256"), ota.sha256);
+	}
+	json.endObject();
+	if(json.overflow()) return;
+	if(curr_mode == OG_MOD_STA && og.ival(OPTION_MQEN) && mqttclient.connected()) {
+		mqttclient.publish((mqtt_topic + "/OUT/OTA").c_str(), json.c_str());
+		mqttclient.loop(); // an upload blocks the main loop, keep the connection alive
+	}
+	size_t len = head + json.length();
+	buf[len++] = '\n';
+	buf[len++] = '\n';
+	sse_write(NULL, buf, len);
+}
+
+static void ota_free_delta() {
+	delete ota.delta;
+	ota.delta = NULL;
+}
+
+static void ota_start(uint32_t length) {
+	ota.result = HTML_SUCCESS;
+	ota.bytes = 0;
+	ota.length = length;
+	ota.start_ms = ota.report_ms = millis();
+	ota.sha256[0] = 0;
+	ota_free_delta();
+}
+
+static bool ota_begin() {
+	uint32_t maxSketchSpace = (ESP.getFreeSketchSpace()-0x1000)&0xFFFFF000;
+	if(!Update.begin(maxSketchSpace)) {
+		DEBUG_PRINTLN(F("not enough space"));
+		return false;
+	}
+	br_sha256_init(&ota.sha);
+	return true;
+}
+
+// ends a failed update
+static void ota_fail(byte result) {
+	DEBUG_PRINT(F("update failed: "));
+	DEBUG_PRINTLN(result);
+	ota.result = result;
+	if(Update.isRunning()) Update.end(false);
+	ota_free_delta();
+	ota_report(true);
+}
+
+// returns HTML_SUCCESS, or the result to fail the update with
+static byte ota_write(const uint8_t *buf, size_t len) {
+	if(!ota.bytes && DeltaPatcher::is_patch(buf, len)) {
+		DEBUG_PRINTLN(F("patch"));
+		ota.delta = new DeltaPatcher();
+	}
+	if(ota.delta) {
+		if(!ota.delta->write(buf, len)) {
+			byte e = ota.delta->error();
+			DEBUG_PRINT(F("patch failed: "));
+			DEBUG_PRINTLN(e);
+			// a patch for another firmware, or one that gives the wrong image, is a mismatch
+			return (e == DeltaPatcher::WRONG_BASE || e == DeltaPatcher::BAD_IMAGE) ? HTML_MISMATCH : HTML_UPLOAD_FAILED;
+		}
+	} else if(Update.write((uint8_t*)buf, len) != len) {
+		DEBUG_PRINTLN(F("write failed"));  // e.g. not a firmware image, or too large
+		return HTML_UPLOAD_FAILED;
+	}
+	br_sha256_update(&ota.sha, buf, len);
+	ota.bytes += len;
+	ota_report(false);
+	return HTML_SUCCESS;
+}
+
+/* Checks the complete file against the hex digest sha256 (if not NULL).
+ * The new firmware is activated by a later Update.end(true). */
+static byte ota_finish(const char *sha256) {
+	byte digest[br_sha256_SIZE];
+	br_sha256_out(&ota.sha, digest);
+	for(byte i=0;i<br_sha256_SIZE;i++) {
+		ota.sha256[2*i] = tolower(dec2hexchar(digest[i]>>4));
+		ota.sha256[2*i+1] = tolower(dec2hexchar(digest[i]&0x0F));
+	}
+	ota.sha256[2*br_sha256_SIZE] = 0;
+	if(sha256 && strcasecmp(sha256, ota.sha256)) {
+		DEBUG_PRINTLN(F("hash mismatch"));
+		ota_fail(HTML_MISMATCH);
+	} else if(ota.delta && !ota.delta->done()) {
+		DEBUG_PRINTLN(F("patch incomplete"));
+		ota_fail(HTML_UPLOAD_FAILED);
 	} else {
-		if(req.isCloudRequest()) otf_send_result(res, HTML_NOT_PERMITTED, "fw update");
-		otf_send_compressed_P(res, (const __FlashStringHelper*)sta_update_html_gz, sta_update_html_gz_len);
+		ota_free_delta();
+		ota_report(true);
 	}
+	return ota.result;
 }
 
-void on_firmware_upload_fin() {
+static void ota_pull_cancel();
+static bool upload_refused;  // by the key check, which leaves a pull in progress alone
 
-	// Verify the device key.
-	if(!(updateServer->hasArg("dkey") && (updateServer->arg("dkey") == og.options[OPTION_DKEY].sval))) {
-		updateserver_send_result(HTML_UNAUTHORIZED);
-		Update.end(false); // Update.reset(); FAB
+// refuses the rest of the upload
+static void ota_abort(byte result) {
+	ota_fail(result);
+	updateserver_send_result(result);
+	updateServer->client().stop();
+}
+
+void on_firmware_upload_fin() {
+	if(upload_refused) return;  // answered by the key check
+	if(ota.result != HTML_SUCCESS) {  // failed after the last piece, e.g. on the hash
+		if(updateServer->client().connected()) updateserver_send_result(ota.result);  // else ota_abort() answered
 		return;
 	}
 
@@ -1117,35 +1935,379 @@ void on_update_options() {
 	updateServer->send(200, "text/plain", "");
 }
 
+/* Firmware upload on the update server. The device key (and optionally
+ * the SHA-256 of the file) come in the URL query, or in form fields sent
+ * before the file part: the core keeps those, and hasArg() looks at them
+ * first, by the time the upload starts. A dkey field after the file comes
+ * too late, the upload is refused. A refused or failing upload gets its
+ * result right away and the connection is closed, which stops the client
+ * from sending the rest. Only an upload with the right key cancels a
+ * pulled update. */
 void on_firmware_upload() {
 	HTTPUpload& upload = updateServer->upload();
 	if(upload.status == UPLOAD_FILE_START){
+		// Verify the device key.
+		upload_refused = !(updateServer->hasArg("dkey") && (updateServer->arg("dkey") == og.sval(OPTION_DKEY)));
+		if(upload_refused) {
+			updateserver_send_result(HTML_UNAUTHORIZED);
+			updateServer->client().stop();
+			return;
+		}
+		// Update.begin() refuses while a pull holds the updater; it only
+		// fails otherwise if no image fits, which a pull could not install either
+		ota_pull_cancel();
+		ota_start(upload.contentLength);
 		if(curr_mode == OG_MOD_STA) {
-			DEBUG_PRINTLN(F("Stopping all network clients"));
+			DEBUG_PRINTLN(F("Stopping network clients"));
 			WiFiUDP::stopAll();
 			Blynk.disconnect(); // disconnect Blynk during firmware upload
-			mqttclient.disconnect();
 		}
 		DEBUG_PRINT(F("prepare to upload: "));
 		DEBUG_PRINTLN(upload.filename);
-		uint32_t maxSketchSpace = (ESP.getFreeSketchSpace()-0x1000)&0xFFFFF000;
-		if(!Update.begin(maxSketchSpace)) {
-			DEBUG_PRINTLN(F("not enough space"));
+		if(!ota_begin()) {
+			ota_abort(HTML_UPLOAD_FAILED);
+			return;
 		}
 	} else if(upload.status == UPLOAD_FILE_WRITE) {
+		if(upload_refused || ota.result != HTML_SUCCESS) return;
 		DEBUG_PRINT(".");
-		if(Update.write(upload.buf, upload.currentSize) != upload.currentSize) {
-			DEBUG_PRINTLN(F("size mismatch"));
-		}
+		byte result = ota_write(upload.buf, upload.currentSize);
+		if(result != HTML_SUCCESS) ota_abort(result);
 	} else if(upload.status == UPLOAD_FILE_END) {
+		if(upload_refused || ota.result != HTML_SUCCESS) return;
 		DEBUG_PRINTLN(F("upload completed"));
+		ota_finish(updateServer->hasArg("sha256") ? updateServer->arg("sha256").c_str() : NULL);
 	} else if(upload.status == UPLOAD_FILE_ABORTED){
-		Update.end();
+		if(!upload_refused && ota.result == HTML_SUCCESS) ota_fail(HTML_UPLOAD_FAILED);
 		DEBUG_PRINTLN(F("upload aborted"));
 	}
 	delay(0);
 }
 
+/* Pull updates. With an update manifest url set, the controller checks it
+ * during the update window (UTC hours ouws to ouwe; the whole day if they
+ * are equal) and installs newer firmware once the door is closed. The
+ * manifest is a text file of name=value lines:
+ *
+ *   version=125
+ *   url=http://192.168.1.10/og_1.2.5.bin
+ *   size=564832
+ *   sha256=<hex digest of the file>
+ *
+ * The url (which can also be a path on the manifest's server) gives a
+ * firmware image or a patch. It is fetched in ranges of OTA_CHUNK_SIZE,
+ * one request at a time, from the main loop. A request that fails is
+ * retried from where it stopped, after a delay that doubles from
+ * OTA_RETRY_MIN up to OTA_RETRY_MAX. A file that does not verify, or is
+ * refused by the updater, is not fetched again until the manifest names
+ * another version. A download still going when the window closes is
+ * dropped; a verified one waits for the next window. An upload to the
+ * update server cancels either. */
+enum {
+	PULL_IDLE = 0,
+	PULL_MANIFEST, // manifest requested
+	PULL_CHUNK,    // range requested
+	PULL_RETRY,    // waiting to request the range again
+	PULL_READY     // verified, waiting for the door to close
+};
+
+static WiFiClient pullclient;
+static struct {
+	byte state;
+	ulong next_check;      // curr_utc_time
+	ulong retry_ms;
+	ulong deadline_ms;     // of the request
+	uint16_t retry_delay;  // seconds
+	uint16_t version;
+	uint16_t bad_version;  // its file did not verify
+	uint32_t size;
+	uint32_t chunk_end;    // of the range requested
+	uint32_t skip;         // bytes the server sends again
+	int status;            // of the response, 0 while the status line is read
+	bool body;             // the response headers are done
+	byte len;
+	char line[TMP_BUFFER_SIZE+16];  // manifest or header line
+	char url[TMP_BUFFER_SIZE+1];
+	char sha256[65];
+} pull;
+
+static bool in_update_window() {
+	if(curr_utc_time < NTP_VALID_TIME) return false;
+	ulong from = og.ival(OPTION_OUWS), to = og.ival(OPTION_OUWE);
+	if(from == to) return true;
+	if(from < to) return curr_utc_hour >= from && curr_utc_hour < to;
+	return curr_utc_hour >= from || curr_utc_hour < to;  // across midnight
+}
+
+// requests url, bytes [from, to) of it if to is not 0
+static bool pull_request(const char *url, uint32_t from, uint32_t to) {
+	char host[64];
+	uint16_t port = 80;
+	const char *p = url + 7;
+	const char *path = p + strcspn(p, ":/");
+	bool ok = !strncmp_P(url, PSTR("http://"), 7) && path != p && (size_t)(path - p) < sizeof(host);
+	if(ok) {
+		memcpy(host, p, path - p);
+		host[path - p] = 0;
+		if(*path == ':') port = strtoul(path+1, (char**)&path, 10);
+		ok = *path == '/';
+	}
+	if(!ok) {
+		DEBUG_PRINT(F("not an http:// url: "));
+		DEBUG_PRINTLN(url);
+		return false;
+	}
+	pullclient.setTimeout(OTA_CONNECT_TIMEOUT);  // bounds the name lookup and connect, which block the loop
+	if(!pullclient.connect(host, port)) {
+		DEBUG_PRINT(F("cannot connect to "));
+		DEBUG_PRINTLN(host);
+		return false;
+	}
+	pullclient.print(F("GET "));
+	pullclient.print(path);
+	pullclient.print(F(" HTTP/1.1\r\nHost: "));
+	pullclient.print(host);
+	if(to) {
+		pullclient.print(F("\r\nRange: bytes="));
+		pullclient.print(from);
+		pullclient.print('-');
+		pullclient.print(to-1);
+	}
+	pullclient.print(F("\r\nConnection: close\r\n\r\n"));
+	pull.status = 0;
+	pull.body = false;
+	pull.len = 0;
+	pull.deadline_ms = millis() + OTA_HTTP_TIMEOUT;
+	return true;
+}
+
+// the request failed; the range is asked for again later
+static void pull_retry() {
+	pullclient.stop();
+	pull.state = PULL_RETRY;
+	pull.retry_ms = millis() + pull.retry_delay*1000UL;
+	DEBUG_PRINT(F("download stalled at "));
+	DEBUG_PRINT(ota.bytes);
+	DEBUG_PRINT(F(", retry in "));
+	DEBUG_PRINTLN(pull.retry_delay);
+	pull.retry_delay = pull.retry_delay*2 < OTA_RETRY_MAX ? pull.retry_delay*2 : OTA_RETRY_MAX;
+}
+
+static void pull_fetch_chunk() {
+	pull.chunk_end = ota.bytes + OTA_CHUNK_SIZE < pull.size ? ota.bytes + OTA_CHUNK_SIZE : pull.size;
+	pull.skip = 0;
+	if(pull_request(pull.url, ota.bytes, pull.chunk_end)) pull.state = PULL_CHUNK;
+	else pull_retry();
+}
+
+// the file is bad: not fetched again for this version
+static void pull_fail(byte result) {
+	pullclient.stop();
+	ota_fail(result);
+	pull.bad_version = pull.version;
+	pull.state = PULL_IDLE;
+}
+
+static void ota_pull_cancel() {
+	pullclient.stop();
+	if(pull.state >= PULL_CHUNK) ota_fail(HTML_UPLOAD_FAILED);
+	pull.state = PULL_IDLE;
+}
+
+/* Reads a response line into pull.line; true once it is complete. Lines
+ * too long for the buffer are cut. */
+static bool pull_read_line() {
+	while(pullclient.available()) {
+		char c = pullclient.read();
+		if(c == '\n') {
+			if(pull.len && pull.line[pull.len-1] == '\r') pull.len--;
+			pull.line[pull.len] = 0;
+			pull.len = 0;
+			return true;
+		}
+		if(pull.len < sizeof(pull.line)-1) pull.line[pull.len++] = c;
+	}
+	return false;
+}
+
+// reads the status line and headers; true once the body starts
+static bool pull_read_head() {
+	while(!pull.body && pull_read_line()) {
+		pull.deadline_ms = millis() + OTA_HTTP_TIMEOUT;
+		if(!pull.status) {
+			const char *sp = strchr(pull.line, ' ');
+			pull.status = sp ? atoi(sp+1) : -1;
+		} else if(!pull.line[0]) {
+			pull.body = true;
+		} else if(pull.state == PULL_CHUNK && !strncasecmp_P(pull.line, PSTR("Content-Range: bytes "), 21)) {
+			if(strtoul(pull.line+21, NULL, 10) != ota.bytes) pull.status = -1;  // not the range asked for
+		}
+	}
+	return pull.body;
+}
+
+// takes a name=value line of the manifest
+static void pull_manifest_line() {
+	char *v = strchr(pull.line, '=');
+	if(!v) return;
+	*v++ = 0;
+	if(!strcmp_P(pull.line, PSTR("version"))) {
+		pull.version = strtoul(v, NULL, 10);
+	} else if(!strcmp_P(pull.line, PSTR("size"))) {
+		pull.size = strtoul(v, NULL, 10);
+	} else if(!strcmp_P(pull.line, PSTR("sha256"))) {
+		strncpy(pull.sha256, v, sizeof(pull.sha256)-1);
+		pull.sha256[sizeof(pull.sha256)-1] = 0;
+	} else if(!strcmp_P(pull.line, PSTR("url"))) {
+		if(v[0] == '/') {  // a path on the manifest's server
+			const char *murl = og.sval(OPTION_OURL).c_str();
+			size_t n = strchr(murl+7, '/') ? strchr(murl+7, '/') - murl : strlen(murl);
+			if(n + strlen(v) >= sizeof(pull.url)) return;
+			memcpy(pull.url, murl, n);
+			strcpy(pull.url+n, v);
+		} else if(strlen(v) < sizeof(pull.url)) {
+			strcpy(pull.url, v);
+		}
+	}
+}
+
+// the manifest is in: fetches the file if it is new firmware
+static void pull_manifest_done() {
+	pullclient.stop();
+	pull.state = PULL_IDLE;
+	DEBUG_PRINT(F("manifest: version "));
+	DEBUG_PRINTLN(pull.version);
+	if(pull.status != 200 || pull.version <= OG_FWV || pull.version == pull.bad_version ||
+	   !pull.url[0] || !pull.size || strlen(pull.sha256) != 2*br_sha256_SIZE) return;
+	if(Update.isRunning()) return;  // an upload is in progress
+	ota_start(pull.size);
+	if(!ota_begin()) {
+		ota_fail(HTML_UPLOAD_FAILED);
+		return;
+	}
+	DEBUG_PRINT(F("downloading "));
+	DEBUG_PRINTLN(pull.url);
+	pull.retry_delay = OTA_RETRY_MIN;
+	pull_fetch_chunk();
+}
+
+// takes the body of a range response
+static void pull_read_chunk() {
+	if(pull.status == 200) {  // the server sends the whole file
+		pull.skip = ota.bytes;
+		pull.chunk_end = pull.size;
+		pull.status = 206;
+	}
+	if(pull.status != 206) {
+		pull_retry();
+		return;
+	}
+	uint8_t buf[256];
+	size_t budget = OTA_READ_MAX;
+	while(budget && ota.bytes < pull.chunk_end) {
+		size_t n = pullclient.available();
+		if(!n) break;
+		if(n > sizeof(buf)) n = sizeof(buf);
+		if(pull.skip) {
+			if(n > pull.skip) n = pull.skip;
+		} else if(n > pull.chunk_end - ota.bytes) {
+			n = pull.chunk_end - ota.bytes;
+		}
+		n = pullclient.read(buf, n);
+		budget -= n;
+		pull.deadline_ms = millis() + OTA_HTTP_TIMEOUT;
+		if(pull.skip) {
+			pull.skip -= n;
+			continue;
+		}
+		byte result = ota_write(buf, n);
+		if(result != HTML_SUCCESS) {
+			pull_fail(result);
+			return;
+		}
+	}
+	if(ota.bytes < pull.chunk_end) return;
+	pullclient.stop();
+	pull.retry_delay = OTA_RETRY_MIN;
+	if(ota.bytes < pull.size) {
+		pull_fetch_chunk();
+		return;
+	}
+	DEBUG_PRINTLN(F("download completed"));
+	if(ota_finish(pull.sha256) == HTML_SUCCESS) {
+		pull.state = PULL_READY;
+	} else {
+		pull.bad_version = pull.version;  // ota_finish() failed the update
+		pull.state = PULL_IDLE;
+	}
+}
+
+void ota_pull_loop() {
+	if(!og.sval(OPTION_OURL).length()) {
+		if(pull.state != PULL_IDLE) ota_pull_cancel();
+		return;
+	}
+	bool window = in_update_window();
+	if(pull.state != PULL_IDLE && pull.state != PULL_READY && !window) {  // try again in the next window
+		DEBUG_PRINTLN(F("update window closed"));
+		ota_pull_cancel();
+		return;
+	}
+	switch(pull.state) {
+	case PULL_IDLE:
+		if(!window || curr_utc_time < pull.next_check) break;
+		pull.next_check = curr_utc_time + OTA_CHECK_INTERVAL;
+		pull.version = 0;
+		pull.size = 0;
+		pull.url[0] = 0;
+		pull.sha256[0] = 0;
+		if(pull_request(og.sval(OPTION_OURL).c_str(), 0, 0)) pull.state = PULL_MANIFEST;
+		break;
+
+	case PULL_MANIFEST:
+		if(pull_read_head()) {
+			while(pull_read_line()) pull_manifest_line();
+		}
+		if(!pullclient.connected() && !pullclient.available()) {
+			if(pull.len) {  // last line without a newline
+				pull.line[pull.len] = 0;
+				pull.len = 0;
+				pull_manifest_line();
+			}
+			pull_manifest_done();
+		} else if((long)(millis() - pull.deadline_ms) >= 0) {
+			pullclient.stop();
+			pull.state = PULL_IDLE;
+		}
+		break;
+
+	case PULL_CHUNK:
+		if(pull_read_head()) pull_read_chunk();
+		if(pull.state == PULL_CHUNK && ((!pullclient.connected() && !pullclient.available()) ||
+		   (long)(millis() - pull.deadline_ms) >= 0)) {
+			pull_retry();
+		}
+		break;
+
+	case PULL_RETRY:
+		if((long)(millis() - pull.retry_ms) >= 0) pull_fetch_chunk();
+		break;
+
+	case PULL_READY:
+		if(!window || door_status != DOOR_STATUS_CLOSED) break;
+		pull.state = PULL_IDLE;
+		if(!Update.end(true) || Update.hasError()) {
+			DEBUG_PRINTLN(F("OTA update failed: "));
+			Update.printError(Serial);
+			ota_fail(HTML_UPLOAD_FAILED);
+			break;
+		}
+		DEBUG_PRINTLN(F("installing pulled firmware"));
+		restart_in(1000);
+		break;
+	}
+}
+
 void check_status_ap() {
 	static ulong cs_timeout = 0;
 	if((long)(millis() - cs_timeout) > 0) {
@@ -1161,21 +2323,44 @@ void check_status_ap() {
 
 // Debug callback for garagelib - publishes Security+ debug messages to MQTT
 void mqtt_debug_callback(const char* message) {
-	if (og.options[OPTION_DBEN].ival && og.options[OPTION_MQEN].ival &&
+	if (og.ival(OPTION_DBEN) && og.ival(OPTION_MQEN) &&
 	    mqttclient.connected() && mqtt_debug_topic.length() > 0) {
 		mqttclient.publish(mqtt_debug_topic.c_str(), message);
 	}
 }
 
+// Publishes per-stage average and worst-case loop times (in microseconds),
+// in loop_stage_names order, to <topic>/OUT/PERF while debug is enabled
+void mqtt_publish_perf() {
+	static ulong perf_publish_timeout = 0;
+	if(!og.ival(OPTION_DBEN) || curr_utc_time < perf_publish_timeout) return;
+	perf_publish_timeout = curr_utc_time + PERF_PUBLISH_INTERVAL;
+	char buf[JSON_BUFFER_SIZE];
+	JsonWriter json(buf, sizeof(buf));
+	json.beginObject();
+	json.beginArray(F("avg"));
+	for(byte i=0;i<NUM_LOOP_STAGES;i++) {
+		uint32_t n = 0;
+		for(byte b=0;b<LOOP_PROF_BUCKETS;b++) n += loop_prof_hist[i][b];
+		json.item((ulong)(n ? loop_prof_sum[i] / n : 0));
+	}
+	json.endArray();
+	json.beginArray(F("max"));
+	for(byte i=0;i<NUM_LOOP_STAGES;i++) json.item((ulong)loop_prof_max[i]);
+	json.endArray();
+	json.endObject();
+	if(!json.overflow()) mqttclient.publish((mqtt_topic + "/OUT/PERF").c_str(), json.c_str());
+}
+
 bool mqtt_connect_subscribe() {
 	static ulong mqtt_subscribe_timeout = 0;
 	if(curr_utc_time > mqtt_subscribe_timeout) {
 		if (!mqttclient.connected()) {
 			DEBUG_PRINT(F("MQTT Not connected- (Re)connect MQTT"));
 			boolean ret;
-			if(og.options[OPTION_MQUR].sval.length()>0) { // if MQTT user name is defined
+			if(og.sval(OPTION_MQUR).length()>0) { // if MQTT user name is defined
 				DEBUG_PRINT(F(" (authenticated)"));
-				ret = mqttclient.connect(mqtt_id.c_str(), og.options[OPTION_MQUR].sval.c_str(), og.options[OPTION_MQPW].sval.c_str(), (mqtt_topic+"/OUT/STATUS").c_str(), 1, true, "offline");
+				ret = mqttclient.connect(mqtt_id.c_str(), og.sval(OPTION_MQUR).c_str(), og.sval(OPTION_MQPW).c_str(), (mqtt_topic+"/OUT/STATUS").c_str(), 1, true, "offline");
 			}
 			else {
 				DEBUG_PRINT(F(" [anonymous]"));
@@ -1186,7 +2371,7 @@ bool mqtt_connect_subscribe() {
 				mqttclient.subscribe((mqtt_topic +"/IN/#").c_str());
 				mqttclient.publish((mqtt_topic+"/OUT/STATUS").c_str(), "online", true);
 				// Send test message to verify debug logging works
-				if (og.options[OPTION_DBEN].ival && mqtt_debug_topic.length() > 0) {
+				if (og.ival(OPTION_DBEN) && mqtt_debug_topic.length() > 0) {
 					mqttclient.publish(mqtt_debug_topic.c_str(), "[DEBUG] MQTT debug logging enabled");
 				}
 				DEBUG_PRINTLN(F("......Success, Subscribed to MQTT Topic"));
@@ -1202,114 +2387,247 @@ bool mqtt_connect_subscribe() {
 	return false;
 }
 
-void blynkNotify(String s){
-	// Blynk notification
+static void notify_release() {
+	while(notify_count && !notify_outbox[notify_head].pending) {
+		notify_head = (notify_head+1) % NOTIFY_OUTBOX_SIZE;
+		notify_count--;
+	}
+}
+
+// finish the current message on a channel, or schedule a retry
+static void notify_done(byte ch, bool ok) {
+	NotifyChannel &c = notify_channels[ch];
+	if(!ok && c.attempts < NOTIFY_MAX_RETRIES) {
+		DEBUG_PRINT(notify_channel_names[ch]);
+		DEBUG_PRINTLN(F(" notification failed, will retry"));
+		c.state = NOTIFY_STATE_BACKOFF;
+		c.timeout = millis() + ((ulong)NOTIFY_RETRY_DELAY << c.attempts);
+		c.attempts++;
+		c.retries++;
+		return;
+	}
+	if(ok) c.sent++;
+	else c.failed++;
+	notify_outbox[c.slot].pending &= ~(1<<ch);
+	c.state = NOTIFY_STATE_IDLE;
+	c.attempts = 0;
+	notify_release();
+}
+
+static void notify_drop_oldest() {
+	NotifyMessage &m = notify_outbox[notify_head];
+	for(byte ch=0;ch<NUM_NOTIFY_CHANNELS;ch++) {
+		if(!(m.pending & (1<<ch))) continue;
+		NotifyChannel &c = notify_channels[ch];
+		if(c.state != NOTIFY_STATE_IDLE && c.slot == notify_head) {
+			if(ch == NOTIFY_CH_IFTTT) httpclient.stop();
+			if(ch == NOTIFY_CH_EMAIL) emailSend.abortSend();
+			c.state = NOTIFY_STATE_IDLE;
+			c.attempts = 0;
+		}
+		c.dropped++;
+	}
+	m.pending = 0;
+	notify_release();
+}
+
+bool blynkNotify(const char *s){
+	if(!Blynk.connected()) return false;
 	DEBUG_PRINTLN(F(" Sending blynk notification"));
 	Blynk.notify(s);
+	return true;
 }
 
-void iftttNotify(String s){
+// sends the webhook request; the response is picked up by iftttPoll()
+bool iftttNotify(const char *s){
 	DEBUG_PRINTLN(" Sending IFTTT Notification");
-	http.begin(httpclient, "http://maker.ifttt.com/trigger/opengarage/with/key/"+og.options[OPTION_IFTT].sval);
-	http.addHeader("Content-Type", "application/json");
-	http.POST("{\"value1\":\""+s+"\"}");
-	String payload = http.getString();
-	http.end();
-	if(payload.indexOf("Congratulations") >= 0) {
-		DEBUG_PRINTLN(" Successfully updated IFTTT");
-	}else{
-		DEBUG_PRINT(" Error from IFTTT: ");
-		DEBUG_PRINTLN(payload);
+	if(!httpclient.connect("maker.ifttt.com", 80)) {
+		DEBUG_PRINTLN(" IFTTT connection failed");
+		return false;
+	}
+	size_t len = strlen(s) + 13; // {"value1":"..."}
+	httpclient.print(F("POST /trigger/opengarage/with/key/"));
+	httpclient.print(og.sval(OPTION_IFTT));
+	httpclient.print(F(" HTTP/1.1\r\nHost: maker.ifttt.com\r\nContent-Type: application/json\r\nConnection: close\r\nContent-Length: "));
+	httpclient.print(len);
+	httpclient.print(F("\r\n\r\n{\"value1\":\""));
+	httpclient.print(s);
+	httpclient.print(F("\"}"));
+	return true;
+}
+
+// returns 1 on success, 0 on failure and -1 while the response is incomplete
+int iftttPoll(ulong deadline){
+	static char status[16]; // just enough of the status line to see the code
+	static byte len = 0;
+	while(httpclient.available()) {
+		char c = httpclient.read();
+		if(c == '\n' || len == sizeof(status)-1) {
+			status[len] = 0;
+			len = 0;
+			httpclient.stop();
+			if(strstr(status, " 200")) {
+				DEBUG_PRINTLN(" Successfully updated IFTTT");
+				return 1;
+			}
+			DEBUG_PRINT(" Error from IFTTT: ");
+			DEBUG_PRINTLN(status);
+			return 0;
+		}
+		status[len++] = c;
 	}
+	if(!httpclient.connected() || (long)(millis()-deadline) >= 0) {
+		len = 0;
+		httpclient.stop();
+		DEBUG_PRINTLN(" IFTTT response timed out");
+		return 0;
+	}
+	return -1;
 }
 
-void emailNotify(String s){
+// starts the SMTP session; emailPoll() drives it from then on
+bool emailNotify(const char *s){
 	DEBUG_PRINTLN(" Sending EMail notification");
 	DEBUG_PRINTLN(GET_FREE_HEAP);
 	EMailSender::EMailMessage email_message;
-	email_message.subject = og.options[OPTION_NAME].sval.c_str();
+	email_message.subject = og.sval(OPTION_NAME);
 	email_message.message = s;
-	const char *email_host = og.options[OPTION_SMTP].sval.c_str();
-	const char *email_pword = og.options[OPTION_APWD].sval.c_str();
-	const char *email_sender = og.options[OPTION_SEND].sval.c_str();
-	const char *email_recip = og.options[OPTION_RECP].sval.c_str();
-	unsigned int email_port = og.options[OPTION_SPRT].ival;
+	const char *email_host = og.sval(OPTION_SMTP).c_str();
+	const char *email_pword = og.sval(OPTION_APWD).c_str();
+	const char *email_sender = og.sval(OPTION_SEND).c_str();
+	const char *email_recip = og.sval(OPTION_RECP).c_str();
+	unsigned int email_port = og.ival(OPTION_SPRT);
 	if(email_host && email_pword && email_sender && email_recip){
-		EMailSender emailSend(email_sender, email_pword);
+		emailSend.setEMailLogin(email_sender);
+		emailSend.setEMailFrom(email_sender);
+		emailSend.setEMailPassword(email_pword);
 		emailSend.setSMTPServer(email_host);
 		emailSend.setSMTPPort(email_port);
-		DEBUG_PRINTLN(GET_FREE_HEAP);
-		EMailSender::Response resp = emailSend.send(email_recip, email_message);
+		return emailSend.beginSend(email_recip, email_message);
 	}
+	return false;
 }
 
-void mqttNotify(String s){
-	if (mqttclient.connected()) {
-		DEBUG_PRINTLN(" Sending MQTT Notification");
-		mqttclient.publish((mqtt_topic + "/OUT/NOTIFY").c_str(),s.c_str());
+// returns 1 on success, 0 on failure and -1 while the session is still going
+int emailPoll(){
+	switch(emailSend.poll()) {
+	case EMailSender::SEND_DONE:
+		DEBUG_PRINTLN(" EMail sent");
+		return 1;
+	case EMailSender::SEND_BUSY:
+		return -1;
+	default:
+		DEBUG_PRINT(" EMail failed: ");
+		DEBUG_PRINTLN(emailSend.result().desc);
+		return 0;
 	}
 }
 
+bool mqttNotify(const char *s){
+	if (!mqttclient.connected()) return false;
+	DEBUG_PRINTLN(" Sending MQTT Notification");
+	return mqttclient.publish((mqtt_topic + "/OUT/NOTIFY").c_str(), s);
+}
+
 void perform_notify(String s) {
-	DEBUG_PRINT(F("Sending Notify to connected systems, value:"));
+	DEBUG_PRINT(F("Queueing notification, value:"));
 	DEBUG_PRINTLN(s);
 
-	if(og.options[OPTION_CLD].ival==CLOUD_BLYNK && Blynk.connected()){
-		blynkNotify(s);
-	}
-
-	// IFTTT notification
-	if(og.options[OPTION_IFTT].sval.length()>7) { // key size is at least 8
-		iftttNotify(s);
-	}
-
-	// Email notification
-	if(og.options[OPTION_EMEN].ival>0) {
-		emailNotify(s);
-	}
-
-	//Mqtt notification
-	if(og.options[OPTION_MQEN].ival>0 && valid_url(og.options[OPTION_MQTT].sval)) {
-		mqttNotify(s);
+	byte channels = 0;
+	if(og.ival(OPTION_CLD)==CLOUD_BLYNK) channels |= 1<<NOTIFY_CH_BLYNK;
+	if(og.sval(OPTION_IFTT).length()>7) channels |= 1<<NOTIFY_CH_IFTTT; // key size is at least 8
+	if(og.ival(OPTION_EMEN)>0) channels |= 1<<NOTIFY_CH_EMAIL;
+	if(og.ival(OPTION_MQEN)>0 && valid_url(og.sval(OPTION_MQTT))) channels |= 1<<NOTIFY_CH_MQTT;
+	if(!channels) return;
+
+	if(notify_count == NOTIFY_OUTBOX_SIZE) notify_drop_oldest();
+	NotifyMessage &m = notify_outbox[(notify_head+notify_count) % NOTIFY_OUTBOX_SIZE];
+	strncpy(m.text, s.c_str(), NOTIFY_MSG_SIZE-1);
+	m.text[NOTIFY_MSG_SIZE-1] = 0;
+	m.pending = channels;
+	notify_count++;
+}
+
+// moves every channel one step forward
+void notify_loop() {
+	for(byte ch=0;ch<NUM_NOTIFY_CHANNELS;ch++) {
+		NotifyChannel &c = notify_channels[ch];
+		if(c.state == NOTIFY_STATE_WAIT) {
+			int ret = (ch == NOTIFY_CH_IFTTT) ? iftttPoll(c.timeout) : emailPoll();
+			if(ret >= 0) notify_done(ch, ret > 0);
+			continue;
+		}
+		if(c.state == NOTIFY_STATE_BACKOFF) {
+			if((long)(millis()-c.timeout) < 0) continue;
+		} else {
+			// pick the oldest message this channel has not delivered yet
+			byte i;
+			for(i=0;i<notify_count;i++) {
+				byte slot = (notify_head+i) % NOTIFY_OUTBOX_SIZE;
+				if(notify_outbox[slot].pending & (1<<ch)) { c.slot = slot; break; }
+			}
+			if(i == notify_count) continue;
+		}
+		const char *text = notify_outbox[c.slot].text;
+		switch(ch) {
+		case NOTIFY_CH_BLYNK:
+			notify_done(ch, blynkNotify(text));
+			break;
+		case NOTIFY_CH_IFTTT:
+			if(iftttNotify(text)) {
+				c.state = NOTIFY_STATE_WAIT;
+				c.timeout = millis() + NOTIFY_HTTP_TIMEOUT;
+			} else {
+				notify_done(ch, false);
+			}
+			break;
+		case NOTIFY_CH_EMAIL:
+			if(emailNotify(text)) c.state = NOTIFY_STATE_WAIT;
+			else notify_done(ch, false);
+			break;
+		case NOTIFY_CH_MQTT:
+			notify_done(ch, mqttNotify(text));
+			break;
+		}
 	}
 }
 
 void process_dynamics(byte event) {
 	static bool automationclose_triggered=false;
-	byte ato = og.options[OPTION_ATO].ival;
-	byte atob = og.options[OPTION_ATOB].ival;
-	byte noto = og.options[OPTION_NOTO].ival;
+	byte ato = og.ival(OPTION_ATO);
+	byte atob = og.ival(OPTION_ATOB);
+	byte noto = og.ival(OPTION_NOTO);
 	if(!ato && !atob && !noto) {
 		justopen_timestamp = 0;
 		return;
 	}
 	if(event == DOOR_EVENT_JUST_OPENED) {
 		justopen_timestamp = curr_utc_time; // record time stamp
-		if (noto & OG_NOTIFY_DO) { perform_notify(og.options[OPTION_NAME].sval + " just OPENED!");}
+		if (noto & OG_NOTIFY_DO) { perform_notify(og.sval(OPTION_NAME) + " just OPENED!");}
 
 		// If the door is set to auto close at a certain hour, ensure if manually opened it doesn't autoshut
-		if( (curr_utc_hour == og.options[OPTION_ATIB].ival) && (!automationclose_triggered) ){
+		if( (curr_utc_hour == og.ival(OPTION_ATIB)) && (!automationclose_triggered) ){
 			DEBUG_PRINTLN(" Door opened during automation hour, set to not auto-close ");
 			automationclose_triggered=true;
 		}
 
 	} else if (event == DOOR_EVENT_JUST_CLOSED) {
 		justopen_timestamp = 0; // reset time stamp
-		if (noto & OG_NOTIFY_DC) { perform_notify(og.options[OPTION_NAME].sval + " just CLOSED!");}
+		if (noto & OG_NOTIFY_DC) { perform_notify(og.sval(OPTION_NAME) + " just CLOSED!");}
 
 	} else if (event == DOOR_EVENT_JUST_STOPPED) {
 		justopen_timestamp = 0; // reset time stamp
-		if (noto & OG_NOTIFY_DS) { perform_notify(og.options[OPTION_NAME].sval + " just STOPPED!");}
+		if (noto & OG_NOTIFY_DS) { perform_notify(og.sval(OPTION_NAME) + " just STOPPED!");}
 
 	}	else if (event == DOOR_EVENT_REMAIN_OPEN) {
 		if (!justopen_timestamp) justopen_timestamp = curr_utc_time; // record time stamp
 		else {
-			if(curr_utc_time > justopen_timestamp + (ulong)og.options[OPTION_ATI].ival*60L) {
+			if(curr_utc_time > justopen_timestamp + (ulong)og.ival(OPTION_ATI)*60L) {
 				// reached timeout, perform action
 				if(ato & OG_AUTO_NOTIFY) {
 					// send notification
-					String s = og.options[OPTION_NAME].sval+" is left open for more than ";
-					s+= og.options[OPTION_ATI].ival;
+					String s = og.sval(OPTION_NAME)+" is left open for more than ";
+					s+= og.ival(OPTION_ATI);
 					s+= " minutes.";
 					if(ato & OG_AUTO_CLOSE) {
 						s+= " It will be auto-closed shortly";
@@ -1321,20 +2639,20 @@ void process_dynamics(byte event) {
 				if(ato & OG_AUTO_CLOSE) {
 					// auto close door
 					// alarm is mandatory in auto-close
-					if(!og.options[OPTION_ALM].ival) { og.set_alarm(OG_ALM_5); }
+					if(!og.ival(OPTION_ALM)) { og.set_alarm(OG_ALM_5); }
 					else { og.set_alarm(); }
 				}
 				justopen_timestamp = 0;
 			}
 
-			if(( curr_utc_hour == og.options[OPTION_ATIB].ival) && (!automationclose_triggered)) {
+			if(( curr_utc_hour == og.ival(OPTION_ATIB)) && (!automationclose_triggered)) {
 				// still open past time, perform action
 				DEBUG_PRINTLN("Door is open at specified close time and automation not yet triggered: ");
 				automationclose_triggered=true;
 				if(atob & OG_AUTO_NOTIFY) {
 					// send notification
-					String s = og.options[OPTION_NAME].sval+" is open after ";
-					s+= og.options[OPTION_ATIB].ival;
+					String s = og.sval(OPTION_NAME)+" is open after ";
+					s+= og.ival(OPTION_ATIB);
 					s+= " UTC. Current hour:";
 					s+= curr_utc_hour;
 					if(atob & OG_AUTO_CLOSE) {
@@ -1347,12 +2665,12 @@ void process_dynamics(byte event) {
 				if(atob & OG_AUTO_CLOSE) {
 					// auto close door
 					// alarm is mandatory in auto-close
-					if(!og.options[OPTION_ALM].ival) { og.set_alarm(OG_ALM_5); }
+					if(!og.ival(OPTION_ALM)) { og.set_alarm(OG_ALM_5); }
 					else { og.set_alarm(); }
 				}
 				justopen_timestamp = 0;
 			}
-			else if ((curr_utc_hour > og.options[OPTION_ATIB].ival) && (automationclose_triggered)) {
+			else if ((curr_utc_hour > og.ival(OPTION_ATIB)) && (automationclose_triggered)) {
 				DEBUG_PRINTLN("Unlocking automation close function");
 				automationclose_triggered=false; //Unlock the hour after the setting
 			}
@@ -1369,7 +2687,7 @@ byte check_door_event() {
 	const byte lowones = (1<<(DOOR_STATUS_HIST_K/2))-1; // 0b0011
 	const byte highones= lowones << (DOOR_STATUS_HIST_K/2); // 0b1100
 
-	if (!og.options[OPTION_SECV].ival) { // non security+
+	if (!og.ival(OPTION_SECV)) { // non security+
 		byte _hist = door_status_hist & allones;  // get the lowest K bits
 		if(_hist == 0) return DOOR_EVENT_REMAIN_CLOSED;
 		if(_hist == allones) return DOOR_EVENT_REMAIN_OPEN;
@@ -1410,6 +2728,41 @@ byte check_door_event() {
 	}
 }
 
+/* Door events seen before the clock is set are held with their uptime and
+ * logged once it is, so records stay in time order and a segment is not
+ * opened for time stamps near 0. */
+static LogStruct log_held[LOG_HOLD_RECORDS];
+static ulong log_held_millis[LOG_HOLD_RECORDS];
+static byte log_held_count = 0;
+
+static void log_event(const LogStruct &l) {
+	if(curr_utc_time >= NTP_VALID_TIME) {
+		og.write_log(l);
+	} else if(log_held_count < LOG_HOLD_RECORDS) {
+		log_held[log_held_count] = l;
+		log_held_millis[log_held_count++] = millis();
+	} else {
+		DEBUG_PRINTLN(F("clock not set, log record dropped"));
+	}
+}
+
+static void log_release_held() {
+	if(!log_held_count || curr_utc_time < NTP_VALID_TIME) return;
+	ulong floor = 0;  // never before the newest record already logged
+	LogStruct l;
+	if(og.log_end_seq() > og.log_first_seq() && og.read_log_at(og.log_end_seq()-1, l)) floor = l.tstamp;
+	og.read_log_end();
+	ulong now = millis();
+	for(byte i=0;i<log_held_count;i++) {
+		l = log_held[i];
+		l.tstamp = curr_utc_time - (now - log_held_millis[i])/1000;
+		if(l.tstamp < floor) l.tstamp = floor;
+		floor = l.tstamp;
+		og.write_log(l);
+	}
+	log_held_count = 0;
+}
+
 void check_status() {
 	static ulong checkstatus_timeout = 0;
 
@@ -1421,26 +2774,26 @@ void check_status() {
 		}
 
 		// Read SN1 -- ultrasonic sensor
-		uint dth = og.options[OPTION_DTH].ival;
-		uint vth = og.options[OPTION_VTH].ival;
+		uint dth = og.ival(OPTION_DTH);
+		uint vth = og.ival(OPTION_VTH);
 		bool sn1_status;
 		distance = og.read_distance();
-		if((distance==0 || distance>500 || !fullbuffer) && og.options[OPTION_SNO].ival!=OG_SNO_2ONLY) {
+		if((distance==0 || distance>500 || !fullbuffer) && og.ival(OPTION_SNO)!=OG_SNO_2ONLY) {
 			// invalid distance value or non full buffer, return immediately except if using SN2 only
 			DEBUG_PRINTLN(F("invalid distance or non-full buffer"));
-			checkstatus_timeout = curr_utc_time + og.options[OPTION_RIV].ival;
+			checkstatus_timeout = curr_utc_time + og.ival(OPTION_RIV);
 			return;
 		}
 
 		sn1_status = (distance>dth)?0:1;
-		if(og.options[OPTION_SN1].ival == OG_SN1_SIDE) {
+		if(og.ival(OPTION_SN1) == OG_SN1_SIDE) {
 			sn1_status = 1-sn1_status; // reverse logic for side mount
 			// for side-mount, we can't decide vehicle status
 			vehicle_status = OG_VEH_NOTAVAIL;
 		} else {
 			vehicle_status = OG_VEH_NOTAVAIL;
 		  if (vth>0) { // if vehicle distance threshold is defined
-				if(og.options[OPTION_SECV].ival>0 || og.options[OPTION_SNO].ival==OG_SNO_2ONLY) {
+				if(og.ival(OPTION_SECV)>0 || og.ival(OPTION_SNO)==OG_SNO_2ONLY) {
 					// if door status is not determined using distance sensor (either using security+ or using SN2 only)
 					// vehicle status can be deduced by checking if distance is less than vth
 					vehicle_status = (distance <=vth) ? OG_VEH_PRESENT:OG_VEH_ABSENT;
@@ -1458,13 +2811,13 @@ void check_status() {
 		// Read SN2 -- optional switch sensor
 		sn2_value = og.get_switch();
 		byte sn2_status = 0;
-		if(og.options[OPTION_SN2].ival == OG_SN2_NC) {	// if SN2 is normally closed type
+		if(og.ival(OPTION_SN2) == OG_SN2_NC) {	// if SN2 is normally closed type
 			sn2_status = sn2_value;
-		} else if(og.options[OPTION_SN2].ival == OG_SN2_NO) {	// if SN2 is normally open type
+		} else if(og.ival(OPTION_SN2) == OG_SN2_NO) {	// if SN2 is normally open type
 			sn2_status = 1-sn2_value;
 		}
 
-		switch (og.options[OPTION_SECV].ival) {
+		switch (og.ival(OPTION_SECV)) {
 			case 1: // SecPlus 1
 			case 2: // SecPlus 2
 				// Handled by the callback function
@@ -1473,14 +2826,14 @@ void check_status() {
 			default: // No secplus
 				// Process Sensor Logic
 				bool status = false;
-				if(og.options[OPTION_SN2].ival==OG_SN2_NONE || og.options[OPTION_SNO].ival==OG_SNO_1ONLY) {
+				if(og.ival(OPTION_SN2)==OG_SN2_NONE || og.ival(OPTION_SNO)==OG_SNO_1ONLY) {
 					// if SN2 not installed or logic is SN1 only
 					status = sn1_status;
-				} else if(og.options[OPTION_SNO].ival==OG_SNO_2ONLY) {
+				} else if(og.ival(OPTION_SNO)==OG_SNO_2ONLY) {
 					status = sn2_status;
-				} else if(og.options[OPTION_SNO].ival==OG_SNO_AND) {
+				} else if(og.ival(OPTION_SNO)==OG_SNO_AND) {
 					status = sn1_status && sn2_status;
-				} else if(og.options[OPTION_SNO].ival==OG_SNO_OR) {
+				} else if(og.ival(OPTION_SNO)==OG_SNO_OR) {
 					status = sn1_status || sn2_status;
 				}
 				door_status = status ? DOOR_STATUS_OPEN : DOOR_STATUS_CLOSED;
@@ -1502,7 +2855,7 @@ void check_status() {
 		read_cnt = (read_cnt+1)%100;
 
 		// once the light is disabled, quit blinking until a restart or a reset to 0.
-		byte blink_limit = og.options[OPTION_BAS].ival;
+		byte blink_limit = og.ival(OPTION_BAS);
 		bool current_light_blink_enabled = light_blink_enabled;
 		light_blink_enabled = blink_limit == OG_LIGHT_BLINK_FOREVER || (light_blink_enabled && read_cnt <= blink_limit);
 
@@ -1513,6 +2866,9 @@ void check_status() {
 		}
 
 		byte event = check_door_event();
+		log_release_held();
+		rollup_update(curr_utc_time, door_status != DOOR_STATUS_CLOSED && door_status != DOOR_STATUS_UNKNOWN,
+		              vehicle_status == OG_VEH_PRESENT, og.ival(OPTION_TSN) ? &tempC : NULL);
 
 		// Log door status changes (only record opened, closed, stopped status changes, as the other statuses are transient)
 		if(event == DOOR_EVENT_JUST_OPENED || event == DOOR_EVENT_JUST_CLOSED || event == DOOR_EVENT_JUST_STOPPED) {
@@ -1523,8 +2879,8 @@ void check_status() {
 			l.status = door_status;
 			l.dist = distance;
 			l.sn2 = 255;	// use 255 to indicate invalid value
-			if(og.options[OPTION_SN2].ival>OG_SN2_NONE) l.sn2 = sn2_value;
-			og.write_log(l);
+			if(og.ival(OPTION_SN2)>OG_SN2_NONE) l.sn2 = sn2_value;
+			log_event(l);
 
 		} //End state change updates
 
@@ -1533,7 +2889,7 @@ void check_status() {
 		if ((curr_utc_time > force_mqtt_update_timeout) ||
 				(event == DOOR_EVENT_JUST_OPENED || event == DOOR_EVENT_JUST_CLOSED || event == DOOR_EVENT_JUST_STOPPED || event == DOOR_EVENT_START_OPENING || event == DOOR_EVENT_START_CLOSING) ){
 			// Mqtt update
-			if(og.options[OPTION_MQEN].ival>0 && valid_url(og.options[OPTION_MQTT].sval) && (mqttclient.connected())) {
+			if(og.ival(OPTION_MQEN)>0 && valid_url(og.sval(OPTION_MQTT)) && (mqttclient.connected())) {
 				//DEBUG_PRINTLN(F(" Update MQTT (State Refresh)"));
 				if(event == DOOR_EVENT_REMAIN_OPEN) {
 					mqttclient.publish((mqtt_topic + "/OUT/STATE").c_str(),"OPEN");
@@ -1545,9 +2901,15 @@ void check_status() {
 					mqttclient.publish((mqtt_topic + "/OUT/STATE").c_str(),"STOPPED");
 					mqttclient.publish(mqtt_topic.c_str(),"Stopped"); //Support existing mqtt code
 				}
-				String msg;
-				sta_controller_fill_json(msg);
-				mqttclient.publish((mqtt_topic + "/OUT/JSON").c_str(),msg.c_str());
+				char buf[JSON_BUFFER_SIZE];
+				JsonWriter json(buf, sizeof(buf));
+				sta_controller_fill_json(json);
+				if(!json.overflow()) mqttclient.publish((mqtt_topic + "/OUT/JSON").c_str(),json.c_str());
+				if(og.ival(OPTION_MQBN)) {
+					BinaryStatus s;
+					fill_binary_status(s);
+					mqttclient.publish((mqtt_topic + "/OUT/BIN").c_str(), (const uint8_t*)&s, sizeof(s));
+				}
 			}
 			// Send status report every 15 seconds: we don't need to send updates frequently if there is no status change.
 			force_mqtt_update_timeout= curr_utc_time + 15;
@@ -1555,7 +2917,7 @@ void check_status() {
 
 		// Process dynamics: automation and notifications
 		// report status to Blynk
-		if(og.options[OPTION_CLD].ival==CLOUD_BLYNK && Blynk.connected()) {
+		if(og.ival(OPTION_CLD)==CLOUD_BLYNK && Blynk.connected()) {
 			DEBUG_PRINTLN(F(" Update Blynk (State Refresh)"));
 
 			static uint old_distance = 0;
@@ -1606,7 +2968,8 @@ void check_status() {
 		}
 
 		process_dynamics(event);
-		checkstatus_timeout = curr_utc_time + og.options[OPTION_RIV].ival;
+		sse_loop();
+		checkstatus_timeout = curr_utc_time + og.ival(OPTION_RIV);
 	}
 }
 
@@ -1616,13 +2979,12 @@ void time_keeping() {
 	static ulong time_keeping_timeout = 0;
 	static unsigned char failed_ntp_calls = 0;
 	const unsigned char MAX_FAILED_NTP_CALLS = 20;
-	const ulong NTP_VALID_TIME = 1577836800UL;
 
 	if(!configured) {
-		if(valid_url(og.options[OPTION_NTP1].sval)) {
+		if(valid_url(og.sval(OPTION_NTP1))) {
 			DEBUG_PRINT(F("NTP1:"));
-			DEBUG_PRINTLN(og.options[OPTION_NTP1].sval);
-			configTime(0, 0, og.options[OPTION_NTP1].sval.c_str(), DEFAULT_NTP1, DEFAULT_NTP2);
+			DEBUG_PRINTLN(og.sval(OPTION_NTP1));
+			configTime(0, 0, og.sval(OPTION_NTP1).c_str(), DEFAULT_NTP1, DEFAULT_NTP2);
 		} else {
 			DEBUG_PRINT(F("NTP1:"));
 			DEBUG_PRINTLN(DEFAULT_NTP1);
@@ -1683,7 +3045,7 @@ void process_alarm() {
 		og.alarm--;
 		if(og.alarm==0) {
 			og.play_note(0);
-			switch (og.options[OPTION_SECV].ival) {
+			switch (og.ival(OPTION_SECV)) {
 				case 2: // SecPlus 2
 					switch (og.alarm_action) {
 						case 1: // Close
@@ -1708,6 +3070,8 @@ void process_alarm() {
 
 void do_loop() {
 	static ulong connecting_timeout;
+	const uint32_t loop_start = ESP.getCycleCount();
+	uint32_t t = loop_start;
 	switch(og.state) {
 	case OG_STATE_INITIAL:
 		if(curr_mode == OG_MOD_AP) {
@@ -1715,25 +3079,24 @@ void do_loop() {
 			scanned_ssids += F(",\"has_swrx\":");
 			scanned_ssids += og.has_swrx;
 			scanned_ssids += F(",\"secv\":");
-			scanned_ssids += og.options[OPTION_SECV].ival;
+			scanned_ssids += og.ival(OPTION_SECV);
 			scanned_ssids += F("}");
 			String ap_ssid = get_ap_ssid();
 			start_network_ap(ap_ssid.c_str(), NULL);
 			delay(500);
 			dns->setErrorReplyCode(DNSReplyCode::NoError);
 			dns->start(53, "*", WiFi.softAPIP());
-			otf->on("/",   on_home);
+			register_assets();
 			otf->on("/js", on_ap_scan);
 			otf->on("/cc", on_ap_change_config);
 			otf->on("/jt", on_ap_try_connect);
 			otf->on("/db", on_ap_debug);
 			otf->on("/ad", on_auto_detect);
 			// FIXME get update ap updates working.
-			otf->on("/update", on_update, OTF::HTTP_GET);
 			updateServer->on("/update", HTTP_POST, on_firmware_upload_fin, on_firmware_upload);
 			updateServer->on("/update", HTTP_OPTIONS, on_update_options);
 			otf->on("/resetall",on_reset_all);
-			otf->onMissingPage(on_home);
+			otf->onMissingPage(on_asset);
 			updateServer->begin();
 			DEBUG_PRINTLN(F("Web Server endpoints (AP mode) registered"));
 			og.state = OG_STATE_CONNECTED;
@@ -1742,12 +3105,12 @@ void do_loop() {
 		} else {
 			led_blink_ms = LED_SLOW_BLINK;
 			DEBUG_PRINT(F("Attempting to connect to SSID: "));
-			DEBUG_PRINTLN(og.options[OPTION_SSID].sval.c_str());
+			DEBUG_PRINTLN(og.sval(OPTION_SSID).c_str());
 
-			String host = og.options[OPTION_HOST].sval;
+			String host = og.sval(OPTION_HOST);
 			const char* hostname = host.length() == 0 ? NULL : host.c_str(); // use the hostname provided if one is specified
 
-			start_network_sta(og.options[OPTION_SSID].sval.c_str(), og.options[OPTION_PASS].sval.c_str(), hostname);
+			start_network_sta(og.sval(OPTION_SSID).c_str(), og.sval(OPTION_PASS).c_str(), hostname);
 			og.config_ip();
 			og.state = OG_STATE_CONNECTING;
 			connecting_timeout = millis() + 60000;
@@ -1758,12 +3121,12 @@ void do_loop() {
 		{
 			led_blink_ms = LED_SLOW_BLINK;
 			DEBUG_PRINT(F("Attempting to connect to SSID: "));
-			DEBUG_PRINTLN(og.options[OPTION_SSID].sval.c_str());
+			DEBUG_PRINTLN(og.sval(OPTION_SSID).c_str());
 
-			String host = og.options[OPTION_HOST].sval;
+			String host = og.sval(OPTION_HOST);
 			const char* hostname = host.length() == 0 ? NULL : host.c_str(); // use the hostname provided if one is specified
 
-			start_network_sta_with_ap(og.options[OPTION_SSID].sval.c_str(), og.options[OPTION_PASS].sval.c_str(), hostname);
+			start_network_sta_with_ap(og.sval(OPTION_SSID).c_str(), og.sval(OPTION_PASS).c_str(), hostname);
 			og.config_ip();
 			og.state = OG_STATE_CONNECTED;
 			break;
@@ -1775,43 +3138,47 @@ void do_loop() {
 			DEBUG_PRINTLN(WiFi.localIP());
 
 			time_keeping();
-			otf->on("/", on_home);
+			register_assets();
 			otf->on("/jc", on_sta_controller);
+			otf->on("/bc", on_sta_binary_status);
 			otf->on("/jo", on_sta_options);
 			otf->on("/jl", on_sta_logs);
+			otf->on("/js2", on_sta_rollups);
 			otf->on("/ad", on_auto_detect);
-			otf->on("/vo", on_sta_view_options);
-			otf->on("/vl", on_sta_view_logs);
 			otf->on("/cc", on_sta_change_controller);
 			otf->on("/co", on_sta_change_options);
 			otf->on("/db", on_sta_debug);
+			otf->on("/jp", on_sta_perf);
 			// FIXME get sta updates working.
-			otf->on("/update", on_update, OTF::HTTP_GET);
 			updateServer->on("/update", HTTP_POST, on_firmware_upload_fin, on_firmware_upload);
 			updateServer->on("/update", HTTP_OPTIONS, on_update_options);
+			updateServer->on("/events", HTTP_GET, on_sta_events);
+			updateServer->on("/jc", HTTP_GET, on_keepalive_api);
+			updateServer->on("/bc", HTTP_GET, on_keepalive_api);
+			updateServer->collectHeaders(keepalive_headers, 2);
 			otf->on("/clearlog", on_clear_log);
 			otf->on("/resetall",on_reset_all);
 			updateServer->begin();
 			DEBUG_PRINTLN(F("Web Server endpoints (STA mode) registered"));
 
 			// request mDNS host name
-			String host = og.options[OPTION_HOST].sval;
+			String host = og.sval(OPTION_HOST);
 			if(host.length()==0) host=get_ap_ssid(); // if undefined, AP name as host
 			if(MDNS.begin(host.c_str(), WiFi.localIP())) {
 				DEBUG_PRINT(F("MDNS registered: "));
 				DEBUG_PRINT(host);
 				DEBUG_PRINTLN(F(".local"));
 
-				MDNS.addService("http", "tcp", og.options[OPTION_HTP].ival);
-				//DEBUG_PRINTLN(og.options[OPTION_HTP].ival);
+				MDNS.addService("http", "tcp", og.ival(OPTION_HTP));
+				//DEBUG_PRINTLN(og.ival(OPTION_HTP));
 			}
 
-			if(og.options[OPTION_CLD].ival==CLOUD_BLYNK) {
+			if(og.ival(OPTION_CLD)==CLOUD_BLYNK) {
 				DEBUG_PRINTLN(F("Attempt to connect to Blynk:"));
-				DEBUG_PRINT(og.options[OPTION_BDMN].sval);
+				DEBUG_PRINT(og.sval(OPTION_BDMN));
 				DEBUG_PRINT(":");
-				DEBUG_PRINTLN(og.options[OPTION_BPRT].ival);
-				Blynk.config(og.options[OPTION_AUTH].sval.c_str(), og.options[OPTION_BDMN].sval.c_str(), (uint16_t) og.options[OPTION_BPRT].ival); // use the config function
+				DEBUG_PRINTLN(og.ival(OPTION_BPRT));
+				Blynk.config(og.sval(OPTION_AUTH).c_str(), og.sval(OPTION_BDMN).c_str(), (uint16_t) og.ival(OPTION_BPRT)); // use the config function
 				if(Blynk.connect()) {DEBUG_PRINTLN(F("Blynk connected"));}
 				else {DEBUG_PRINTLN(F("Blynk failed!"));}
 			}
@@ -1822,6 +3189,8 @@ void do_loop() {
 		} else {
 			if(connecting_timeout && millis() > connecting_timeout) {
 				DEBUG_PRINTLN(F("Wifi Connecting timeout, restart"));
+				og.log_flush();
+				rollup_save();
 				og.restart();
 			}
 		}
@@ -1831,6 +3200,7 @@ void do_loop() {
 		og.state = OG_STATE_INITIAL;
 		og.options_reset();
 		og.log_reset();
+		rollup_reset();
 		og.restart();
 		break;
 
@@ -1847,13 +3217,13 @@ void do_loop() {
 			updateServer->handleClient();
 			check_status_ap();
 			connecting_timeout = 0;
-			if(og.options[OPTION_MOD].ival == OG_MOD_STA) {
+			if(og.ival(OPTION_MOD) == OG_MOD_STA) {
 				// already in STA mode, waiting to reboot
 				break;
 			}
 			if(WiFi.status() == WL_CONNECTED && WiFi.localIP()) {
 				DEBUG_PRINTLN(F("STA connected, updating option file"));
-				og.options[OPTION_MOD].ival = OG_MOD_STA;
+				og.set_ival(OPTION_MOD, OG_MOD_STA);
 				og.options_save();
 				og.play_startup_tune();
 				//restart_ticker.once_ms(10000, og.restart);
@@ -1863,28 +3233,45 @@ void do_loop() {
 		} else {
 			if(WiFi.status() == WL_CONNECTED) {
 				MDNS.update();
+				t = loop_prof_mark(LOOP_STAGE_MDNS, t);
 				time_keeping();
+				t = loop_prof_mark(LOOP_STAGE_TIME, t);
 				check_status(); //This checks the door, sends info to services and processes the automation rules
+				og.log_loop();
+				t = loop_prof_mark(LOOP_STAGE_STATUS, t);
 				otf->loop();
+				t = loop_prof_mark(LOOP_STAGE_OTF, t);
 				updateServer->handleClient();
+				http_pool_loop();
+				t = loop_prof_mark(LOOP_STAGE_UPDATE, t);
 
-				if(og.options[OPTION_CLD].ival==CLOUD_BLYNK) {
+				if(og.ival(OPTION_CLD)==CLOUD_BLYNK) {
 					Blynk.run();
+					t = loop_prof_mark(LOOP_STAGE_BLYNK, t);
 				}
 
 				//Handle MQTT
-				if(og.options[OPTION_MQEN].ival>0 && valid_url(og.options[OPTION_MQTT].sval)) { // if enabled and mqtt server looks valid
+				if(og.ival(OPTION_MQEN)>0 && valid_url(og.sval(OPTION_MQTT))) { // if enabled and mqtt server looks valid
 					if (!mqttclient.connected()) {
 						mqtt_id = get_ap_ssid();
-						mqtt_topic = og.options[OPTION_MQTP].sval;
-						if(mqtt_topic.length()==0) mqtt_topic = og.options[OPTION_NAME].sval;
+						mqtt_topic = og.sval(OPTION_MQTP);
+						if(mqtt_topic.length()==0) mqtt_topic = og.sval(OPTION_NAME);
 						mqtt_debug_topic = mqtt_topic + "/OUT/DEBUG";
-						mqttclient.setServer(og.options[OPTION_MQTT].sval.c_str(), og.options[OPTION_MQPT].ival);
+						mqttclient.setServer(og.sval(OPTION_MQTT).c_str(), og.ival(OPTION_MQPT));
 						mqttclient.setCallback(mqtt_callback);
 						mqtt_connect_subscribe();
 					}
-					else {mqttclient.loop();} //Processes MQTT Pings/keep alives
+					else {
+						mqttclient.loop(); //Processes MQTT Pings/keep alives
+						mqtt_publish_perf();
+					}
+					t = loop_prof_mark(LOOP_STAGE_MQTT, t);
 				}
+
+				notify_loop();
+				t = loop_prof_mark(LOOP_STAGE_NOTIFY, t);
+				ota_pull_loop();
+				t = loop_prof_mark(LOOP_STAGE_OTA, t);
 				connecting_timeout = 0;
 			} else {
 				//og.state = OG_STATE_INITIAL;
@@ -1895,19 +3282,26 @@ void do_loop() {
 	}
 
 	// secplus process loop
-	switch (og.options[OPTION_SECV].ival) {
+	t = ESP.getCycleCount();
+	switch (og.ival(OPTION_SECV)) {
 		case 2: // SecPlus 2
 			secplus2_garage.loop();
+			t = loop_prof_mark(LOOP_STAGE_SECPLUS, t);
 			break;
 		case 1: // SecPlus 1
 			secplus1_garage.loop();
+			t = loop_prof_mark(LOOP_STAGE_SECPLUS, t);
 			break;
 	}
 
 	process_ui();
+	t = loop_prof_mark(LOOP_STAGE_UI, t);
 
-	if(og.alarm)
+	if(og.alarm) {
 		process_alarm();
+		loop_prof_mark(LOOP_STAGE_ALARM, t);
+	}
+	loop_prof_mark(LOOP_STAGE_LOOP, loop_start);
 }
 
 BLYNK_WRITE(BLYNK_PIN_RELAY) {
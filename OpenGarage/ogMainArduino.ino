@@ -30,7 +30,9 @@ struct tcp_pcb;
 extern struct tcp_pcb* tcp_tw_pcbs;
 extern "C" void tcp_abort (struct tcp_pcb* pcb);
 
-void tcpCleanup()   // losing bytes work around
+// losing bytes work around: frees connections in TIME_WAIT only, so the
+// keep-alive pool and event stream sockets, which are still open, are never touched
+void tcpCleanup()
 {  while(tcp_tw_pcbs)
   {    tcp_abort(tcp_tw_pcbs);  }}
 void do_setup();
@@ -0,0 +1,295 @@
+// ota_delta.mjs
+// Firmware patches for delta OTA updates: the controller rebuilds the new
+// image from the firmware it runs plus a patch, so only the changes have
+// to be uploaded (see Delta.h for the format).
+//
+//   node ota_delta.mjs diff  <old.bin> <new.bin> <patch.ogd>
+//   node ota_delta.mjs apply <old.bin> <patch.ogd> <new.bin>
+//   node ota_delta.mjs report [bins dir]   (default ../docs/docs/assets/bins)
+//
+// The patch is then uploaded like a firmware file:
+//   curl -F file=@patch.ogd "http://<device ip>:8080/update?dkey=<device key>"
+import { promises as fs } from "fs";
+import path from "path";
+import zlib from "zlib";
+import crypto from "crypto";
+
+const MAGIC = Buffer.from("OGD1");
+const HEADER_SIZE = 4 + 4 + 32 + 4 + 32;
+// ops, in the low two bits of the varint that starts each of them
+const OP_COPY = 0;    // n bytes from the old image
+const OP_ADD = 1;     // n bytes, each added to the next old byte
+const OP_INSERT = 2;  // n new bytes
+const OP_SEEK = 3;    // moves in the old image, zigzag coded
+// in an added block, runs of unchanged bytes at least this long become copies
+const MIN_COPY = 4;
+// the flash mode and size bytes of the image header are rewritten by the
+// updater and by flashing tools; they are taken as 0 in the old image
+const MASKED = [2, 3];
+const BINS_DIR = path.resolve("../docs/docs/assets/bins");
+
+function sha256(buf) {
+  return crypto.createHash("sha256").update(buf).digest();
+}
+
+function maskHeader(buf) {
+  const out = Buffer.from(buf);
+  for (const i of MASKED) if (i < out.length) out[i] = 0;
+  return out;
+}
+
+// suffix array by prefix doubling
+function suffixArray(buf) {
+  const n = buf.length;
+  let sa = new Int32Array(n);
+  let rank = new Int32Array(n);
+  let tmp = new Int32Array(n);
+  const cnt = new Int32Array(Math.max(256, n) + 1);
+  for (let i = 0; i < n; i++) cnt[buf[i]]++;
+  for (let i = 1; i < 256; i++) cnt[i] += cnt[i - 1];
+  for (let i = n - 1; i >= 0; i--) sa[--cnt[buf[i]]] = i;
+  let classes = 0;
+  for (let j = 0; j < n; j++) {
+    if (j && buf[sa[j]] !== buf[sa[j - 1]]) classes++;
+    rank[sa[j]] = classes;
+  }
+  classes++;
+  for (let k = 1; classes < n; k <<= 1) {
+    // by the second half first, then stable by the first half
+    let p = 0;
+    for (let i = n - k; i < n; i++) tmp[p++] = i;
+    for (let j = 0; j < n; j++) if (sa[j] >= k) tmp[p++] = sa[j] - k;
+    cnt.fill(0, 0, classes);
+    for (let i = 0; i < n; i++) cnt[rank[i]]++;
+    for (let i = 1; i < classes; i++) cnt[i] += cnt[i - 1];
+    for (let j = n - 1; j >= 0; j--) sa[--cnt[rank[tmp[j]]]] = tmp[j];
+    const second = i => (i + k < n ? rank[i + k] : -1);
+    tmp[sa[0]] = 0;
+    classes = 1;
+    for (let j = 1; j < n; j++) {
+      const a = sa[j - 1], b = sa[j];
+      if (rank[a] !== rank[b] || second(a) !== second(b)) classes++;
+      tmp[b] = classes - 1;
+    }
+    [rank, tmp] = [tmp, rank];
+  }
+  return sa;
+}
+
+function matchLen(a, ai, b, bi) {
+  let i = 0;
+  while (ai + i < a.length && bi + i < b.length && a[ai + i] === b[bi + i]) i++;
+  return i;
+}
+
+// longest match of nw[scan..] in old, as [length, position]
+function search(sa, old, nw, scan) {
+  let st = 0, en = sa.length - 1;
+  const key = nw.subarray(scan);
+  while (en - st >= 2) {
+    const x = st + ((en - st) >> 1);
+    const cmp = Buffer.compare(old.subarray(sa[x], sa[x] + key.length), key);
+    if (cmp < 0) st = x; else en = x;
+  }
+  const a = matchLen(old, sa[st], nw, scan);
+  const b = matchLen(old, sa[en], nw, scan);
+  return a > b ? [a, sa[st]] : [b, sa[en]];
+}
+
+// bsdiff's matching: blocks of the new image that are close to a block of the
+// old one (code that moved, with some addresses changed), and new bytes between
+// them, as [addLen, insertLen, seek] triples
+function* matchBlocks(old, nw) {
+  const sa = suffixArray(old);
+  let scan = 0, len = 0, pos = 0;
+  let lastScan = 0, lastPos = 0, lastOffset = 0;
+  while (scan < nw.length) {
+    let oldScore = 0;
+    let scsc = scan += len;
+    for (; scan < nw.length; scan++) {
+      [len, pos] = search(sa, old, nw, scan);
+      for (; scsc < scan + len; scsc++) {
+        if (scsc + lastOffset < old.length && old[scsc + lastOffset] === nw[scsc]) oldScore++;
+      }
+      if ((len === oldScore && len !== 0) || len > oldScore + 8) break;
+      if (scan + lastOffset < old.length && old[scan + lastOffset] === nw[scan]) oldScore--;
+    }
+    if (len === oldScore && scan !== nw.length) continue;
+    // extend the last match forward and this one backward
+    let s = 0, best = 0, lenF = 0;
+    for (let i = 0; lastScan + i < scan && lastPos + i < old.length;) {
+      if (old[lastPos + i] === nw[lastScan + i]) s++;
+      i++;
+      if (s * 2 - i > best * 2 - lenF) { best = s; lenF = i; }
+    }
+    let lenB = 0;
+    if (scan < nw.length) {
+      s = 0; best = 0;
+      for (let i = 1; scan >= lastScan + i && pos >= i; i++) {
+        if (old[pos - i] === nw[scan - i]) s++;
+        if (s * 2 - i > best * 2 - lenB) { best = s; lenB = i; }
+      }
+    }
+    if (lastScan + lenF > scan - lenB) {
+      const overlap = lastScan + lenF - (scan - lenB);
+      let lens = 0;
+      s = 0; best = 0;
+      for (let i = 0; i < overlap; i++) {
+        if (nw[lastScan + lenF - overlap + i] === old[lastPos + lenF - overlap + i]) s++;
+        if (nw[scan - lenB + i] === old[pos - lenB + i]) s--;
+        if (s > best) { best = s; lens = i + 1; }
+      }
+      lenF += lens - overlap;
+      lenB -= lens;
+    }
+    const seek = scan < nw.length ? pos - lenB - (lastPos + lenF) : 0;
+    yield [lastScan, lastPos, lenF, scan - lenB - (lastScan + lenF), seek];
+    lastScan = scan - lenB;
+    lastPos = pos - lenB;
+    lastOffset = pos - scan;
+  }
+}
+
+class Writer {
+  constructor() { this.parts = []; }
+  varint(v) {
+    const b = [];
+    do {
+      let c = v % 128;
+      v = Math.floor(v / 128);
+      if (v) c |= 0x80;
+      b.push(c);
+    } while (v);
+    this.parts.push(Buffer.from(b));
+  }
+  op(op, n) { this.varint(n * 4 + op); }
+  bytes(buf) { this.parts.push(Buffer.from(buf)); }
+  buffer() { return Buffer.concat(this.parts); }
+}
+
+export function diff(oldImage, newImage) {
+  const old = maskHeader(oldImage);
+  const nw = newImage;
+  const w = new Writer();
+  const head = Buffer.alloc(HEADER_SIZE);
+  MAGIC.copy(head, 0);
+  head.writeUInt32LE(old.length, 4);
+  sha256(old).copy(head, 8);
+  head.writeUInt32LE(nw.length, 40);
+  sha256(nw).copy(head, 44);
+  w.bytes(head);
+  for (const [scan, pos, addLen, insertLen, seek] of matchBlocks(old, nw)) {
+    // the added block, with its longer unchanged runs as copies
+    const d = Buffer.alloc(addLen);
+    for (let i = 0; i < addLen; i++) d[i] = (nw[scan + i] - old[pos + i]) & 0xff;
+    let i = 0;
+    while (i < addLen) {
+      let z = i;
+      while (z < addLen && d[z] === 0) z++;
+      if (z - i >= MIN_COPY || z === addLen) {
+        if (z > i) w.op(OP_COPY, z - i);
+        i = z;
+        continue;
+      }
+      // bytes up to the next long enough unchanged run
+      let e = i;
+      for (let run = 0; e < addLen; e++) {
+        run = d[e] === 0 ? run + 1 : 0;
+        if (run >= MIN_COPY) { e -= run - 1; break; }
+      }
+      w.op(OP_ADD, e - i);
+      w.bytes(d.subarray(i, e));
+      i = e;
+    }
+    if (insertLen) {
+      w.op(OP_INSERT, insertLen);
+      w.bytes(nw.subarray(scan + addLen, scan + addLen + insertLen));
+    }
+    if (seek) w.op(OP_SEEK, seek < 0 ? -seek * 2 - 1 : seek * 2);
+  }
+  return w.buffer();
+}
+
+export function apply(oldImage, patch) {
+  if (patch.length < HEADER_SIZE || !patch.subarray(0, 4).equals(MAGIC)) throw new Error("not a firmware patch");
+  const old = maskHeader(oldImage.subarray(0, patch.readUInt32LE(4)));
+  if (old.length !== patch.readUInt32LE(4) || !sha256(old).equals(patch.subarray(8, 40))) {
+    throw new Error("patch is for a different firmware");
+  }
+  const out = Buffer.alloc(patch.readUInt32LE(40));
+  let p = HEADER_SIZE, o = 0, pos = 0;
+  const varint = () => {
+    let v = 0, mul = 1, c;
+    do {
+      if (p >= patch.length) throw new Error("truncated patch");
+      c = patch[p++];
+      v += (c & 0x7f) * mul;
+      mul *= 128;
+    } while (c & 0x80);
+    return v;
+  };
+  while (o < out.length) {
+    const v = varint();
+    const op = v % 4;
+    const n = Math.floor(v / 4);
+    if (op === OP_SEEK) {
+      pos += n % 2 ? -(n + 1) / 2 : n / 2;
+      continue;
+    }
+    if (o + n > out.length || (op !== OP_INSERT && (pos < 0 || pos + n > old.length)) || (op !== OP_COPY && p + n > patch.length)) {
+      throw new Error("corrupt patch");
+    }
+    for (let i = 0; i < n; i++) {
+      if (op === OP_COPY) out[o++] = old[pos++];
+      else if (op === OP_ADD) out[o++] = (old[pos++] + patch[p++]) & 0xff;
+      else out[o++] = patch[p++];
+    }
+  }
+  if (p !== patch.length || !sha256(out).equals(patch.subarray(44, 76))) throw new Error("patch does not give the expected image");
+  return out;
+}
+
+// bytes uploaded for each release, from the one before it
+async function report(dir) {
+  const version = f => f.match(/^og_(\d+)\.(\d+)\.(\d+)\.bin$/)?.slice(1).map(Number);
+  const bins = (await fs.readdir(dir)).filter(version)
+    .sort((a, b) => version(a).reduce((r, v, i) => r || v - version(b)[i], 0));
+  const col = (v, w = 9) => String(v).padStart(w);
+  console.log(`${"update".padEnd(28)}${col("image")}${col("gzip")}${col("patch")}${col("saves", 8)}`);
+  let sumGz = 0, sumPatch = 0;
+  for (let i = 1; i < bins.length; i++) {
+    const old = await fs.readFile(path.join(dir, bins[i - 1]));
+    const nw = await fs.readFile(path.join(dir, bins[i]));
+    const gz = zlib.gzipSync(nw, { level: 9 }).length;
+    const patch = diff(old, nw);
+    apply(old, patch);  // check it
+    sumGz += gz;
+    sumPatch += patch.length;
+    const saves = `${(100 * (1 - patch.length / gz)).toFixed(0)}%`;
+    console.log(`${`${bins[i - 1]} -> ${bins[i]}`.padEnd(28)}${col(nw.length)}${col(gz)}${col(patch.length)}${col(saves, 8)}`);
+  }
+  console.log(`Patches are ${(100 * (1 - sumPatch / sumGz)).toFixed(0)}% smaller than gzipped images in total`);
+}
+
+async function main() {
+  const [cmd, ...args] = process.argv.slice(2);
+  if (cmd === "diff" && args.length === 3) {
+    const patch = diff(await fs.readFile(args[0]), await fs.readFile(args[1]));
+    await fs.writeFile(args[2], patch);
+    console.log(`${args[2]}: ${patch.length} bytes`);
+  } else if (cmd === "apply" && args.length === 3) {
+    await fs.writeFile(args[2], apply(await fs.readFile(args[0]), await fs.readFile(args[1])));
+  } else if (cmd === "report" && args.length <= 1) {
+    await report(args[0] ?? BINS_DIR);
+  } else {
+    console.error("usage: node ota_delta.mjs diff <old.bin> <new.bin> <patch.ogd>\n" +
+                  "       node ota_delta.mjs apply <old.bin> <patch.ogd> <new.bin>\n" +
+                  "       node ota_delta.mjs report [bins dir]");
+    process.exit(2);
+  }
+}
+
+main().catch(err => {
+  console.error(err.message);
+  process.exit(1);
+});
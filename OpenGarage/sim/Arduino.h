@@ -0,0 +1,202 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: Arduino core subset used by the firmware
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_ARDUINO_H
+#define _SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+#include "binary.h"
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x00
+#define INPUT_PULLUP 0x02
+#define OUTPUT       0x01
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define DEC 10
+#define HEX 16
+
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define ICACHE_FLASH_ATTR
+
+// flash strings are ordinary memory on the host
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strncasecmp_P strncasecmp
+#define strcat_P strcat
+
+#include "WString.h"
+
+class Print;
+
+class Printable {
+public:
+	virtual ~Printable() {}
+	virtual size_t printTo(Print &p) const = 0;
+};
+
+class Print {
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t *buffer, size_t size);
+	size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+	size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+	virtual void flush() {}
+
+	size_t print(const __FlashStringHelper *s) { return write((const char *)s); }
+	size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+	size_t print(const char s[]) { return write(s); }
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(unsigned char n, int base = DEC) { return print(String(n, base)); }
+	size_t print(int n, int base = DEC) { return print(String(n, base)); }
+	size_t print(unsigned int n, int base = DEC) { return print(String(n, base)); }
+	size_t print(long n, int base = DEC) { return print(String(n, base)); }
+	size_t print(unsigned long n, int base = DEC) { return print(String(n, base)); }
+	size_t print(long long n, int base = DEC) { return print(String(n, base)); }
+	size_t print(unsigned long long n, int base = DEC) { return print(String(n, base)); }
+	size_t print(double n, int digits = 2) { return print(String(n, digits)); }
+	size_t print(const Printable &p) { return p.printTo(*this); }
+
+	size_t println() { return write("\r\n"); }
+	template <typename T> size_t println(const T &v) { size_t n = print(v); return n + println(); }
+	template <typename T> size_t println(const T &v, int fmt) { size_t n = print(v, fmt); return n + println(); }
+	size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+	Stream() : _timeout(1000) {}
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+	void setTimeout(unsigned long timeout) { _timeout = timeout; }
+	size_t readBytes(char *buffer, size_t length);
+	size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+	String readString();
+	String readStringUntil(char terminator);
+protected:
+	int timedRead(); // waits on the virtual clock, like the core waits on millis()
+	unsigned long _timeout;
+};
+
+class HardwareSerial : public Stream {
+public:
+	void begin(unsigned long baud) { (void)baud; }
+	int available() override { return 0; }
+	int read() override { return -1; }
+	int peek() override { return -1; }
+	size_t write(uint8_t c) override;
+	size_t write(const uint8_t *buffer, size_t size) override;
+	using Print::write;
+	operator bool() const { return true; }
+};
+extern HardwareSerial Serial;
+
+class IPAddress : public Printable {
+public:
+	IPAddress() { _address.dword = 0; }
+	IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) { _address.bytes[0]=a; _address.bytes[1]=b; _address.bytes[2]=c; _address.bytes[3]=d; }
+	IPAddress(uint32_t address) { _address.dword = address; }
+	bool fromString(const char *address);
+	bool fromString(const String &address) { return fromString(address.c_str()); }
+	operator uint32_t() const { return _address.dword; }
+	uint8_t operator [](int index) const { return _address.bytes[index]; }
+	uint8_t &operator [](int index) { return _address.bytes[index]; }
+	bool operator ==(const IPAddress &addr) const { return _address.dword == addr._address.dword; }
+	bool isSet() const { return _address.dword != 0; }
+	String toString() const;
+	size_t printTo(Print &p) const override;
+private:
+	union {
+		uint8_t bytes[4];
+		uint32_t dword;
+	} _address;
+};
+
+class EspClass {
+public:
+	void restart();
+	void reset() { restart(); }
+	uint32_t getChipId() { return 0x00C0FFEE; }
+	uint32_t getFreeHeap();
+	uint32_t getMaxFreeBlockSize() { return getFreeHeap(); }
+	uint8_t getHeapFragmentation() { return 0; }
+	uint32_t getFlashChipRealSize() { return 4*1024*1024; }
+	uint32_t getFlashChipSize() { return 4*1024*1024; }
+	uint32_t getSketchSize();
+	uint32_t getFreeSketchSpace() { return 0x300000 - ((getSketchSize() + 0xFFF) & ~0xFFFu); } // up to the file system, as on 4m1m
+	bool flashRead(uint32_t address, uint8_t *data, size_t size);
+	uint32_t getCycleCount();
+	uint8_t getCpuFreqMHz() { return 80; }
+};
+extern EspClass ESP;
+
+// timing on the virtual clock
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// GPIO
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+inline void noInterrupts() {}
+inline void interrupts() {}
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+void noTone(uint8_t pin);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+
+void configTime(int timezone, int daylightOffset_sec, const char *server1, const char *server2 = nullptr, const char *server3 = nullptr);
+
+#endif  // _SIM_ARDUINO_H
@@ -0,0 +1,76 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: Blynk client (never reaches a server)
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_BLYNKSIMPLEESP8266_H
+#define _SIM_BLYNKSIMPLEESP8266_H
+
+#include <ESP8266WiFi.h>
+
+#define V0 0
+#define V1 1
+#define V2 2
+#define V3 3
+#define V4 4
+#define V5 5
+#define V6 6
+#define V7 7
+#define V8 8
+#define V9 9
+
+class BlynkParam {
+public:
+	explicit BlynkParam(int v) : _v(v) {}
+	int asInt() const { return _v; }
+private:
+	int _v;
+};
+struct BlynkReq { uint8_t pin; };
+
+#define BLYNK_WRITE_2(pin) void BlynkWidgetWrite ## pin (BlynkReq &request, const BlynkParam &param)
+#define BLYNK_WRITE(pin)   BLYNK_WRITE_2(pin)
+
+class BlynkWifi {
+public:
+	void config(const char *auth, const char *domain, uint16_t port) { (void)auth; (void)domain; (void)port; }
+	bool connect(unsigned long timeout = 3000) { delay(timeout); return false; }
+	void disconnect() {}
+	bool connected() { return false; }
+	void run() {}
+	template <typename... Args> void virtualWrite(int pin, Args... values) { (void)pin; }
+	template <typename T> void notify(const T &msg) { (void)msg; }
+};
+extern BlynkWifi Blynk;
+
+class WidgetLED {
+public:
+	explicit WidgetLED(uint8_t pin) : _pin(pin), _value(0) {}
+	void on() { _value = 255; }
+	void off() { _value = 0; }
+	void setValue(uint8_t value) { _value = value; }
+	void setColor(const char *color) { (void)color; }
+	uint8_t getValue() const { return _value; }
+private:
+	uint8_t _pin;
+	uint8_t _value;
+};
+
+#endif  // _SIM_BLYNKSIMPLEESP8266_H
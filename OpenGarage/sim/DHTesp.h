@@ -0,0 +1,48 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: DHT temperature/humidity sensor
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_DHTESP_H
+#define _SIM_DHTESP_H
+
+#include <Arduino.h>
+#include "sim.h"
+
+struct TempAndHumidity {
+	float temperature;
+	float humidity;
+};
+
+class DHTesp {
+public:
+	typedef enum {
+		AUTO_DETECT,
+		DHT11,
+		DHT22,
+		AM2302,
+		RHT03
+	} DHT_MODEL_t;
+
+	void setup(uint8_t pin, DHT_MODEL_t model = AUTO_DETECT) { (void)pin; (void)model; }
+	TempAndHumidity getTempAndHumidity() { return {Sim::temperature, Sim::humidity}; }
+};
+
+#endif  // _SIM_DHTESP_H
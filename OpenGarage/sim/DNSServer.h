@@ -0,0 +1,45 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: captive portal DNS server
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_DNSSERVER_H
+#define _SIM_DNSSERVER_H
+
+#include <ESP8266WiFi.h>
+
+enum class DNSReplyCode {
+	NoError = 0,
+	FormError = 1,
+	ServerFailure = 2,
+	NonExistentDomain = 3,
+	NotImplemented = 4,
+	Refused = 5
+};
+
+class DNSServer {
+public:
+	void setErrorReplyCode(const DNSReplyCode &code) { (void)code; }
+	bool start(uint16_t port, const String &domainName, const IPAddress &resolvedIP) { (void)port; (void)domainName; (void)resolvedIP; return true; }
+	void processNextRequest() {}
+	void stop() {}
+};
+
+#endif  // _SIM_DNSSERVER_H
@@ -0,0 +1,51 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: HTTP client
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_ESP8266HTTPCLIENT_H
+#define _SIM_ESP8266HTTPCLIENT_H
+
+#include <ESP8266WiFi.h>
+
+#define HTTP_CODE_OK 200
+#define HTTPC_ERROR_CONNECTION_FAILED (-1)
+
+/** Every request blocks for Sim::http_latency_ms of virtual time and
+ *  succeeds, answering the way the IFTTT maker endpoint does. */
+class HTTPClient {
+public:
+	bool begin(WiFiClient &client, const String &url) { (void)client; _url = url; return true; }
+	bool begin(WiFiClient &client, const char *url) { return begin(client, String(url)); }
+	void addHeader(const String &name, const String &value, bool first = false, bool replace = true) { (void)name; (void)value; (void)first; (void)replace; }
+	void setTimeout(uint16_t timeout) { (void)timeout; }
+	int GET() { return request(); }
+	int POST(const String &payload) { (void)payload; return request(); }
+	int POST(const char *payload) { (void)payload; return request(); }
+	String getString() { return _payload; }
+	int getSize() { return _payload.length(); }
+	void end() { _url = ""; }
+private:
+	int request();
+	String _url;
+	String _payload;
+};
+
+#endif  // _SIM_ESP8266HTTPCLIENT_H
@@ -0,0 +1,96 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: synchronous web server (OTA update port)
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_ESP8266WEBSERVER_H
+#define _SIM_ESP8266WEBSERVER_H
+
+#include <ESP8266WiFi.h>
+#include <Updater.h>
+#include <functional>
+#include <vector>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+
+#define HTTP_UPLOAD_BUFLEN 2048
+
+struct HTTPUpload {
+	HTTPUploadStatus status;
+	String filename;
+	String name;
+	String type;
+	size_t totalSize;
+	size_t currentSize;
+	size_t contentLength;
+	uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+/** Serves requests queued with Sim::queue_http_request() and
+ *  Sim::queue_http_upload() whose URL starts with ":<port>". Uploads are
+ *  handed to the upload handler in HTTP_UPLOAD_BUFLEN pieces. */
+class ESP8266WebServer {
+public:
+	typedef std::function<void(void)> THandlerFunction;
+
+	explicit ESP8266WebServer(int port = 80);
+	~ESP8266WebServer();
+	void begin() { _started = true; }
+	void handleClient();
+	void on(const String &uri, HTTPMethod method, THandlerFunction fn) { on(uri, method, fn, nullptr); }
+	void on(const String &uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
+	void onNotFound(THandlerFunction fn) { _notFound = fn; }
+
+	bool hasArg(const String &name) const;
+	String arg(const String &name) const;
+	String uri() const { return _uri; }
+	HTTPMethod method() const { return _method; }
+	HTTPUpload &upload() { return _upload; }
+	WiFiClient &client() { return _client; }
+	void collectHeaders(const char *headerKeys[], const size_t headerKeysCount) { (void)headerKeys; (void)headerKeysCount; } // all are kept
+	String header(const String &name) const;
+	bool hasHeader(const String &name) const;
+
+	void sendHeader(const String &name, const String &value, bool first = false);
+	void send(int code, const char *content_type = nullptr, const String &content = String(""));
+	void send(int code, const String &content_type, const String &content) { send(code, content_type.c_str(), content); }
+	void send(int code, const char *content_type, const char *content, size_t contentLength);
+
+private:
+	struct Route { String uri; HTTPMethod method; THandlerFunction fn; THandlerFunction ufn; };
+	struct Arg { String key; String value; };
+	const Route *find(const String &uri, HTTPMethod method) const;
+	void dispatch(const Sim::HttpRequest &hr);
+
+	int _port;
+	bool _started;
+	std::vector<Route> _routes;
+	THandlerFunction _notFound;
+	std::vector<Arg> _args;
+	std::vector<Arg> _requestHeaders;
+	String _uri;
+	HTTPMethod _method;
+	HTTPUpload _upload;
+	String _headers;
+	WiFiClient _client;
+};
+
+#endif  // _SIM_ESP8266WEBSERVER_H
@@ -0,0 +1,137 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: ESP8266 WiFi station/AP and TCP client
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_ESP8266WIFI_H
+#define _SIM_ESP8266WIFI_H
+
+#include <Arduino.h>
+#include "sim.h"
+
+typedef enum {
+	WIFI_OFF = 0,
+	WIFI_STA = 1,
+	WIFI_AP = 2,
+	WIFI_AP_STA = 3
+} WiFiMode_t;
+
+typedef enum {
+	WL_NO_SHIELD = 255,
+	WL_IDLE_STATUS = 0,
+	WL_NO_SSID_AVAIL = 1,
+	WL_SCAN_COMPLETED = 2,
+	WL_CONNECTED = 3,
+	WL_CONNECT_FAILED = 4,
+	WL_CONNECTION_LOST = 5,
+	WL_WRONG_PASSWORD = 6,
+	WL_DISCONNECTED = 7
+} wl_status_t;
+
+class ESP8266WiFiClass {
+public:
+	bool mode(WiFiMode_t m) { _mode = m; return true; }
+	WiFiMode_t getMode() { return _mode; }
+	void persistent(bool persistent) { (void)persistent; }
+	bool disconnect(bool wifioff = false) { (void)wifioff; _begun = false; return true; }
+	int8_t scanNetworks() { return 2; }
+	String SSID(uint8_t i) { return i==0 ? String("HomeNet") : String("Neighbor"); }
+	String SSID() { return _ssid; }
+	int32_t RSSI(uint8_t i) { return i==0 ? -52 : -80; }
+	int32_t RSSI() { return Sim::rssi; }
+	bool softAP(const char *ssid, const char *pass = nullptr) { (void)ssid; (void)pass; return true; }
+	IPAddress softAPIP() { return IPAddress(192,168,4,1); }
+	bool hostname(const char *name) { (void)name; return true; }
+	wl_status_t begin(const char *ssid, const char *pass = nullptr) { (void)pass; _ssid = ssid; _begun = true; return status(); }
+	bool setSleep(bool enable) { (void)enable; return true; }
+	void setOutputPower(float dBm) { (void)dBm; }
+	bool setAutoReconnect(bool autoReconnect) { (void)autoReconnect; return true; }
+	bool config(IPAddress local_ip, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress()) {
+		(void)gateway; (void)subnet; (void)dns1; (void)dns2; _static_ip = local_ip; return true;
+	}
+	wl_status_t status() { return (_begun && Sim::wifi_connected) ? WL_CONNECTED : WL_DISCONNECTED; }
+	IPAddress localIP() { return status()==WL_CONNECTED ? (_static_ip ? _static_ip : IPAddress(192,168,1,42)) : IPAddress(); }
+	uint8_t *macAddress(uint8_t *mac) { static const uint8_t m[6] = {0x5C,0xCF,0x7F,0x12,0x34,0x56}; memcpy(mac, m, 6); return mac; }
+	String macAddress() { return String("5C:CF:7F:12:34:56"); }
+	String BSSIDstr() { return String("AA:BB:CC:DD:EE:FF"); }
+	uint8_t *BSSID() { static uint8_t b[6] = {0xAA,0xBB,0xCC,0xDD,0xEE,0xFF}; return b; }
+private:
+	WiFiMode_t _mode = WIFI_OFF;
+	bool _begun = false;
+	String _ssid;
+	IPAddress _static_ip;
+};
+extern ESP8266WiFiClass WiFi;
+
+class Client : public Stream {
+public:
+	virtual int connect(IPAddress ip, uint16_t port) = 0;
+	virtual int connect(const char *host, uint16_t port) = 0;
+	virtual uint8_t connected() = 0;
+	virtual void stop() = 0;
+	virtual int read(uint8_t *buf, size_t size) = 0;
+	using Stream::read;
+	operator bool() { return connected(); }
+};
+
+/** Connections go to whatever Sim::Peer is registered for host:port.
+ *  Connecting to anything else fails after Sim::http_latency_ms, which
+ *  is roughly what an unreachable server costs on the device. */
+/** Copies share the connection, like the reference-counted one of the
+ *  core; it goes away with the last copy. */
+class WiFiClient : public Client {
+	friend class ESP8266WebServer;
+public:
+	WiFiClient() : _peer(nullptr) {}
+	WiFiClient(const WiFiClient &other) : _peer(other._peer) { if(_peer) _peer->refs++; }
+	WiFiClient &operator =(const WiFiClient &other);
+	bool operator ==(const WiFiClient &other) const { return _peer == other._peer; }
+	bool operator !=(const WiFiClient &other) const { return _peer != other._peer; }
+	virtual ~WiFiClient() { stop(); }
+
+	int connect(IPAddress ip, uint16_t port) override { return connect(ip.toString().c_str(), port); }
+	int connect(const char *host, uint16_t port) override;
+	int connect(const String &host, uint16_t port) { return connect(host.c_str(), port); }
+	uint8_t connected() override;
+	void stop() override;
+	size_t write(uint8_t c) override { return write(&c, 1); }
+	size_t write(const uint8_t *buf, size_t size) override;
+	using Print::write;
+	int available() override;
+	int read() override;
+	int read(uint8_t *buf, size_t size) override;
+	int peek() override;
+	void flush() override {}
+	void setNoDelay(bool nodelay) { (void)nodelay; }
+	static void stopAll() {}
+
+protected:
+	Sim::Peer *_peer;
+};
+
+/** TLS is not simulated; the secure client talks plain text to the peer. */
+class WiFiClientSecure : public WiFiClient {
+public:
+	void setInsecure() {}
+	bool probeMaxFragmentLength(const char *host, uint16_t port, uint16_t len) { (void)host; (void)port; (void)len; return true; }
+	void setBufferSizes(int recv, int xmit) { (void)recv; (void)xmit; }
+};
+
+#endif  // _SIM_ESP8266WIFI_H
@@ -0,0 +1,36 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: mDNS responder
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_ESP8266MDNS_H
+#define _SIM_ESP8266MDNS_H
+
+#include <ESP8266WiFi.h>
+
+class MDNSResponder {
+public:
+	bool begin(const char *hostname, IPAddress ip = IPAddress()) { (void)hostname; (void)ip; return true; }
+	bool update() { return true; }
+	void addService(const char *service, const char *proto, uint16_t port) { (void)service; (void)proto; (void)port; }
+};
+extern MDNSResponder MDNS;
+
+#endif  // _SIM_ESP8266MDNS_H
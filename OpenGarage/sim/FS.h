@@ -0,0 +1,128 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: in-memory flash file system
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_FS_H
+#define _SIM_FS_H
+
+#include <Arduino.h>
+#include <memory>
+#include <vector>
+
+namespace fs {
+
+enum SeekMode {
+	SeekSet = 0,
+	SeekCur = 1,
+	SeekEnd = 2
+};
+
+struct FSInfo {
+	size_t totalBytes;
+	size_t usedBytes;
+	size_t blockSize;
+	size_t pageSize;
+	size_t maxOpenFiles;
+	size_t maxPathLength;
+};
+
+struct FileData; // contents of one file, shared between open handles
+
+class File : public Stream {
+public:
+	File() : _pos(0), _read(false), _write(false), _append(false) {}
+	File(std::shared_ptr<FileData> data, const char *name, bool rd, bool wr, bool app);
+
+	size_t write(uint8_t c) override;
+	size_t write(const uint8_t *buf, size_t size) override;
+	using Print::write;
+	int available() override;
+	int read() override;
+	int peek() override;
+	void flush() override {}
+	size_t read(uint8_t *buf, size_t size);
+	bool seek(uint32_t pos, SeekMode mode);
+	bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+	size_t position() const { return _pos; }
+	size_t size() const;
+	bool truncate(uint32_t size);
+	void close();
+	operator bool() const { return (bool)_data; }
+	const char *name() const { return _name.c_str(); }
+	const char *fullName() const { return _name.c_str(); }
+	bool isFile() const { return (bool)_data; }
+	bool isDirectory() const { return false; }
+
+private:
+	std::shared_ptr<FileData> _data;
+	String _name;
+	size_t _pos;
+	bool _read, _write, _append;
+};
+
+class Dir {
+public:
+	Dir() : _index(-1) {}
+	explicit Dir(const String &path) : _path(path), _index(-1) {}
+	bool next();
+	String fileName() const { return _current; }
+	size_t fileSize() const;
+	File openFile(const char *mode);
+	bool rewind() { _index = -1; return true; }
+private:
+	String _path;
+	String _current;
+	int _index;
+};
+
+class FS {
+public:
+	bool begin();
+	void end() {}
+	bool format();
+	bool info(FSInfo &info);
+	File open(const char *path, const char *mode);
+	File open(const String &path, const char *mode) { return open(path.c_str(), mode); }
+	bool exists(const char *path);
+	bool exists(const String &path) { return exists(path.c_str()); }
+	bool remove(const char *path);
+	bool remove(const String &path) { return remove(path.c_str()); }
+	bool rename(const char *pathFrom, const char *pathTo);
+	bool rename(const String &pathFrom, const String &pathTo) { return rename(pathFrom.c_str(), pathTo.c_str()); }
+	Dir openDir(const char *path) { return Dir(path); }
+	Dir openDir(const String &path) { return Dir(path); }
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::Dir;
+using fs::FSInfo;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+extern fs::FS SPIFFS;
+extern fs::FS LittleFS;
+
+#endif  // _SIM_FS_H
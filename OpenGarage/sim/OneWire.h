@@ -0,0 +1,33 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: 1-Wire bus
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_ONEWIRE_H
+#define _SIM_ONEWIRE_H
+
+#include <Arduino.h>
+
+class OneWire {
+public:
+	OneWire(uint8_t pin) { (void)pin; }
+};
+
+#endif  // _SIM_ONEWIRE_H
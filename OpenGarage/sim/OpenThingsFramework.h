@@ -0,0 +1,63 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: OpenThingsFramework server
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_OPENTHINGSFRAMEWORK_H
+#define _SIM_OPENTHINGSFRAMEWORK_H
+
+#include <Arduino.h>
+#include "Request.h"
+#include "Response.h"
+#include <vector>
+
+namespace OTF {
+	typedef void (*callback_t)(const Request &request, Response &response);
+
+	enum CLOUD_STATUS {
+		NOT_ENABLED,
+		UNABLE_TO_CONNECT,
+		DISCONNECTED,
+		CONNECTED
+	};
+
+	/** Requests queued with Sim::queue_http_request() are parsed and
+	 *  dispatched from loop(), one per call. */
+	class OpenThingsFramework {
+	public:
+		explicit OpenThingsFramework(uint16_t webServerPort, Print *hwSerial = nullptr);
+		OpenThingsFramework(uint16_t webServerPort, const String &webSocketHost, uint16_t webSocketPort,
+		                    const String &deviceKey, bool useSsl, Print *hwSerial = nullptr);
+		void on(const char *path, callback_t callback, HTTPMethod method = HTTP_ANY);
+		void on(const __FlashStringHelper *path, callback_t callback, HTTPMethod method = HTTP_ANY) { on((const char *)path, callback, method); }
+		void onMissingPage(callback_t callback) { _missing = callback; }
+		void loop();
+		CLOUD_STATUS getCloudStatus() { return _cloud ? DISCONNECTED : NOT_ENABLED; }
+
+	private:
+		struct Route { String path; callback_t cb; HTTPMethod method; };
+		std::vector<Route> _routes;
+		callback_t _missing;
+		uint16_t _port;
+		bool _cloud;
+	};
+}
+
+#endif  // _SIM_OPENTHINGSFRAMEWORK_H
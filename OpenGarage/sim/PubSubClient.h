@@ -0,0 +1,67 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: MQTT client against a scripted broker
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_PUBSUBCLIENT_H
+#define _SIM_PUBSUBCLIENT_H
+
+#include <ESP8266WiFi.h>
+#include <functional>
+
+#define MQTT_MAX_PACKET_SIZE 256
+#define MQTT_MAX_HEADER_SIZE 5
+
+/** Mirrors the PubSubClient 2.8 limits that matter to the firmware:
+ *  publishes that do not fit the 256 byte packet buffer fail (and are
+ *  counted in Sim::stats.mqtt_dropped), and inbound messages are handed
+ *  to the callback in that same buffer. */
+class PubSubClient {
+public:
+	typedef std::function<void(char *, uint8_t *, unsigned int)> callback_t;
+
+	explicit PubSubClient(Client &client) { (void)client; }
+	PubSubClient &setServer(const char *domain, uint16_t port);
+	PubSubClient &setCallback(callback_t callback) { _callback = callback; return *this; }
+	bool setBufferSize(uint16_t size) { _bufsize = size; return true; }
+	uint16_t getBufferSize() { return _bufsize; }
+
+	bool connect(const char *id);
+	bool connect(const char *id, const char *willTopic, uint8_t willQos, bool willRetain, const char *willMessage);
+	bool connect(const char *id, const char *user, const char *pass, const char *willTopic, uint8_t willQos, bool willRetain, const char *willMessage);
+	void disconnect() { _connected = false; }
+	bool connected();
+	bool loop();
+	bool publish(const char *topic, const char *payload, bool retained = false);
+	bool publish(const char *topic, const uint8_t *payload, unsigned int plength, bool retained = false);
+	bool subscribe(const char *topic, uint8_t qos = 0);
+	int state() { return _connected ? 0 : -1; }
+
+private:
+	bool matches(const char *topic) const;
+	callback_t _callback;
+	bool _connected = false;
+	uint16_t _bufsize = MQTT_MAX_PACKET_SIZE;
+	uint8_t _buffer[MQTT_MAX_PACKET_SIZE];
+	String _subs[4];
+	uint8_t _nsubs = 0;
+};
+
+#endif  // _SIM_PUBSUBCLIENT_H
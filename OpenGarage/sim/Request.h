@@ -0,0 +1,57 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: OpenThingsFramework request
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_OTF_REQUEST_H
+#define _SIM_OTF_REQUEST_H
+
+#include <Arduino.h>
+
+namespace OTF {
+	enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_POST, HTTP_PUT, HTTP_DELETE, HTTP_OPTIONS };
+
+	class Request {
+		friend class OpenThingsFramework;
+	public:
+		char *getPath() const { return _path; }
+		HTTPMethod getMethod() const { return _method; }
+		char *getQueryParameter(const char *key) const;
+		char *getQueryParameter(const __FlashStringHelper *key) const { return getQueryParameter((const char *)key); }
+		char *getHeader(const char *key) const;
+		char *getHeader(const __FlashStringHelper *key) const { return getHeader((const char *)key); }
+		bool isCloudRequest() const { return _cloud; }
+
+	private:
+		Request() : _path(nullptr), _method(HTTP_GET), _nquery(0), _nheaders(0), _cloud(false) {}
+		enum { MAX_PAIRS = 48 };
+		struct Pair { char *key; char *value; };
+		char _buf[2048];       // url-decoded path, query and headers, split in place
+		char *_path;
+		HTTPMethod _method;
+		Pair _query[MAX_PAIRS];
+		Pair _headers[MAX_PAIRS];
+		uint8_t _nquery;
+		uint8_t _nheaders;
+		bool _cloud;
+	};
+}
+
+#endif  // _SIM_OTF_REQUEST_H
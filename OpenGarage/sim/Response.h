@@ -0,0 +1,75 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: OpenThingsFramework response
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_OTF_RESPONSE_H
+#define _SIM_OTF_RESPONSE_H
+
+#include <Arduino.h>
+
+namespace OTF {
+	/** Like the library, the whole response is assembled in one buffer and
+	 *  sent after the handler returns; a response that overflows it is
+	 *  marked invalid and dropped. The driver also notes how long the
+	 *  handler took to produce the first segment's worth of data, which is
+	 *  when a streaming transport could start sending. */
+	class Response : public Print {
+		friend class OpenThingsFramework;
+	public:
+		static const size_t MAX_RESPONSE_LENGTH = 16384;
+		static const size_t SEGMENT_LENGTH = 1460; // one TCP segment
+
+		void writeStatus(uint16_t statusCode, const String &statusMessage);
+		void writeStatus(uint16_t statusCode, const __FlashStringHelper *statusMessage);
+		void writeHeader(const __FlashStringHelper *name, const __FlashStringHelper *value);
+		void writeHeader(const __FlashStringHelper *name, const String &value);
+		void writeHeader(const __FlashStringHelper *name, const char *value);
+		void writeHeader(const __FlashStringHelper *name, int value);
+		void writeHeader(const __FlashStringHelper *name, unsigned int value);
+		void writeHeader(const __FlashStringHelper *name, long value);
+		void writeHeader(const __FlashStringHelper *name, unsigned long value);
+		void writeBodyData(const char *data, size_t length);
+		void writeBodyData(const __FlashStringHelper *data, size_t length) { writeBodyData((const char *)data, length); }
+		size_t bprintf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+		size_t bprintf(const __FlashStringHelper *format, ...);
+
+		size_t write(uint8_t c) override { return write(&c, 1); }
+		size_t write(const uint8_t *buffer, size_t size) override;
+		using Print::write;
+
+		bool isValid() const { return _valid; }
+		size_t getLength() const { return _len; }
+		const char *getBody() const { return _buf; }
+
+	private:
+		Response() : _len(0), _valid(true), _status(0), _bodyStarted(false), _firstSegmentNs(0) {}
+		void append(const char *data, size_t length);
+		void beginBody();
+		char _buf[MAX_RESPONSE_LENGTH];
+		size_t _len;
+		bool _valid;
+		uint16_t _status;
+		bool _bodyStarted;
+		uint64_t _firstSegmentNs; // host time, 0 until SEGMENT_LENGTH bytes are in
+	};
+}
+
+#endif  // _SIM_OTF_RESPONSE_H
@@ -0,0 +1,62 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: Ticker on the virtual clock
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_TICKER_H
+#define _SIM_TICKER_H
+
+#include <Arduino.h>
+#include "sim.h"
+
+class Ticker {
+public:
+	typedef std::function<void()> callback_function_t;
+
+	Ticker() : _id(0) {}
+	~Ticker() { detach(); }
+
+	void attach(float seconds, callback_function_t cb) { attach_ms((uint32_t)(seconds*1000), cb); }
+	void attach_ms(uint32_t ms, callback_function_t cb) { arm(ms, true, cb); }
+	void once(float seconds, callback_function_t cb) { once_ms((uint32_t)(seconds*1000), cb); }
+	void once_ms(uint32_t ms, callback_function_t cb) { arm(ms, false, cb); }
+
+	template <typename TArg>
+	void attach_ms(uint32_t ms, void (*cb)(TArg), TArg arg) { arm(ms, true, [cb, arg]() { cb(arg); }); }
+	template <typename TArg>
+	void once_ms(uint32_t ms, void (*cb)(TArg), TArg arg) { arm(ms, false, [cb, arg]() { cb(arg); }); }
+
+	void detach() { if(_id) Sim::cancel(_id); _id = 0; }
+	bool active() const { return _id != 0; }
+
+private:
+	void arm(uint32_t ms, bool repeat, callback_function_t cb) {
+		detach();
+		uint64_t period = (uint64_t)ms*1000;
+		if(repeat) {
+			_id = Sim::schedule(Sim::now_us()+period, period, cb);
+		} else {
+			_id = Sim::schedule(Sim::now_us()+period, 0, [this, cb]() { _id = 0; cb(); });
+		}
+	}
+	uint32_t _id;
+};
+
+#endif  // _SIM_TICKER_H
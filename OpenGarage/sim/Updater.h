@@ -0,0 +1,62 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: OTA flash updater
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_UPDATER_H
+#define _SIM_UPDATER_H
+
+#include <Arduino.h>
+#include <bearssl/bearssl_hash.h>
+
+#define UPDATE_ERROR_OK     (0)
+#define UPDATE_ERROR_WRITE  (1)
+#define UPDATE_ERROR_SIZE   (4)
+#define UPDATE_ERROR_SPACE  (5)
+#define UPDATE_ERROR_MD5    (8)
+#define UPDATE_ERROR_MAGIC_BYTE (10)
+
+/** Hashes the image; nothing is flashed. The hash of a completed image
+ *  ends up in Sim::ota_image. */
+class UpdaterClass {
+public:
+	bool begin(size_t size, int command = 0, int ledPin = -1, uint8_t ledOn = LOW);
+	size_t write(uint8_t *data, size_t len);
+	bool end(bool evenIfRemaining = false);
+	bool hasError() { return _error != UPDATE_ERROR_OK; }
+	uint8_t getError() { return _error; }
+	void clearError() { _error = UPDATE_ERROR_OK; }
+	bool isRunning() { return _running; }
+	bool isFinished() { return _finished; }
+	size_t size() { return _size; }
+	size_t progress() { return _progress; }
+	size_t remaining() { return _size - _progress; }
+	void printError(Print &out) { out.print(F("update error ")); out.println(_error); }
+private:
+	bool _running = false;
+	bool _finished = false;
+	uint8_t _error = UPDATE_ERROR_OK;
+	size_t _size = 0;
+	size_t _progress = 0;
+	br_sha256_context _sha;
+};
+extern UpdaterClass Update;
+
+#endif  // _SIM_UPDATER_H
@@ -0,0 +1,157 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: Arduino String
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_WSTRING_H
+#define _SIM_WSTRING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+class __FlashStringHelper;
+#define FPSTR(pstr_pointer) (reinterpret_cast<const __FlashStringHelper *>(pstr_pointer))
+#define F(string_literal) (FPSTR(PSTR(string_literal)))
+
+/** Behaves like the ESP8266 core String: short strings (up to 11
+ *  characters) live inside the object, longer ones are reallocated in
+ *  16-byte steps as they grow. Buffer (re)allocations are reported to
+ *  the simulator heap counters, so String churn shows up in them. */
+class String {
+public:
+	String(const char *cstr = nullptr);
+	String(const String &str);
+	String(String &&rval) noexcept;
+	String(const __FlashStringHelper *str);
+	explicit String(char c);
+	explicit String(unsigned char value, unsigned char base = 10);
+	explicit String(int value, unsigned char base = 10);
+	explicit String(unsigned int value, unsigned char base = 10);
+	explicit String(long value, unsigned char base = 10);
+	explicit String(unsigned long value, unsigned char base = 10);
+	explicit String(long long value, unsigned char base = 10);
+	explicit String(unsigned long long value, unsigned char base = 10);
+	explicit String(float value, unsigned char decimalPlaces = 2);
+	explicit String(double value, unsigned char decimalPlaces = 2);
+	~String();
+
+	bool reserve(unsigned int size);
+	unsigned int length() const { return len; }
+	const char *c_str() const { return buf(); }
+	char *begin() { return wbuf(); }
+	char *end() { return wbuf() + len; }
+
+	String &operator =(const String &rhs);
+	String &operator =(String &&rval) noexcept;
+	String &operator =(const char *cstr);
+	String &operator =(const __FlashStringHelper *str);
+	String &operator =(char c);
+
+	bool concat(const String &str) { return concat(str.c_str(), str.length()); }
+	bool concat(const char *cstr);
+	bool concat(const char *cstr, unsigned int length);
+	bool concat(const __FlashStringHelper *str);
+	bool concat(char c);
+	bool concat(unsigned char num);
+	bool concat(int num);
+	bool concat(unsigned int num);
+	bool concat(long num);
+	bool concat(unsigned long num);
+	bool concat(long long num);
+	bool concat(unsigned long long num);
+	bool concat(float num);
+	bool concat(double num);
+
+	template <typename T>
+	String &operator +=(const T &rhs) { concat(rhs); return *this; }
+	String &operator +=(const char *cstr) { concat(cstr); return *this; }
+
+	int compareTo(const String &s) const;
+	bool equals(const String &s) const;
+	bool equals(const char *cstr) const;
+	bool equals(const __FlashStringHelper *s) const { return equals(reinterpret_cast<const char *>(s)); }
+	bool operator ==(const String &rhs) const { return equals(rhs); }
+	bool operator ==(const char *cstr) const { return equals(cstr); }
+	bool operator !=(const String &rhs) const { return !equals(rhs); }
+	bool operator !=(const char *cstr) const { return !equals(cstr); }
+	bool operator <(const String &rhs) const { return compareTo(rhs) < 0; }
+	bool equalsIgnoreCase(const String &s) const;
+	bool startsWith(const String &prefix) const;
+	bool endsWith(const String &suffix) const;
+
+	char charAt(unsigned int index) const;
+	void setCharAt(unsigned int index, char c);
+	char operator [](unsigned int index) const { return charAt(index); }
+	char &operator [](unsigned int index);
+	void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const;
+
+	int indexOf(char ch, unsigned int fromIndex = 0) const;
+	int indexOf(const char *str, unsigned int fromIndex = 0) const;
+	int indexOf(const String &str, unsigned int fromIndex = 0) const { return indexOf(str.c_str(), fromIndex); }
+	int lastIndexOf(char ch) const;
+	String substring(unsigned int beginIndex) const { return substring(beginIndex, len); }
+	String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+	void replace(char find, char replace);
+	void replace(const String &find, const String &replace);
+	void remove(unsigned int index);
+	void remove(unsigned int index, unsigned int count);
+	void toLowerCase();
+	void toUpperCase();
+	void trim();
+
+	long toInt() const;
+	float toFloat() const;
+	double toDouble() const;
+
+private:
+	enum { SSOSIZE = 12 }; // 11 characters plus terminator, as on the ESP8266
+	char sso[SSOSIZE];
+	char *heap;
+	unsigned int cap;  // usable characters, excluding terminator
+	unsigned int len;
+
+	const char *buf() const { return heap ? heap : sso; }
+	char *wbuf() { return heap ? heap : sso; }
+	void init();
+	void invalidate();
+	bool changeBuffer(unsigned int maxStrLen);
+	String &copy(const char *cstr, unsigned int length);
+	void move(String &rhs);
+	bool concatNumber(const char *digits);
+};
+
+String operator +(const String &lhs, const String &rhs);
+String operator +(const String &lhs, const char *rhs);
+String operator +(const char *lhs, const String &rhs);
+String operator +(const String &lhs, const __FlashStringHelper *rhs);
+String operator +(const String &lhs, char rhs);
+String operator +(const String &lhs, int rhs);
+String operator +(const String &lhs, unsigned int rhs);
+String operator +(const String &lhs, long rhs);
+String operator +(const String &lhs, unsigned long rhs);
+String operator +(const String &lhs, float rhs);
+String operator +(const String &lhs, double rhs);
+inline String operator +(String &&lhs, const String &rhs) { lhs.concat(rhs); return static_cast<String &&>(lhs); }
+inline String operator +(String &&lhs, const char *rhs) { lhs.concat(rhs); return static_cast<String &&>(lhs); }
+inline String operator +(String &&lhs, const __FlashStringHelper *rhs) { lhs.concat(rhs); return static_cast<String &&>(lhs); }
+
+#endif  // _SIM_WSTRING_H
@@ -0,0 +1,41 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: BearSSL SHA-256, as bundled with the ESP8266 core
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_BEARSSL_HASH_H
+#define _SIM_BEARSSL_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define br_sha256_SIZE 32
+
+typedef struct {
+	uint8_t buf[64];
+	uint64_t count;
+	uint32_t val[8];
+} br_sha256_context;
+
+void br_sha256_init(br_sha256_context *ctx);
+void br_sha256_update(br_sha256_context *ctx, const void *data, size_t len);
+void br_sha256_out(const br_sha256_context *ctx, void *out);
+
+#endif  // _SIM_BEARSSL_HASH_H
@@ -0,0 +1,99 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: config file load/save benchmark
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/* Times options_setup() (the boot-time load) and options_save() with a
+ * typical configuration and counts heap allocations and flash writes (one
+ * save op = two saves, each changing one integer option), then looks up every
+ * option name with find_option() (one op = all names). Built and run by
+ * sim/bench_config.sh; only uses the OpenGarage class, so it builds
+ * against older firmware sources too. */
+
+#include <chrono>
+#include <stdio.h>
+#include "OpenGarage.h"
+#include "sim.h"
+
+OpenGarage og;
+
+#if defined(CONFIG_JNL_FNAME)  // option setters
+#define SET_IVAL(i, v) og.set_ival(i, v)
+#define SET_SVAL(i, v) og.set_sval(i, v)
+#elif defined(OG_OPTIONS)      // option registry
+#define SET_IVAL(i, v) (og.ival(i) = v)
+#define SET_SVAL(i, v) (og.sval(i) = v)
+#else
+#define SET_IVAL(i, v) (og.options[i].ival = v)
+#define SET_SVAL(i, v) (og.options[i].sval = v)
+#endif
+#ifdef OG_OPTIONS
+static String option_name(byte i) { OptionStruct o; og.get_option(i, o); return o.name; }
+#else
+static String option_name(byte i) { return og.options[i].name; }
+#endif
+
+static void set(int idx, const char *v) { SET_SVAL(idx, v); }
+
+template <typename F>
+static void run(const char *what, int n, F fn) {
+	uint64_t allocs = Sim::heap.allocs;
+	auto start = std::chrono::steady_clock::now();
+	for(int i=0;i<n;i++) fn();
+	double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	printf("%-6s %8.0f ns/op %6.1f allocs/op\n", what, ns/n, (double)(Sim::heap.allocs-allocs)/n);
+}
+
+int main() {
+	const int N = 2000;
+	FILESYS.begin();
+	SET_IVAL(OPTION_MOD, OG_MOD_STA);
+	SET_IVAL(OPTION_MQEN, 1);
+	SET_IVAL(OPTION_EMEN, 1);
+	SET_IVAL(OPTION_LSZ, 400);
+	set(OPTION_SSID, "HomeNetwork-5G");
+	set(OPTION_PASS, "correct horse battery staple");
+	set(OPTION_NAME, "Garage Left");
+	set(OPTION_DKEY, "0pen$esame");
+	set(OPTION_MQTT, "192.168.1.10");
+	set(OPTION_MQUR, "opengarage");
+	set(OPTION_MQPW, "mqtt-password");
+	set(OPTION_MQTP, "garage/left");
+	set(OPTION_SEND, "garage@example.com");
+	set(OPTION_APWD, "abcd efgh ijkl mnop");
+	set(OPTION_RECP, "owner@example.com");
+	og.options_save();
+	og.options_setup();  // the first load may import an older format
+
+	uint64_t writes = Sim::stats.fs_writes, bytes = Sim::stats.fs_bytes_written;
+	run("save", N, [] { SET_IVAL(OPTION_DTH, 50); og.options_save(); SET_IVAL(OPTION_DTH, 60); og.options_save(); });
+	printf("       %8.1f fs writes/op %6.1f bytes written/op\n", (double)(Sim::stats.fs_writes-writes)/N, (double)(Sim::stats.fs_bytes_written-bytes)/N);
+	run("load", N, [] { og.options_setup(); });
+
+	static String names[NUM_OPTIONS];
+	for(byte i=0;i<NUM_OPTIONS;i++) names[i] = option_name(i);
+	int found = 0;
+	run("find", N, [&] { for(byte i=0;i<NUM_OPTIONS;i++) found += og.find_option(names[i].c_str()) == i; });
+	if(found != N*NUM_OPTIONS) printf("find_option mismatch\n");
+
+	Dir dir = FILESYS.openDir("/");
+	while(dir.next()) printf("file   %s %u bytes\n", dir.fileName().c_str(), (unsigned)dir.fileSize());
+	return 0;
+}
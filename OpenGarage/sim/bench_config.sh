@@ -0,0 +1,9 @@
+#!/bin/sh
+# Config file load (boot) and save time, heap allocations and file size.
+#   sh sim/bench_config.sh [firmware folder]   (run from the OpenGarage folder)
+# The firmware folder defaults to this one; pass an older checkout to compare.
+SRC=${1:-.}
+BIN=$(mktemp)
+trap 'rm -f "$BIN"' EXIT
+g++ -std=gnu++17 -O2 -DESP8266 -DARDUINO=10819 -Isim -I"$SRC" sim/bench_config.cpp "$SRC/OpenGarage.cpp" \
+	$(ls sim/sim_*.cpp | grep -v sim_main) -o "$BIN" && "$BIN"
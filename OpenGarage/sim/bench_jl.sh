@@ -0,0 +1,14 @@
+#!/bin/sh
+# Peak heap and time to the first segment of /jl at several log sizes.
+# Fills the log with door open/close events, then fetches it.
+#   sh sim/bench_jl.sh [og_sim binary]   (run from the OpenGarage folder)
+SIM=${1:-.pio/build/native/program}
+TRACE=$(mktemp)
+trap 'rm -f "$TRACE"' EXIT
+awk 'BEGIN { for(i = 0; i < 450; i++) printf "%d dist %d\n", 10+i*20, i%2 ? 250 : 30;
+             printf "9100 get /jl\n9101 get /jl\n" }' > "$TRACE"
+for lsz in 20 100 400; do
+	printf 'lsz=%-4s' $lsz
+	# the second request runs with the log file and caches already warm
+	"$SIM" --trace "$TRACE" --duration 9102 --step-us 10000 --http --opt lsz=$lsz | grep '^---' | tail -1
+done
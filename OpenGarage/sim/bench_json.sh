@@ -0,0 +1,20 @@
+#!/bin/sh
+# Response bytes, heap allocations and peak heap of the JSON endpoints.
+#   sh sim/bench_json.sh [og_sim binary]   (run from the OpenGarage folder)
+SIM=${1:-.pio/build/native/program}
+TRACE=$(mktemp)
+trap 'rm -f "$TRACE"' EXIT
+cat > "$TRACE" <<END
+0  dist 250
+5  get /jc
+6  get /jo
+7  get /db
+8  get /cc?dkey=wrong&click=1
+9  get /jc
+10 get /jo
+11 get /db
+12 get /cc?dkey=wrong&click=1
+END
+# the first round warms up one-time caches (MAC string, AP name), the second is reported
+"$SIM" --trace "$TRACE" --duration 13 --http --opt tsn=3 |
+	awk '/^>>> / { url = $3 } /^--- / { n++; if(n > 4) printf "%-22s %s\n", url, $0 }'
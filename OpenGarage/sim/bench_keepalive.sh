@@ -0,0 +1,13 @@
+#!/bin/sh
+# Request rate, connections and heap of a client polling /jc back to back,
+# once through OTF (a new connection per request) and once on the update
+# server port, where the connection is kept alive.
+#   sh sim/bench_keepalive.sh [og_sim binary] [requests]   (run from the OpenGarage folder)
+SIM=${1:-.pio/build/native/program}
+N=${2:-200}
+TRACE=$(mktemp)
+trap 'rm -f "$TRACE"' EXIT
+for url in /jc :8080/jc; do
+	printf '0 dist 250\n5 load %s %s\n' "$url" "$N" > "$TRACE"
+	"$SIM" --trace "$TRACE" --duration $((6 + N/10)) | grep '^load'
+done
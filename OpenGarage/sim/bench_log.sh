@@ -0,0 +1,15 @@
+#!/bin/sh
+# Flash page rewrites and write volume of the door event log.
+# Alternates the door between closed and open every 10 s, then fetches /jl.
+#   sh sim/bench_log.sh [og_sim binary]   (run from the OpenGarage folder)
+SIM=${1:-.pio/build/native/program}
+TRACE=$(mktemp)
+trap 'rm -f "$TRACE"' EXIT
+for n in 100 1000; do
+	awk -v n=$n 'BEGIN { for(i = 0; i < n; i++) printf "%d dist %d\n", 10+i*10, i%2 ? 250 : 30;
+	                     printf "%d get /jl\n", 20+n*10 }' > "$TRACE"
+	printf 'events=%-5s' $n
+	"$SIM" --trace "$TRACE" --duration $((30+n*10)) --step-us 50000 --http --opt lsz=400 --fs |
+		awk '/^fs writes/ { w = $0 } /^fs page rewrites/ { r = $4 } /^fs  log/ { f = f " " $2 "=" $3 }
+		     END { sub(/^fs writes +/, "", w); printf " writes %s, page rewrites %s,%s\n", w, r, f }'
+done
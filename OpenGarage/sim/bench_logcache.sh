@@ -0,0 +1,20 @@
+#!/bin/sh
+# Flash traffic of logging door events and of serving recent log entries.
+# 200 door events 10 s apart, then a dashboard polling the newest entries.
+#   sh sim/bench_logcache.sh [og_sim binary]   (run from the OpenGarage folder)
+SIM=${1:-.pio/build/native/program}
+TRACE=$(mktemp)
+trap 'rm -f "$TRACE"' EXIT
+stats() {
+	"$SIM" --trace "$TRACE" --duration 2600 --step-us 50000 --http --opt lsz=100 |
+		awk '/^fs writes/ { sub(/^fs writes +/, ""); w = $0 } /^fs reads/ { sub(/^fs reads +/, ""); r = $0 }
+		     /^---/ { n++; sub(/.*done after /, ""); t += $1 }
+		     END { printf "fs writes %s, fs reads %s", w, r; if(n) printf ", %d requests, %.1f us avg", n, t/n; printf "\n" }'
+}
+awk 'BEGIN { for(i = 0; i < 200; i++) printf "%d dist %d\n", 10+i*10, i%2 ? 250 : 30 }' > "$TRACE"
+printf '%-18s' 'events only'; stats
+for q in '/jl?limit=10' '/jl'; do
+	awk -v q="$q" 'BEGIN { for(i = 0; i < 200; i++) printf "%d dist %d\n", 10+i*10, i%2 ? 250 : 30;
+	                      for(i = 0; i < 50; i++) printf "%d get %s\n", 2100+i*10, q }' > "$TRACE"
+	printf '%-18s' "+50 $q"; stats
+done
@@ -0,0 +1,36 @@
+#!/bin/sh
+# Firmware uploads with a wrong device key, a file that is not an image, a
+# wrong hash and a good one: what reaches flash and how much of each upload
+# the controller refuses to read. Then 1.2.4 as a full image and as a patch
+# against 1.2.3, which needs node for ota_delta.mjs, and the patch pulled
+# from a mirror that breaks off three ranges; the door closes at 300s.
+#   sh sim/bench_ota.sh [og_sim binary]   (run from the OpenGarage folder)
+SIM=${1:-.pio/build/native/program}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+head -c 409599 /dev/urandom > "$DIR/body"
+printf '\351' | cat - "$DIR/body" > "$DIR/fw.bin"
+printf 'PK' | cat - "$DIR/body" > "$DIR/notfw.bin"
+SHA=$(sha256sum "$DIR/fw.bin" | cut -c1-64)
+for up in "dkey=wrong fw.bin" "dkey=opendoor notfw.bin" "dkey=opendoor&sha256=0 fw.bin" "dkey=opendoor&sha256=$SHA fw.bin"; do
+	set -- $up
+	printf '0 dist 250\n3 upload :8080/update?%s %s/%s\n' "$1" "$DIR" "$2" > "$DIR/trace"
+	echo "$1 $2"
+	"$SIM" --trace "$DIR/trace" --duration 40 --opt mod=2 | grep -E '^(ota flash|device restarted)'
+done
+
+# a release as a full image and as a patch against the one before it
+BINS=../docs/docs/assets/bins
+node ota_delta.mjs diff "$BINS/og_1.2.3.bin" "$BINS/og_1.2.4.bin" "$DIR/1.2.4.ogd" > /dev/null || exit 1
+for f in "$BINS/og_1.2.4.bin" "$DIR/1.2.4.ogd"; do
+	printf '0 dist 250\n3 upload :8080/update?dkey=opendoor %s\n' "$f" > "$DIR/trace"
+	echo "1.2.3 -> $(basename "$f") ($(wc -c < "$f") bytes)"
+	"$SIM" --firmware "$BINS/og_1.2.3.bin" --trace "$DIR/trace" --duration 60 --opt mod=2 | grep -E '^(ota image|device restarted)'
+done
+
+# the patch pulled from a local mirror
+printf 'version=%s\nurl=/1.2.4.ogd\nsize=%s\nsha256=%s\n' 125 "$(wc -c < "$DIR/1.2.4.ogd")" "$(sha256sum "$DIR/1.2.4.ogd" | cut -c1-64)" > "$DIR/manifest.txt"
+printf '0 dist 20\n0 mirror mirror.local:8000 %s 3\n300 dist 250\n' "$DIR" > "$DIR/trace"
+echo "1.2.3 -> 1.2.4.ogd pulled"
+"$SIM" --firmware "$BINS/og_1.2.3.bin" --trace "$DIR/trace" --duration 600 --opt mod=2 \
+	--opt ourl=http://mirror.local:8000/manifest.txt --opt ouws=0 --opt ouwe=0 | grep -E '^(ota image|device restarted)'
@@ -0,0 +1,151 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: Security+ garage door opener library
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+// main.cpp includes this file directly, like the real library, so it is
+// not compiled on its own (the native build only picks up sim_*.cpp).
+
+#ifndef _SIM_GARAGELIB_CPP
+#define _SIM_GARAGELIB_CPP
+
+#include <Arduino.h>
+#include "sim.h"
+
+typedef void (*garagelib_debug_callback_t)(const char *message);
+static garagelib_debug_callback_t garagelib_debug_callback = nullptr;
+inline void garagelib_set_debug_callback(garagelib_debug_callback_t cb) { garagelib_debug_callback = cb; }
+
+namespace SecPlusCommon {
+	enum class DoorStatus : uint8_t { UNKNOWN = 0, OPEN, CLOSED, STOPPED, OPENING, CLOSING };
+}
+
+namespace SimSecPlus {
+	using SecPlusCommon::DoorStatus;
+	const uint32_t TRAVEL_MS = 10000; // door travel time between limits
+
+	/** Door, light and lock state shared by both protocol versions. The
+	 *  door position follows Sim::secplus_door when the trace sets it, and
+	 *  otherwise moves in response to the commands below. */
+	struct Opener {
+		bool light = false;
+		bool lock = false;
+		bool obstruction = false;
+		uint16_t openings = 0;
+		uint32_t travel = 0;
+
+		DoorStatus door() const { return (DoorStatus)Sim::secplus_door; }
+		void set_door(DoorStatus d) { Sim::secplus_door = (int)d; Sim::secplus_changed = true; }
+		void move(DoorStatus through, DoorStatus to) {
+			if(travel) Sim::cancel(travel);
+			set_door(through);
+			travel = Sim::schedule(Sim::now_us()+(uint64_t)TRAVEL_MS*1000, 0, [this, to]() {
+				travel = 0;
+				if(to==DoorStatus::OPEN) openings++;
+				set_door(to);
+			});
+		}
+		void open()  { if(door()!=DoorStatus::OPEN && door()!=DoorStatus::OPENING) move(DoorStatus::OPENING, DoorStatus::OPEN); }
+		void close() { if(door()!=DoorStatus::CLOSED && door()!=DoorStatus::CLOSING) move(DoorStatus::CLOSING, DoorStatus::CLOSED); }
+		void toggle() {
+			switch(door()) {
+			case DoorStatus::OPENING:
+			case DoorStatus::CLOSING:
+				if(travel) { Sim::cancel(travel); travel = 0; }
+				set_door(DoorStatus::STOPPED);
+				break;
+			case DoorStatus::OPEN:
+			case DoorStatus::STOPPED:
+				close();
+				break;
+			default:
+				open();
+			}
+		}
+		void note(const char *what) { if(garagelib_debug_callback) garagelib_debug_callback(what); }
+	};
+	static Opener opener;
+}
+
+namespace SecPlus1 {
+	struct state_struct_t {
+		SecPlusCommon::DoorStatus door_state;
+		bool light_state;
+		bool lock_state;
+		bool obstruction_state;
+	};
+	typedef void (*state_callback_t)(state_struct_t);
+
+	class Garage {
+	public:
+		Garage(uint8_t rx, uint8_t tx) { (void)rx; (void)tx; }
+		void begin() {}
+		void reset_state() { _cb = nullptr; }
+		void enable_callback(state_callback_t cb) { _cb = cb; Sim::secplus_changed = true; }
+		bool detect() { return false; }
+		void loop() {
+			if(!Sim::secplus_changed || !_cb) return;
+			Sim::secplus_changed = false;
+			SimSecPlus::Opener &o = SimSecPlus::opener;
+			_cb({o.door(), o.light, o.lock, o.obstruction});
+		}
+		void toggle_door() { SimSecPlus::opener.note("[SEC+1] toggle door"); SimSecPlus::opener.toggle(); }
+		void toggle_light() { SimSecPlus::opener.light = !SimSecPlus::opener.light; Sim::secplus_changed = true; }
+		void toggle_lock() { SimSecPlus::opener.lock = !SimSecPlus::opener.lock; Sim::secplus_changed = true; }
+		int get_panel_emu_status() { return 0; }
+	private:
+		state_callback_t _cb = nullptr;
+	};
+}
+
+namespace SecPlus2 {
+	struct state_struct_t {
+		SecPlusCommon::DoorStatus door_state;
+		bool light_state;
+		bool lock_state;
+		bool obstruction_state;
+		uint16_t openings;
+	};
+	typedef void (*state_callback_t)(state_struct_t);
+
+	class Garage {
+	public:
+		Garage(uint32_t id, uint8_t rx, uint8_t tx) { (void)id; (void)rx; (void)tx; }
+		void begin() {}
+		void reset_state() { _cb = nullptr; }
+		void enable_callback(state_callback_t cb) { _cb = cb; Sim::secplus_changed = true; }
+		bool detect() { return Sim::secplus_door != 0; }
+		void loop() {
+			if(!Sim::secplus_changed || !_cb) return;
+			Sim::secplus_changed = false;
+			SimSecPlus::Opener &o = SimSecPlus::opener;
+			_cb({o.door(), o.light, o.lock, o.obstruction, o.openings});
+		}
+		void open_door() { SimSecPlus::opener.note("[SEC+2] open door"); SimSecPlus::opener.open(); }
+		void close_door() { SimSecPlus::opener.note("[SEC+2] close door"); SimSecPlus::opener.close(); }
+		void toggle_door() { SimSecPlus::opener.note("[SEC+2] toggle door"); SimSecPlus::opener.toggle(); }
+		void toggle_light() { SimSecPlus::opener.light = !SimSecPlus::opener.light; Sim::secplus_changed = true; }
+		void toggle_lock() { SimSecPlus::opener.lock = !SimSecPlus::opener.lock; Sim::secplus_changed = true; }
+	private:
+		state_callback_t _cb = nullptr;
+	};
+}
+
+#endif  // _SIM_GARAGELIB_CPP
@@ -0,0 +1,186 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: virtual board control interface
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SIM_H
+#define _SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+/** The simulated board. Everything the shims need to share lives here:
+ *  the virtual clock, pin levels, the timer/ticker queue, the distance
+ *  sensor model and a few counters that the driver prints at the end.
+ *  Nothing in here is visible to the firmware sources. */
+namespace Sim {
+	// virtual clock (microseconds since boot)
+	uint64_t now_us();
+	void advance_us(uint64_t us);   // moves the clock, firing due timers on the way
+	void set_epoch(uint32_t epoch); // UTC time reported once configTime() has been called
+	uint32_t epoch_now();
+	extern bool ntp_configured;
+	extern bool ntp_reachable;      // false: time() stays on the uptime clock as if NTP had no answer
+
+	// timers (Ticker, delayed pin events)
+	typedef std::function<void()> callback_t;
+	uint32_t schedule(uint64_t at_us, uint64_t period_us, callback_t cb);
+	void cancel(uint32_t id);
+
+	// GPIO
+	void set_pin(uint8_t pin, int level);  // drive an input pin (fires attached interrupts)
+	int  get_pin(uint8_t pin);
+	void on_pin_write(uint8_t pin, int level);
+	void attach_isr(uint8_t pin, void (*isr)(), int mode);
+	void detach_isr(uint8_t pin);
+
+	// sensors
+	extern uint32_t distance_cm;    // 0 means no echo (sensor timeout)
+	extern float temperature;
+	extern float humidity;
+
+	// network
+	extern bool wifi_connected;
+	extern bool mqtt_available;
+	extern uint32_t http_latency_ms; // time spent inside blocking HTTP/SMTP client calls
+	extern int rssi;
+	extern int ifttt_status;         // status code of the IFTTT webhook server, 0 when unreachable
+	extern uint32_t lan_rtt_ms;      // round trip between the device and a client on the home network
+
+	/** A scripted remote endpoint that WiFiClient connections are routed to.
+	 *  The peer sees what the device writes and queues replies, optionally
+	 *  delayed on the virtual clock to model round-trip time. */
+	class Peer {
+	public:
+		virtual ~Peer() {}
+		virtual void on_connect() {}
+		virtual void on_receive(const uint8_t *data, size_t len) = 0;
+		void send(const char *data, size_t len, uint32_t delay_ms = 0);
+		void send(const char *data, uint32_t delay_ms = 0);
+		void close() { closed = true; }
+		size_t available() const;
+		bool draining() const { return !pending.empty(); } // replies still in flight
+		int read();
+		int peek() const;
+		bool closed = false;
+		int refs = 0;  // WiFiClient copies sharing the connection
+	private:
+		struct Chunk { uint64_t ready_us; size_t pos; std::vector<char> bytes; };
+		std::deque<Chunk> pending;
+	};
+	typedef std::function<Peer*()> peer_factory_t;
+	void register_peer(const char *host, uint16_t port, peer_factory_t factory);
+	Peer *connect_peer(const char *host, uint16_t port); // nullptr if nobody listens
+	/** A mail server on host:port. With an empty script it answers every
+	 *  command the way a well-behaved server does; otherwise it replays the
+	 *  script, one reply per command (greeting first). Lines of a multi-line
+	 *  reply ("250-...") go out together with the final line. "@hang" stops
+	 *  answering, "@close" drops the connection. */
+	void register_smtp_server(const char *host, uint16_t port, const std::vector<std::string> &script);
+	/** A web server on host:port serving the files in dir, with Range
+	 *  requests answered by 206. The first 'cut' ranged responses break off
+	 *  halfway through the body, as on a flaky link. */
+	void register_http_mirror(const char *host, uint16_t port, const std::string &dir, int cut);
+
+	/** An HTTP request injected by the driver. A url of the form
+	 *  ":8080/path" goes to the server listening on that port; plain
+	 *  "/path" goes to the OTF server. */
+	struct HttpRequest {
+		std::string method;
+		std::string url;
+		std::string headers;   // "Name: value" lines separated by \n
+		std::string filename;  // set for multipart uploads
+		std::string fields;    // "k=v&k=v" form fields sent before the file part
+		std::vector<uint8_t> body;
+	};
+	void queue_http_request(const char *method, const char *url, const char *headers = "");
+	void queue_http_upload(const char *url, const char *filename, const std::vector<uint8_t> &body, const char *fields = "");
+	bool take_http_request(uint16_t port, HttpRequest &req); // first queued request for that port
+	void hangup_http_clients(uint16_t port); // browsers drop connections the device kept open
+	/** Closed-loop load: n requests to url, each sent one LAN round trip
+	 *  after the previous response. A connection the device keeps alive is
+	 *  reused; a new one costs another round trip for the handshake. A
+	 *  summary is printed when the last response is in. */
+	void start_http_load(const char *url, int n);
+	void poll_http_load();   // called by the driver every iteration
+	void http_response_done(uint16_t port); // a response was sent on a connection the device closes
+	// MQTT messages injected into the broker, delivered from PubSubClient::loop()
+	void queue_mqtt_message(const char *topic, const char *payload);
+
+	// flash
+	extern std::vector<uint8_t> sketch;  // the running firmware image (--firmware); all 0xFF if empty
+	extern std::string ota_image;        // SHA-256 of the last image the OTA updater completed
+
+	// Security+ opener state, reported through the garagelib callbacks
+	extern int secplus_door;  // SecPlusCommon::DoorStatus value
+	extern bool secplus_changed;
+
+	// counters
+	struct Stats {
+		uint64_t relay_clicks;
+		uint64_t tone_calls;
+		uint64_t mqtt_publishes;
+		uint64_t mqtt_dropped;  // larger than the PubSubClient buffer
+		uint64_t http_requests;
+		uint64_t http_response_bytes;
+		uint64_t http_connections;
+		uint64_t fs_writes;
+		uint64_t fs_bytes_written;
+		uint64_t fs_opens;
+		uint64_t fs_reads;
+		uint64_t fs_bytes_read;
+		uint64_t fs_pages_rewritten;
+		uint64_t notifications;
+		uint64_t restarts;
+		uint64_t flash_bytes_written;   // firmware images, by the OTA updater
+		uint64_t upload_bytes_refused;  // upload bytes never read, the server hung up
+	};
+	extern Stats stats;
+
+	// heap accounting (all host allocations, including String buffers)
+	struct Heap {
+		uint64_t allocs;
+		uint64_t frees;
+		int64_t  live;
+		int64_t  peak;
+	};
+	extern Heap heap;
+	void heap_reset_peak();
+	void heap_note(int64_t delta, int allocs, int frees); // String buffers are malloc'ed, so the shim reports them here
+	/** Excludes the simulator's own bookkeeping (file contents, queues)
+	 *  from the heap counters while in scope. */
+	struct HeapPause {
+		HeapPause();
+		~HeapPause();
+	};
+
+	// output
+	extern bool verbose;       // echo Serial and MQTT traffic to stdout
+	extern bool print_http;    // print responses of injected HTTP requests
+
+	// thrown by ESP.restart() and caught by the driver
+	struct Restart {};
+}
+
+#endif  // _SIM_H
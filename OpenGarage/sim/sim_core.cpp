@@ -0,0 +1,343 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: virtual clock, timers, GPIO and the Arduino core
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <chrono>
+#include <map>
+#include <new>
+#include "sim.h"
+#include "../defines.h"
+
+namespace Sim {
+	bool ntp_configured = false;
+	bool ntp_reachable = true;
+	uint32_t distance_cm = 0;
+	float temperature = 21.5f;
+	float humidity = 40.0f;
+	bool wifi_connected = true;
+	bool mqtt_available = true;
+	uint32_t http_latency_ms = 150;
+	int ifttt_status = 200;
+	uint32_t lan_rtt_ms = 5;
+	int rssi = -58;
+	int secplus_door = 0;
+	bool secplus_changed = false;
+	Stats stats = {};
+	std::vector<uint8_t> sketch;
+	std::string ota_image;
+	Heap heap = {};
+	bool verbose = false;
+	bool print_http = false;
+
+	static uint64_t clock_us = 0;
+	static uint32_t epoch_base = 1760000000UL; // Oct 2025, well past NTP_VALID_TIME
+
+	struct Timer { uint64_t period_us; callback_t cb; uint32_t id; };
+	static std::multimap<uint64_t, Timer> *timers;
+	static uint32_t next_timer_id = 1;
+	static int heap_paused = 0;
+
+	static std::multimap<uint64_t, Timer> &timer_queue() {
+		if(!timers) { HeapPause p; timers = new std::multimap<uint64_t, Timer>(); }
+		return *timers;
+	}
+
+	uint64_t now_us() { return clock_us; }
+
+	void advance_us(uint64_t us) {
+		uint64_t target = clock_us + us;
+		auto &q = timer_queue();
+		while(!q.empty() && q.begin()->first <= target) {
+			auto it = q.begin();
+			Timer t;
+			{
+				HeapPause p;
+				t = it->second;
+				clock_us = std::max(clock_us, it->first);
+				q.erase(it);
+				if(t.period_us) q.insert({clock_us + t.period_us, t});
+			}
+			t.cb();
+		}
+		clock_us = target;
+	}
+
+	void set_epoch(uint32_t epoch) { epoch_base = epoch - (uint32_t)(clock_us/1000000); }
+	uint32_t epoch_now() { return epoch_base + (uint32_t)(clock_us/1000000); }
+
+	uint32_t schedule(uint64_t at_us, uint64_t period_us, callback_t cb) {
+		HeapPause p;
+		uint32_t id = next_timer_id++;
+		timer_queue().insert({at_us, Timer{period_us, cb, id}});
+		return id;
+	}
+
+	void cancel(uint32_t id) {
+		HeapPause p;
+		auto &q = timer_queue();
+		for(auto it = q.begin(); it != q.end(); ++it) {
+			if(it->second.id == id) { q.erase(it); return; }
+		}
+	}
+
+	/* GPIO: output pins remember what was written, input pins read what
+	 * the trace (or a pull-up) drives. PIN_TRIG and PIN_ECHO are wired
+	 * to an ultrasonic sensor model. */
+	static const int NUM_PINS = 17;
+	static int pin_level[NUM_PINS];
+	static uint8_t pin_mode_[NUM_PINS];
+	static bool pin_driven[NUM_PINS];
+	static void (*pin_isr[NUM_PINS])();
+	static uint64_t trig_rise_us = 0;
+
+	static const uint32_t ECHO_DELAY_US = 200;   // eight 40kHz bursts before the echo line rises
+	static const uint32_t ECHO_MAX_CM = 450;     // beyond this the sensor never sees an echo
+
+	static void sensor_trigger() {
+		if(distance_cm == 0 || distance_cm > ECHO_MAX_CM) return;
+		uint64_t rise = clock_us + ECHO_DELAY_US;
+		uint64_t fall = rise + (uint64_t)(distance_cm / 0.01716f);
+		schedule(rise, 0, []() { set_pin(PIN_ECHO, HIGH); });
+		schedule(fall, 0, []() { set_pin(PIN_ECHO, LOW); });
+	}
+
+	void set_pin(uint8_t pin, int level) {
+		if(pin >= NUM_PINS) return;
+		pin_driven[pin] = true;
+		int old = pin_level[pin];
+		pin_level[pin] = level ? HIGH : LOW;
+		if(old != pin_level[pin] && pin_isr[pin]) pin_isr[pin]();
+	}
+
+	int get_pin(uint8_t pin) { return pin < NUM_PINS ? pin_level[pin] : LOW; }
+
+	void on_pin_write(uint8_t pin, int level) {
+		if(pin >= NUM_PINS) return;
+		int old = pin_level[pin];
+		pin_level[pin] = level ? HIGH : LOW;
+		if(pin == PIN_RELAY && !old && level) stats.relay_clicks++;
+		if(pin == PIN_TRIG) {
+			if(!old && level) trig_rise_us = clock_us;
+			// a 10-1000us high pulse starts a measurement
+			if(old && !level && clock_us-trig_rise_us >= 10 && clock_us-trig_rise_us <= 1000) sensor_trigger();
+		}
+	}
+
+	void attach_isr(uint8_t pin, void (*isr)(), int mode) { (void)mode; if(pin < NUM_PINS) pin_isr[pin] = isr; }
+	void detach_isr(uint8_t pin) { if(pin < NUM_PINS) pin_isr[pin] = nullptr; }
+
+	void heap_reset_peak() { heap.peak = heap.live; }
+
+	// String buffers are always counted: they are freed by firmware code
+	// even when the simulator created them, so pausing would unbalance them
+	void heap_note(int64_t delta, int allocs, int frees) {
+		heap.allocs += allocs;
+		heap.frees += frees;
+		heap.live += delta;
+		if(heap.live > heap.peak) heap.peak = heap.live;
+	}
+
+	HeapPause::HeapPause() { heap_paused++; }
+	HeapPause::~HeapPause() { heap_paused--; }
+}
+
+/* Every host allocation carries a small header so frees can be credited
+ * back; blocks made while the counters were paused are not counted at
+ * either end. */
+namespace {
+	struct AllocHeader { size_t size; size_t tracked; };
+}
+
+static void *sim_alloc(size_t size) {
+	AllocHeader *h = (AllocHeader *)malloc(sizeof(AllocHeader) + size);
+	if(!h) throw std::bad_alloc();
+	h->size = size;
+	h->tracked = Sim::heap_paused ? 0 : 1;
+	if(h->tracked) Sim::heap_note((int64_t)size, 1, 0);
+	return h + 1;
+}
+
+static void sim_free(void *p) {
+	if(!p) return;
+	AllocHeader *h = (AllocHeader *)p - 1;
+	if(h->tracked) Sim::heap_note(-(int64_t)h->size, 0, 1);
+	free(h);
+}
+
+void *operator new(size_t size) { return sim_alloc(size); }
+void *operator new[](size_t size) { return sim_alloc(size); }
+void operator delete(void *p) noexcept { sim_free(p); }
+void operator delete[](void *p) noexcept { sim_free(p); }
+void operator delete(void *p, size_t) noexcept { sim_free(p); }
+void operator delete[](void *p, size_t) noexcept { sim_free(p); }
+
+/* Arduino core */
+
+HardwareSerial Serial;
+EspClass ESP;
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+	size_t n = 0;
+	while(size--) n += write(*buffer++);
+	return n;
+}
+
+size_t Print::printf(const char *format, ...) {
+	char buf[256];
+	va_list ap;
+	va_start(ap, format);
+	int len = vsnprintf(buf, sizeof(buf), format, ap);
+	va_end(ap);
+	if(len < 0) return 0;
+	return write((const uint8_t *)buf, (size_t)len < sizeof(buf) ? (size_t)len : sizeof(buf)-1);
+}
+
+int Stream::timedRead() {
+	uint64_t start = Sim::now_us();
+	do {
+		int c = read();
+		if(c >= 0) return c;
+		yield();
+		Sim::advance_us(1000);
+	} while(Sim::now_us() - start < (uint64_t)_timeout*1000);
+	return -1;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+	size_t count = 0;
+	while(count < length) {
+		int c = timedRead();
+		if(c < 0) break;
+		*buffer++ = (char)c;
+		count++;
+	}
+	return count;
+}
+
+String Stream::readString() {
+	String ret;
+	int c;
+	while((c = timedRead()) >= 0) ret += (char)c;
+	return ret;
+}
+
+String Stream::readStringUntil(char terminator) {
+	String ret;
+	int c;
+	while((c = timedRead()) >= 0 && c != terminator) ret += (char)c;
+	return ret;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+	if(Sim::verbose) fputc(c, stdout);
+	return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+	if(Sim::verbose) fwrite(buffer, 1, size, stdout);
+	return size;
+}
+
+bool IPAddress::fromString(const char *address) {
+	unsigned a, b, c, d;
+	char tail;
+	if(sscanf(address, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4) return false;
+	if(a > 255 || b > 255 || c > 255 || d > 255) return false;
+	*this = IPAddress(a, b, c, d);
+	return true;
+}
+
+String IPAddress::toString() const {
+	char buf[16];
+	snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _address.bytes[0], _address.bytes[1], _address.bytes[2], _address.bytes[3]);
+	return String(buf);
+}
+
+size_t IPAddress::printTo(Print &p) const { return p.print(toString()); }
+
+void EspClass::restart() {
+	Sim::stats.restarts++;
+	throw Sim::Restart();
+}
+
+uint32_t EspClass::getSketchSize() {
+	return Sim::sketch.empty() ? 600*1024 : Sim::sketch.size();
+}
+
+bool EspClass::flashRead(uint32_t address, uint8_t *data, size_t size) {
+	if(address + size > getFlashChipSize()) return false;
+	for(size_t i = 0; i < size; i++, address++) data[i] = address < Sim::sketch.size() ? Sim::sketch[address] : 0xFF;
+	return true;
+}
+
+uint32_t EspClass::getFreeHeap() {
+	// what a d1_mini typically has left after boot, minus what is live now
+	const int64_t BASELINE = 52000;
+	int64_t free = BASELINE - Sim::heap.live;
+	return free > 0 ? (uint32_t)free : 0;
+}
+
+/* The cycle counter advances with both virtual time (80 cycles/us) and
+ * host time spent running firmware code, scaled so the host looks like a
+ * slow 80MHz core. Stage timings measured with it are therefore dominated
+ * by real work, not by the loop step size. */
+uint32_t EspClass::getCycleCount() {
+	static const auto start = std::chrono::steady_clock::now();
+	uint64_t host_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	return (uint32_t)(host_ns*8/100 + Sim::now_us()*80);
+}
+
+unsigned long millis() { return (unsigned long)(Sim::now_us()/1000); }
+unsigned long micros() { return (unsigned long)(uint32_t)Sim::now_us(); }
+void delay(unsigned long ms) { Sim::advance_us((uint64_t)ms*1000); }
+void delayMicroseconds(unsigned int us) { Sim::advance_us(us); }
+void yield() {}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	if(pin >= Sim::NUM_PINS) return;
+	Sim::pin_mode_[pin] = mode;
+	if(mode == INPUT_PULLUP && !Sim::pin_driven[pin]) Sim::pin_level[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) { Sim::on_pin_write(pin, val); }
+int digitalRead(uint8_t pin) { return Sim::get_pin(pin); }
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) { Sim::attach_isr(pin, isr, mode); }
+void detachInterrupt(uint8_t pin) { Sim::detach_isr(pin); }
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration) { (void)pin; (void)frequency; (void)duration; Sim::stats.tone_calls++; }
+void noTone(uint8_t pin) { (void)pin; }
+
+long random(long howbig) { return howbig > 0 ? rand() % howbig : 0; }
+long random(long howsmall, long howbig) { return howbig > howsmall ? howsmall + random(howbig - howsmall) : howsmall; }
+
+void configTime(int timezone, int daylightOffset_sec, const char *server1, const char *server2, const char *server3) {
+	(void)timezone; (void)daylightOffset_sec; (void)server1; (void)server2; (void)server3;
+	Sim::ntp_configured = true;
+}
+
+// The firmware calls time(nullptr) directly; answer from the virtual clock.
+extern "C" time_t time(time_t *t) noexcept {
+	time_t now = Sim::ntp_configured && Sim::ntp_reachable ? (time_t)Sim::epoch_now() : (time_t)(Sim::now_us()/1000000);
+	if(t) *t = now;
+	return now;
+}
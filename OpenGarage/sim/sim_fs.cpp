@@ -0,0 +1,206 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: in-memory flash file system
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <FS.h>
+#include <map>
+#include <string>
+#include "sim.h"
+
+namespace fs {
+
+struct FileData {
+	std::vector<uint8_t> bytes;
+};
+
+// file contents are simulator bookkeeping, not firmware heap
+static std::map<std::string, std::shared_ptr<FileData>> &files() {
+	static std::map<std::string, std::shared_ptr<FileData>> *m = nullptr;
+	if(!m) { Sim::HeapPause p; m = new std::map<std::string, std::shared_ptr<FileData>>(); }
+	return *m;
+}
+
+static const size_t FS_TOTAL = 957314;  // 1MB SPIFFS partition on a d1_mini
+static const size_t FS_BLOCK = 8192;
+static const size_t FS_PAGE = 256;
+
+File::File(std::shared_ptr<FileData> data, const char *name, bool rd, bool wr, bool app)
+	: _data(data), _name(name), _pos(0), _read(rd), _write(wr), _append(app) {
+	if(_append) _pos = _data->bytes.size();
+}
+
+size_t File::write(uint8_t c) { return write(&c, 1); }
+
+size_t File::write(const uint8_t *buf, size_t size) {
+	if(!_data || !_write) return 0;
+	Sim::HeapPause p;
+	if(_append) _pos = _data->bytes.size();
+	// overwriting bytes already on flash costs a page rewrite, appending does not
+	size_t old = _data->bytes.size();
+	if(_pos < old) {
+		size_t end = std::min(old, _pos + size);
+		Sim::stats.fs_pages_rewritten += (end-1)/FS_PAGE - _pos/FS_PAGE + 1;
+	}
+	if(_pos + size > _data->bytes.size()) _data->bytes.resize(_pos + size);
+	memcpy(&_data->bytes[_pos], buf, size);
+	_pos += size;
+	Sim::stats.fs_writes++;
+	Sim::stats.fs_bytes_written += size;
+	return size;
+}
+
+int File::available() {
+	if(!_data || !_read) return 0;
+	return _pos < _data->bytes.size() ? (int)(_data->bytes.size() - _pos) : 0;
+}
+
+int File::read() {
+	if(!available()) return -1;
+	Sim::stats.fs_reads++;
+	Sim::stats.fs_bytes_read++;
+	return _data->bytes[_pos++];
+}
+
+int File::peek() {
+	if(!available()) return -1;
+	return _data->bytes[_pos];
+}
+
+size_t File::read(uint8_t *buf, size_t size) {
+	size_t n = available();
+	if(n > size) n = size;
+	if(n) memcpy(buf, &_data->bytes[_pos], n);
+	_pos += n;
+	Sim::stats.fs_reads++;
+	Sim::stats.fs_bytes_read += n;
+	return n;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+	if(!_data) return false;
+	size_t base = mode == SeekSet ? 0 : mode == SeekCur ? _pos : _data->bytes.size();
+	size_t target = base + pos;
+	if(target > _data->bytes.size()) return false;
+	_pos = target;
+	return true;
+}
+
+size_t File::size() const { return _data ? _data->bytes.size() : 0; }
+
+bool File::truncate(uint32_t size) {
+	if(!_data || !_write) return false;
+	Sim::HeapPause p;
+	_data->bytes.resize(size);
+	if(_pos > size) _pos = size;
+	return true;
+}
+
+void File::close() { _data.reset(); }
+
+bool Dir::next() {
+	auto &m = files();
+	int i = 0;
+	for(auto it = m.begin(); it != m.end(); ++it, ++i) {
+		if(i <= _index) continue;
+		if(strncmp(it->first.c_str(), _path.c_str(), _path.length()) != 0) continue;
+		_index = i;
+		_current = it->first.c_str() + (_path.endsWith("/") ? _path.length() : (_path.length() ? _path.length()+1 : 1));
+		return true;
+	}
+	_index = i;
+	return false;
+}
+
+size_t Dir::fileSize() const {
+	for(auto &kv : files()) {
+		if(kv.first.size() >= _current.length() && kv.first.compare(kv.first.size()-_current.length(), std::string::npos, _current.c_str()) == 0)
+			return kv.second->bytes.size();
+	}
+	return 0;
+}
+
+File Dir::openFile(const char *mode) {
+	String full = _path;
+	if(!full.endsWith("/")) full += "/";
+	full += _current;
+	return SPIFFS.open(full, mode);
+}
+
+bool FS::begin() { return true; }
+
+bool FS::format() {
+	Sim::HeapPause p;
+	files().clear();
+	return true;
+}
+
+bool FS::info(FSInfo &info) {
+	size_t used = 0;
+	for(auto &kv : files()) used += ((kv.second->bytes.size() + FS_PAGE - 1) / FS_PAGE + 1) * FS_PAGE;
+	info.totalBytes = FS_TOTAL;
+	info.usedBytes = used;
+	info.blockSize = FS_BLOCK;
+	info.pageSize = FS_PAGE;
+	info.maxOpenFiles = 5;
+	info.maxPathLength = 32;
+	return true;
+}
+
+File FS::open(const char *path, const char *mode) {
+	Sim::HeapPause p;
+	Sim::stats.fs_opens++;
+	auto &m = files();
+	auto it = m.find(path);
+	bool plus = strchr(mode, '+') != nullptr;
+	if(mode[0] == 'r') {
+		if(it == m.end()) return File();
+		return File(it->second, path, true, plus, false);
+	}
+	if(it == m.end() || mode[0] == 'w') {
+		auto data = std::make_shared<FileData>();
+		if(it == m.end()) m[path] = data;
+		else { it->second->bytes.clear(); data = it->second; }
+		return File(m[path], path, plus, true, mode[0] == 'a');
+	}
+	return File(it->second, path, plus, true, mode[0] == 'a');
+}
+
+bool FS::exists(const char *path) { return files().count(path) > 0; }
+
+bool FS::remove(const char *path) {
+	Sim::HeapPause p;
+	return files().erase(path) > 0;
+}
+
+bool FS::rename(const char *pathFrom, const char *pathTo) {
+	Sim::HeapPause p;
+	auto &m = files();
+	auto it = m.find(pathFrom);
+	if(it == m.end() || m.count(pathTo)) return false;
+	m[pathTo] = it->second;
+	m.erase(pathFrom);
+	return true;
+}
+
+} // namespace fs
+
+fs::FS SPIFFS;
+fs::FS LittleFS;
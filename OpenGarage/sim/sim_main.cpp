@@ -0,0 +1,290 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: driver
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/* Runs the firmware's do_setup()/do_loop() on the host against a scripted
+ * sensor trace. The loop is stepped on a virtual clock, so an hour of
+ * door activity runs in well under a second and results are repeatable.
+ *
+ *   og_sim [--trace file] [--duration s] [--step-us n] [--opt name=value]...
+ *          [--ap] [--serial] [--http] [--fs] [--epoch t] [--firmware image.bin]
+ *
+ * Trace lines are "<time_s> <event> <args>", '#' starts a comment:
+ *   dist <cm>              distance seen by the ultrasonic sensor (0: no echo)
+ *   switch <0|1>           level of the optional switch sensor input
+ *   button <0|1>           1 holds the push button down, 0 releases it
+ *   temp <c> / humid <pct> temperature and humidity sensor readings
+ *   wifi <0|1>             access point reachable
+ *   ntp <0|1>              NTP server answers (0: the clock stays unset)
+ *   broker <0|1>           MQTT broker reachable
+ *   ifttt <code>           status the IFTTT webhook answers with (0: unreachable)
+ *   smtp <host:port> [f]   start a mail server there, replaying the replies in file f
+ *   mirror <host:port> <dir> [n]  serve the files in dir; the first n range responses break off
+ *   secplus <state>        opener reports open|closed|stopped|opening|closing
+ *   get <url> [hdr|hdr]    HTTP GET; ":8080/path" targets the update server
+ *   post <url> [hdr|hdr]   same, as POST
+ *   upload <url> <file> [k=v&k=v]  multipart upload of a host file, after these form fields
+ *   hangup <:port>         browsers close connections the server kept open
+ *   load <url> <n>         n back-to-back requests from one client (see sim.h)
+ *   mqtt <topic> <payload> message delivered by the broker
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "sim.h"
+#include "../defines.h"
+
+void do_setup();
+void do_loop();
+
+namespace {
+
+struct Event {
+	double t;
+	std::string name;
+	std::string args;
+};
+
+std::vector<Event> load_trace(const char *path) {
+	std::vector<Event> events;
+	std::ifstream in(path);
+	if(!in) {
+		fprintf(stderr, "cannot open trace %s\n", path);
+		exit(1);
+	}
+	std::string line;
+	int lineno = 0;
+	while(std::getline(in, line)) {
+		lineno++;
+		size_t hash = line.find('#');
+		if(hash != std::string::npos) line.erase(hash);
+		std::istringstream ls(line);
+		Event e;
+		if(!(ls >> e.t)) continue;
+		if(!(ls >> e.name)) {
+			fprintf(stderr, "%s:%d: missing event name\n", path, lineno);
+			exit(1);
+		}
+		std::getline(ls, e.args);
+		size_t start = e.args.find_first_not_of(" \t");
+		e.args = start == std::string::npos ? "" : e.args.substr(start);
+		while(!e.args.empty() && isspace((unsigned char)e.args.back())) e.args.pop_back();
+		events.push_back(e);
+	}
+	std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.t < b.t; });
+	return events;
+}
+
+int door_status_value(const std::string &s) {
+	// SecPlusCommon::DoorStatus order
+	static const char *names[] = {"unknown", "open", "closed", "stopped", "opening", "closing"};
+	for(int i = 0; i < 6; i++) if(s == names[i]) return i;
+	return 0;
+}
+
+std::string split_first(const std::string &s, std::string &rest) {
+	size_t sp = s.find(' ');
+	rest = sp == std::string::npos ? "" : s.substr(s.find_first_not_of(' ', sp) == std::string::npos ? s.size() : s.find_first_not_of(' ', sp));
+	return s.substr(0, sp);
+}
+
+void apply(const Event &e) {
+	const std::string &a = e.args;
+	if(e.name == "dist") Sim::distance_cm = (uint32_t)atoi(a.c_str());
+	else if(e.name == "switch") Sim::set_pin(PIN_SWITCH, atoi(a.c_str()) ? HIGH : LOW);
+	else if(e.name == "button") Sim::set_pin(PIN_BUTTON, atoi(a.c_str()) ? LOW : HIGH);
+	else if(e.name == "temp") Sim::temperature = (float)atof(a.c_str());
+	else if(e.name == "humid") Sim::humidity = (float)atof(a.c_str());
+	else if(e.name == "wifi") Sim::wifi_connected = atoi(a.c_str()) != 0;
+	else if(e.name == "ntp") Sim::ntp_reachable = atoi(a.c_str()) != 0;
+	else if(e.name == "broker") Sim::mqtt_available = atoi(a.c_str()) != 0;
+	else if(e.name == "ifttt") Sim::ifttt_status = atoi(a.c_str());
+	else if(e.name == "secplus") { Sim::secplus_door = door_status_value(a); Sim::secplus_changed = true; }
+	else if(e.name == "get" || e.name == "post") {
+		std::string headers;
+		std::string url = split_first(a, headers);
+		for(char &c : headers) if(c == '|') c = '\n';
+		Sim::queue_http_request(e.name == "get" ? "GET" : "POST", url.c_str(), headers.c_str());
+	} else if(e.name == "load") {
+		std::string n;
+		std::string url = split_first(a, n);
+		Sim::start_http_load(url.c_str(), atoi(n.c_str()));
+	} else if(e.name == "hangup") {
+		Sim::hangup_http_clients((uint16_t)atoi(a.c_str() + (a[0] == ':')));
+	} else if(e.name == "upload") {
+		std::string rest, fields;
+		std::string url = split_first(a, rest);
+		std::string file = split_first(rest, fields);
+		std::ifstream in(file, std::ios::binary);
+		if(!in) { fprintf(stderr, "cannot open upload %s\n", file.c_str()); exit(1); }
+		std::vector<uint8_t> body((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		size_t slash = file.find_last_of('/');
+		Sim::queue_http_upload(url.c_str(), file.substr(slash == std::string::npos ? 0 : slash+1).c_str(), body, fields.c_str());
+	} else if(e.name == "smtp") {
+		std::string file;
+		std::string addr = split_first(a, file);
+		size_t colon = addr.find(':');
+		if(colon == std::string::npos) { fprintf(stderr, "smtp expects host:port\n"); exit(1); }
+		std::vector<std::string> script;
+		if(!file.empty()) {
+			std::ifstream in(file);
+			if(!in) { fprintf(stderr, "cannot open smtp script %s\n", file.c_str()); exit(1); }
+			std::string line;
+			while(std::getline(in, line)) if(!line.empty() && line[0] != '#') script.push_back(line);
+		}
+		Sim::register_smtp_server(addr.substr(0, colon).c_str(), (uint16_t)atoi(addr.c_str()+colon+1), script);
+	} else if(e.name == "mirror") {
+		std::string rest, dir, cut;
+		std::string addr = split_first(a, rest);
+		dir = split_first(rest, cut);
+		size_t colon = addr.find(':');
+		if(colon == std::string::npos || dir.empty()) { fprintf(stderr, "mirror expects host:port dir\n"); exit(1); }
+		Sim::register_http_mirror(addr.substr(0, colon).c_str(), (uint16_t)atoi(addr.c_str()+colon+1), dir, atoi(cut.c_str()));
+	} else if(e.name == "mqtt") {
+		std::string payload;
+		std::string topic = split_first(a, payload);
+		Sim::queue_mqtt_message(topic.c_str(), payload.c_str());
+	} else {
+		fprintf(stderr, "unknown trace event '%s' at %.3fs\n", e.name.c_str(), e.t);
+		exit(1);
+	}
+}
+
+void seed_config(const std::vector<std::string> &opts) {
+	File f = SPIFFS.open(CONFIG_FNAME, "w");
+	for(const std::string &o : opts) {
+		size_t eq = o.find('=');
+		if(eq == std::string::npos) { fprintf(stderr, "--opt expects name=value\n"); exit(1); }
+		f.print(String(o.substr(0, eq).c_str()) + ":" + o.substr(eq+1).c_str());
+		f.print("\n");
+	}
+	f.close();
+}
+
+// the image the device runs, which delta updates are patched against
+void load_firmware(const char *fname) {
+	FILE *f = fopen(fname, "rb");
+	if(!f) { fprintf(stderr, "cannot open %s\n", fname); exit(1); }
+	int c;
+	while((c = fgetc(f)) != EOF) Sim::sketch.push_back((uint8_t)c);
+	fclose(f);
+}
+
+void usage() {
+	fprintf(stderr, "usage: og_sim [--trace file] [--duration s] [--step-us n] [--opt name=value]...\n"
+	                "              [--ap] [--serial] [--http] [--fs] [--epoch t] [--firmware image.bin]\n");
+	exit(2);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	std::vector<Event> events;
+	std::vector<std::string> opts;
+	double duration = 60;
+	uint64_t step_us = 1000;
+	bool ap_mode = false;
+	bool list_fs = false;
+	{
+		Sim::HeapPause p;
+		for(int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			auto next = [&]() -> const char * { if(i+1 >= argc) usage(); return argv[++i]; };
+			if(arg == "--trace") events = load_trace(next());
+			else if(arg == "--duration") duration = atof(next());
+			else if(arg == "--step-us") step_us = strtoull(next(), nullptr, 10);
+			else if(arg == "--opt") opts.push_back(next());
+			else if(arg == "--ap") ap_mode = true;
+			else if(arg == "--serial") Sim::verbose = true;
+			else if(arg == "--http") Sim::print_http = true;
+			else if(arg == "--fs") list_fs = true;
+			else if(arg == "--epoch") Sim::set_epoch((uint32_t)strtoul(next(), nullptr, 10));
+			else if(arg == "--firmware") load_firmware(next());
+			else usage();
+		}
+		if(!step_us) usage();
+		if(!ap_mode) {
+			// a device that has already been set up on the home network
+			opts.insert(opts.begin(), "ssid=HomeNet");
+			opts.insert(opts.begin(), "mod=" + std::to_string(OG_MOD_STA));
+		}
+	}
+	seed_config(opts);
+
+	// pins that idle high on the board
+	Sim::set_pin(PIN_BUTTON, HIGH);
+	Sim::set_pin(PIN_SWRX_DETECT, HIGH);
+
+	auto wall_start = std::chrono::steady_clock::now();
+	uint64_t end_us = (uint64_t)(duration * 1e6);
+	uint64_t iterations = 0;
+	size_t next_event = 0;
+	bool restarted = false;
+	try {
+		do_setup();
+		while(Sim::now_us() < end_us) {
+			while(next_event < events.size() && events[next_event].t*1e6 <= Sim::now_us()) {
+				Sim::HeapPause p; // trace bookkeeping is not firmware memory
+				apply(events[next_event++]);
+			}
+			Sim::poll_http_load();
+			do_loop();
+			iterations++;
+			Sim::advance_us(step_us);
+		}
+	} catch(const Sim::Restart &) {
+		restarted = true;
+	}
+	double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+	double simulated = Sim::now_us() / 1e6;
+	printf("\n== og_sim ==\n");
+	if(restarted) printf("device restarted at %.3fs, run stopped\n", simulated);
+	printf("iterations        %llu\n", (unsigned long long)iterations);
+	printf("simulated time    %.3f s\n", simulated);
+	printf("wall time         %.3f s\n", wall);
+	printf("iterations/sec    %.0f\n", wall > 0 ? iterations / wall : 0.0);
+	printf("speedup           %.0fx\n", wall > 0 ? simulated / wall : 0.0);
+	const Sim::Stats &s = Sim::stats;
+	printf("relay clicks      %llu\n", (unsigned long long)s.relay_clicks);
+	printf("buzzer tones      %llu\n", (unsigned long long)s.tone_calls);
+	printf("http requests     %llu (%llu response bytes, %llu connections)\n", (unsigned long long)s.http_requests,
+	       (unsigned long long)s.http_response_bytes, (unsigned long long)s.http_connections);
+	printf("mqtt publishes    %llu (%llu dropped)\n", (unsigned long long)s.mqtt_publishes, (unsigned long long)s.mqtt_dropped);
+	printf("notifications     %llu\n", (unsigned long long)s.notifications);
+	printf("fs writes         %llu (%llu bytes, %llu opens)\n", (unsigned long long)s.fs_writes, (unsigned long long)s.fs_bytes_written, (unsigned long long)s.fs_opens);
+	printf("fs reads          %llu (%llu bytes)\n", (unsigned long long)s.fs_reads, (unsigned long long)s.fs_bytes_read);
+	printf("fs page rewrites  %llu\n", (unsigned long long)s.fs_pages_rewritten);
+	printf("ota flash writes  %llu bytes (%llu upload bytes refused)\n", (unsigned long long)s.flash_bytes_written, (unsigned long long)s.upload_bytes_refused);
+	if(!Sim::ota_image.empty()) printf("ota image sha256  %s\n", Sim::ota_image.c_str());
+	printf("heap allocs/frees %llu / %llu\n", (unsigned long long)Sim::heap.allocs, (unsigned long long)Sim::heap.frees);
+	printf("heap live/peak    %lld / %lld bytes\n", (long long)Sim::heap.live, (long long)Sim::heap.peak);
+	if(list_fs) {
+		Dir dir = SPIFFS.openDir("/");
+		while(dir.next()) printf("fs  %-24s %u\n", dir.fileName().c_str(), (unsigned)dir.fileSize());
+	}
+	return 0;
+}
@@ -0,0 +1,1016 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: WiFi, clients, servers and cloud services
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <ESP8266WiFi.h>
+#include <ESP8266WebServer.h>
+#include <ESP8266HTTPClient.h>
+#include <ESP8266mDNS.h>
+#include <BlynkSimpleEsp8266.h>
+#include <PubSubClient.h>
+#include <OpenThingsFramework.h>
+#include <Updater.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include "sim.h"
+
+ESP8266WiFiClass WiFi;
+MDNSResponder MDNS;
+BlynkWifi Blynk;
+UpdaterClass Update;
+
+/* Scripted peers */
+
+namespace Sim {
+	/** maker.ifttt.com: answers the webhook POST once the whole body is in. */
+	class WebhookPeer : public Peer {
+	public:
+		void on_receive(const uint8_t *data, size_t len) override {
+			req.append((const char *)data, len);
+			size_t hdr = req.find("\r\n\r\n");
+			size_t cl = req.find("Content-Length: ");
+			if(hdr == std::string::npos || cl == std::string::npos) return;
+			if(req.size() < hdr + 4 + (size_t)atoi(req.c_str() + cl + 16)) return;
+			stats.notifications++;
+			if(verbose) printf("[ifttt] %s\n", req.c_str() + hdr + 4);
+			char reply[160];
+			snprintf(reply, sizeof(reply), "HTTP/1.1 %d %s\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\n"
+			         "Congratulations! You've fired the opengarage event", ifttt_status, ifttt_status == 200 ? "OK" : "Error");
+			send(reply, http_latency_ms);
+			close();
+		}
+	private:
+		std::string req;
+	};
+
+	class SmtpPeer : public Peer {
+	public:
+		explicit SmtpPeer(std::shared_ptr<const std::vector<std::string>> script) : script(script) {}
+		void on_connect() override { reply("220 smtp.sim ESMTP ready"); }
+		void on_receive(const uint8_t *data, size_t len) override {
+			buf.append((const char *)data, len);
+			size_t nl;
+			while(!closed && (nl = buf.find('\n')) != std::string::npos) {
+				std::string line = buf.substr(0, nl);
+				buf.erase(0, nl+1);
+				if(!line.empty() && line.back() == '\r') line.pop_back();
+				command(line);
+			}
+		}
+	private:
+		void command(const std::string &line) {
+			if(data) {
+				if(line != ".") return;
+				data = false;
+				stats.notifications++;
+				reply("250 OK queued");
+				return;
+			}
+			if(verbose) printf("[smtp] C: %s\n", line.c_str());
+			std::string cmd = line.substr(0, line.find(' '));
+			for(char &c : cmd) c = toupper(c);
+			if(auth) reply(--auth ? "334 UGFzc3dvcmQ6" : "235 Authentication successful");
+			else if(cmd == "HELO") reply("250 smtp.sim");
+			else if(cmd == "EHLO") reply("250-smtp.sim\r\n250-AUTH LOGIN PLAIN\r\n250 8BITMIME");
+			else if(line == "AUTH LOGIN") { auth = 2; reply("334 VXNlcm5hbWU6"); }
+			else if(cmd == "AUTH") reply("235 Authentication successful");
+			else if(cmd == "MAIL" || cmd == "RCPT") reply("250 OK");
+			else if(cmd == "DATA") { data = true; reply("354 End data with <CR><LF>.<CR><LF>"); }
+			else if(cmd == "QUIT") { reply("221 Bye"); close(); }
+			else reply("500 Unrecognized command");
+		}
+		// sends the next scripted reply, or 'def' without a script
+		void reply(const char *def) {
+			std::string r;
+			if(script->empty()) {
+				r = def;
+			} else {
+				if(hung || next >= script->size()) return;
+				const std::string &s = (*script)[next];
+				if(s == "@hang") { hung = true; return; }
+				if(s == "@close") { next++; close(); return; }
+				while(next < script->size()) {
+					const std::string &l = (*script)[next++];
+					r += r.empty() ? l : "\r\n" + l;
+					if(l.size() < 4 || l[3] != '-') break;
+				}
+			}
+			if(verbose) printf("[smtp] S: %s\n", r.c_str());
+			r += "\r\n";
+			send(r.data(), r.size(), http_latency_ms);
+		}
+		std::shared_ptr<const std::vector<std::string>> script;
+		std::string buf;
+		size_t next = 0;
+		int auth = 0;   // AUTH LOGIN prompts still to answer
+		bool data = false;
+		bool hung = false;
+	};
+
+	/** A local update mirror: GET of a file, whole or a byte range. */
+	class MirrorPeer : public Peer {
+	public:
+		MirrorPeer(const std::string &dir, std::shared_ptr<int> cut) : dir(dir), cut(cut) {}
+		void on_receive(const uint8_t *data, size_t len) override {
+			req.append((const char *)data, len);
+			if(closed || req.find("\r\n\r\n") == std::string::npos) return;
+			std::string path = req.substr(4, req.find(' ', 4) - 4);
+			if(verbose) printf("[mirror] GET %s %s\n", path.c_str(), range().c_str());
+			FILE *f = req.compare(0, 4, "GET ") || path.find("..") != std::string::npos ? nullptr : fopen((dir + path).c_str(), "rb");
+			if(!f) {
+				reply("404 Not Found", "", "not found");
+				return;
+			}
+			std::string body;
+			char buf[4096];
+			size_t n;
+			while((n = fread(buf, 1, sizeof(buf), f)) > 0) body.append(buf, n);
+			fclose(f);
+			unsigned long from, to;
+			if(sscanf(range().c_str(), "bytes=%lu-%lu", &from, &to) == 2) {
+				if(from > to || from >= body.size()) {
+					reply("416 Range Not Satisfiable", "", "");
+					return;
+				}
+				if(to >= body.size()) to = body.size()-1;
+				char cr[128];
+				snprintf(cr, sizeof(cr), "Content-Range: bytes %lu-%lu/%zu\r\n", from, to, body.size());
+				std::string part = body.substr(from, to-from+1);
+				if(*cut > 0) {
+					(*cut)--;
+					if(verbose) printf("[mirror] breaking off\n");
+					reply("206 Partial Content", cr, part, part.size()/2);
+				} else {
+					reply("206 Partial Content", cr, part);
+				}
+			} else {
+				reply("200 OK", "", body);
+			}
+		}
+	private:
+		std::string range() const {
+			size_t r = req.find("\r\nRange: ");
+			return r == std::string::npos ? "" : req.substr(r+9, req.find("\r\n", r+2) - r-9);
+		}
+		// sends the response, only the first part bytes of the body if not 0
+		void reply(const char *status, const char *headers, const std::string &body, size_t part = 0) {
+			std::string r = std::string("HTTP/1.1 ") + status + "\r\n" + headers +
+			                "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+			r.append(body, 0, part ? part : body.size());
+			send(r.data(), r.size(), http_latency_ms);
+			close();
+		}
+		std::string dir;
+		std::shared_ptr<int> cut;
+		std::string req;
+	};
+
+	/** The browser end of a request to an ESP8266WebServer. It only sees
+	 *  what the device writes to server.client() directly, e.g. an event
+	 *  stream the device keeps open after the handler returns. */
+	class BrowserPeer;
+	static void load_response_done(uint16_t port, BrowserPeer *keep);
+	static void load_peer_gone(BrowserPeer *peer);
+
+	class BrowserPeer : public Peer {
+	public:
+		explicit BrowserPeer(uint16_t port) : port(port) { all().push_back(this); }
+		~BrowserPeer() override {
+			load_peer_gone(this);
+			auto &v = all();
+			for(auto it = v.begin(); it != v.end(); ++it) if(*it == this) { v.erase(it); break; }
+		}
+		void on_receive(const uint8_t *data, size_t len) override {
+			stats.http_response_bytes += len;
+			if(print_http) printf("<<< :%u %.*s", port, (int)len, (const char *)data);
+			HeapPause p;
+			resp.append((const char *)data, len);
+			// a response with a Content-Length is complete once the body is in; event streams never are
+			size_t hdr = resp.find("\r\n\r\n");
+			if(hdr == std::string::npos) return;
+			size_t cl = resp.find("Content-Length: ");
+			if(cl == std::string::npos || cl > hdr) { resp.clear(); return; }
+			size_t end = hdr + 4 + (size_t)atoi(resp.c_str() + cl + 16);
+			if(resp.size() < end) return;
+			bool keep = resp.find("Connection: keep-alive") < hdr;
+			resp.erase(0, end);
+			if(print_http) printf("\n");
+			load_response_done(port, keep ? this : nullptr);
+		}
+		static std::vector<BrowserPeer *> &all() {
+			static std::vector<BrowserPeer *> *v = nullptr;
+			if(!v) { HeapPause p; v = new std::vector<BrowserPeer *>(); }
+			return *v;
+		}
+		const uint16_t port;
+	private:
+		std::string resp;
+	};
+
+	void hangup_http_clients(uint16_t port) {
+		for(BrowserPeer *b : BrowserPeer::all()) if(b->port == port) b->close();
+	}
+
+	static struct {
+		bool active = false;
+		bool waiting = false;   // request out, response not complete yet
+		uint16_t port;
+		std::string url;
+		int total, remaining;
+		uint64_t start_us, next_us;
+		uint64_t connections;
+		BrowserPeer *conn = nullptr; // kept alive by the device
+		int64_t heap_before;
+	} load;
+
+	void start_http_load(const char *url, int n) {
+		HeapPause p;
+		load.active = n > 0;
+		load.waiting = false;
+		load.port = 80;
+		if(url[0] == ':') load.port = (uint16_t)strtoul(url+1, (char **)&url, 10);
+		load.url = url;
+		load.total = load.remaining = n;
+		load.start_us = now_us();
+		load.next_us = now_us();
+		load.connections = 0;
+		load.conn = nullptr;
+		load.heap_before = heap.live;
+	}
+
+	void poll_http_load() {
+		if(!load.active || load.waiting || now_us() < load.next_us) return;
+		if(!load.remaining) {
+			double secs = (now_us() - load.start_us) / 1e6;
+			printf("load :%u%s: %d requests in %.3f s, %.1f requests/s, %llu connections, heap live %lld -> %lld bytes\n",
+			       load.port, load.url.c_str(), load.total, secs, secs > 0 ? load.total / secs : 0.0,
+			       (unsigned long long)load.connections, (long long)load.heap_before, (long long)heap.live);
+			load.active = false;
+			return;
+		}
+		load.remaining--;
+		load.waiting = true;
+		if(load.conn && !load.conn->closed) {
+			std::string req = "GET " + load.url + " HTTP/1.1\r\nHost: og\r\n\r\n";
+			stats.http_requests++;
+			if(print_http) printf(">>> GET :%u%s (kept alive)\n", load.port, load.url.c_str());
+			load.conn->send(req.data(), req.size());
+		} else {
+			load.conn = nullptr;
+			load.connections++;
+			queue_http_request("GET", (":" + std::to_string(load.port) + load.url).c_str());
+		}
+	}
+
+	static void load_response_done(uint16_t port, BrowserPeer *keep) {
+		if(!load.active || !load.waiting || port != load.port) return;
+		load.waiting = false;
+		load.conn = keep;
+		// the response travels back, the next request out; a new connection needs a handshake first
+		load.next_us = now_us() + (uint64_t)lan_rtt_ms * (keep ? 1000 : 2000);
+	}
+
+	static void load_peer_gone(BrowserPeer *peer) {
+		if(load.conn == peer) load.conn = nullptr;
+	}
+
+	void http_response_done(uint16_t port) { load_response_done(port, nullptr); }
+
+	void register_smtp_server(const char *host, uint16_t port, const std::vector<std::string> &script) {
+		HeapPause p;
+		auto shared = std::make_shared<const std::vector<std::string>>(script);
+		register_peer(host, port, [shared]() -> Peer * { return new SmtpPeer(shared); });
+	}
+
+	void register_http_mirror(const char *host, uint16_t port, const std::string &dir, int cut) {
+		HeapPause p;
+		auto shared = std::make_shared<int>(cut);
+		register_peer(host, port, [dir, shared]() -> Peer * { return new MirrorPeer(dir, shared); });
+	}
+
+	static std::map<std::string, peer_factory_t> &peers() {
+		static std::map<std::string, peer_factory_t> *m = nullptr;
+		if(!m) {
+			HeapPause p;
+			m = new std::map<std::string, peer_factory_t>();
+			(*m)["maker.ifttt.com:80"] = []() -> Peer * { return ifttt_status ? new WebhookPeer() : nullptr; };
+		}
+		return *m;
+	}
+
+	static std::string peer_key(const char *host, uint16_t port) {
+		return std::string(host) + ":" + std::to_string(port);
+	}
+
+	void register_peer(const char *host, uint16_t port, peer_factory_t factory) {
+		HeapPause p;
+		peers()[peer_key(host, port)] = factory;
+	}
+
+	Peer *connect_peer(const char *host, uint16_t port) {
+		HeapPause p;
+		auto it = peers().find(peer_key(host, port));
+		return it == peers().end() ? nullptr : it->second();
+	}
+
+	void Peer::send(const char *data, size_t len, uint32_t delay_ms) {
+		HeapPause p;
+		pending.push_back(Chunk{now_us() + (uint64_t)delay_ms*1000, 0, std::vector<char>(data, data+len)});
+	}
+
+	void Peer::send(const char *data, uint32_t delay_ms) { send(data, strlen(data), delay_ms); }
+
+	size_t Peer::available() const {
+		size_t n = 0;
+		for(const Chunk &c : pending) {
+			if(c.ready_us > now_us()) break;
+			n += c.bytes.size() - c.pos;
+		}
+		return n;
+	}
+
+	int Peer::read() {
+		if(!available()) return -1;
+		Chunk &c = pending.front();
+		int ch = (uint8_t)c.bytes[c.pos++];
+		if(c.pos == c.bytes.size()) { HeapPause p; pending.pop_front(); }
+		return ch;
+	}
+
+	int Peer::peek() const {
+		if(!available()) return -1;
+		const Chunk &c = pending.front();
+		return (uint8_t)c.bytes[c.pos];
+	}
+
+	/* Injected HTTP requests and MQTT messages */
+
+	struct QueuedRequest { uint16_t port; HttpRequest req; };
+	static std::deque<QueuedRequest> &http_queue() {
+		static std::deque<QueuedRequest> *q = nullptr;
+		if(!q) { HeapPause p; q = new std::deque<QueuedRequest>(); }
+		return *q;
+	}
+
+	static void queue(const char *method, const char *url, const char *headers, const char *filename, const std::vector<uint8_t> &body) {
+		HeapPause p;
+		QueuedRequest q;
+		q.port = 80;
+		if(url[0] == ':') {
+			q.port = (uint16_t)strtoul(url+1, (char **)&url, 10);
+		}
+		q.req.method = method;
+		q.req.url = url;
+		q.req.headers = headers ? headers : "";
+		q.req.filename = filename ? filename : "";
+		q.req.body = body;
+		http_queue().push_back(q);
+	}
+
+	void queue_http_request(const char *method, const char *url, const char *headers) {
+		queue(method, url, headers, nullptr, std::vector<uint8_t>());
+	}
+
+	void queue_http_upload(const char *url, const char *filename, const std::vector<uint8_t> &body, const char *fields) {
+		queue("POST", url, "", filename, body);
+		http_queue().back().req.fields = fields;
+	}
+
+	bool take_http_request(uint16_t port, HttpRequest &req) {
+		HeapPause p;
+		auto &q = http_queue();
+		for(auto it = q.begin(); it != q.end(); ++it) {
+			if(it->port != port) continue;
+			req = it->req;
+			q.erase(it);
+			return true;
+		}
+		return false;
+	}
+
+	struct MqttMessage { std::string topic; std::string payload; };
+	static std::deque<MqttMessage> &mqtt_queue() {
+		static std::deque<MqttMessage> *q = nullptr;
+		if(!q) { HeapPause p; q = new std::deque<MqttMessage>(); }
+		return *q;
+	}
+
+	void queue_mqtt_message(const char *topic, const char *payload) {
+		HeapPause p;
+		mqtt_queue().push_back(MqttMessage{topic, payload});
+	}
+
+	static bool take_mqtt_message(MqttMessage &msg) {
+		HeapPause p;
+		if(mqtt_queue().empty()) return false;
+		msg = mqtt_queue().front();
+		mqtt_queue().pop_front();
+		return true;
+	}
+}
+
+/* WiFiClient */
+
+int WiFiClient::connect(const char *host, uint16_t port) {
+	stop();
+	if(!Sim::wifi_connected) return 0;
+	_peer = Sim::connect_peer(host, port);
+	if(!_peer) {
+		delay(Sim::http_latency_ms);
+		return 0;
+	}
+	_peer->refs = 1;
+	_peer->on_connect();
+	return 1;
+}
+
+WiFiClient &WiFiClient::operator =(const WiFiClient &other) {
+	if(other._peer) other._peer->refs++;
+	stop();
+	_peer = other._peer;
+	return *this;
+}
+
+uint8_t WiFiClient::connected() {
+	return _peer && (!_peer->closed || _peer->draining());
+}
+
+void WiFiClient::stop() {
+	if(_peer) {
+		Sim::HeapPause p;
+		if(--_peer->refs <= 0) delete _peer;
+		_peer = nullptr;
+	}
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size) {
+	if(!_peer || _peer->closed) return 0;
+	_peer->on_receive(buf, size);
+	return size;
+}
+
+int WiFiClient::available() { return _peer ? (int)_peer->available() : 0; }
+int WiFiClient::read() { return _peer ? _peer->read() : -1; }
+int WiFiClient::peek() { return _peer ? _peer->peek() : -1; }
+
+int WiFiClient::read(uint8_t *buf, size_t size) {
+	size_t n = 0;
+	int c;
+	while(n < size && (c = read()) >= 0) buf[n++] = (uint8_t)c;
+	return (int)n;
+}
+
+/* HTTPClient: only used for IFTTT webhooks */
+
+int HTTPClient::request() {
+	if(!Sim::wifi_connected) return HTTPC_ERROR_CONNECTION_FAILED;
+	delay(Sim::http_latency_ms);
+	_payload = F("Congratulations! You've fired the opengarage event");
+	if(Sim::verbose) printf("[http] %s\n", _url.c_str());
+	return HTTP_CODE_OK;
+}
+
+/* PubSubClient */
+
+PubSubClient &PubSubClient::setServer(const char *domain, uint16_t port) {
+	(void)domain; (void)port;
+	return *this;
+}
+
+bool PubSubClient::connect(const char *id) { return connect(id, nullptr, nullptr, nullptr, 0, false, nullptr); }
+
+bool PubSubClient::connect(const char *id, const char *willTopic, uint8_t willQos, bool willRetain, const char *willMessage) {
+	return connect(id, nullptr, nullptr, willTopic, willQos, willRetain, willMessage);
+}
+
+bool PubSubClient::connect(const char *id, const char *user, const char *pass, const char *willTopic, uint8_t willQos, bool willRetain, const char *willMessage) {
+	(void)id; (void)user; (void)pass; (void)willTopic; (void)willQos; (void)willRetain; (void)willMessage;
+	_nsubs = 0;
+	if(!Sim::wifi_connected || !Sim::mqtt_available) {
+		delay(Sim::http_latency_ms); // connect timeout
+		return false;
+	}
+	_connected = true;
+	return true;
+}
+
+bool PubSubClient::connected() {
+	if(_connected && !(Sim::wifi_connected && Sim::mqtt_available)) _connected = false;
+	return _connected;
+}
+
+bool PubSubClient::subscribe(const char *topic, uint8_t qos) {
+	(void)qos;
+	if(!connected() || _nsubs >= sizeof(_subs)/sizeof(_subs[0])) return false;
+	_subs[_nsubs++] = topic;
+	return true;
+}
+
+bool PubSubClient::matches(const char *topic) const {
+	for(uint8_t i = 0; i < _nsubs; i++) {
+		const String &s = _subs[i];
+		if(s.endsWith("#")) {
+			if(strncmp(topic, s.c_str(), s.length()-1) == 0) return true;
+		} else if(s == topic) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool PubSubClient::loop() {
+	if(!connected()) return false;
+	Sim::MqttMessage msg;
+	while(Sim::take_mqtt_message(msg)) {
+		if(!matches(msg.topic.c_str()) || !_callback) continue;
+		size_t tlen = msg.topic.size();
+		size_t plen = msg.payload.size();
+		if(MQTT_MAX_HEADER_SIZE + 2 + tlen + 1 + plen >= _bufsize) { Sim::stats.mqtt_dropped++; continue; }
+		// topic and payload share the packet buffer, like the real client
+		char *topic = (char *)_buffer;
+		memcpy(topic, msg.topic.c_str(), tlen+1);
+		uint8_t *payload = _buffer + tlen + 1;
+		memcpy(payload, msg.payload.data(), plen);
+		_callback(topic, payload, (unsigned int)plen);
+	}
+	return true;
+}
+
+bool PubSubClient::publish(const char *topic, const char *payload, bool retained) {
+	return publish(topic, (const uint8_t *)payload, payload ? strlen(payload) : 0, retained);
+}
+
+bool PubSubClient::publish(const char *topic, const uint8_t *payload, unsigned int plength, bool retained) {
+	if(!connected()) return false;
+	if(MQTT_MAX_HEADER_SIZE + 2 + strlen(topic) + plength > _bufsize) {
+		Sim::stats.mqtt_dropped++;
+		if(Sim::verbose) printf("[mqtt] dropped %s (%u bytes)\n", topic, plength);
+		return false;
+	}
+	Sim::stats.mqtt_publishes++;
+	if(Sim::verbose) printf("[mqtt] %s%s %.*s\n", topic, retained ? " (retained)" : "", (int)plength, (const char *)payload);
+	return true;
+}
+
+/* Updater */
+
+bool UpdaterClass::begin(size_t size, int command, int ledPin, uint8_t ledOn) {
+	(void)command; (void)ledPin; (void)ledOn;
+	if(_running) { _error = UPDATE_ERROR_SPACE; return false; }
+	if(size == 0 || size > ESP.getFreeSketchSpace()) { _error = UPDATE_ERROR_SIZE; return false; }
+	_size = size;
+	_progress = 0;
+	_running = true;
+	_finished = false;
+	_error = UPDATE_ERROR_OK;
+	br_sha256_init(&_sha);
+	return true;
+}
+
+size_t UpdaterClass::write(uint8_t *data, size_t len) {
+	if(!_running || hasError()) return 0;
+	if(!_progress && len && data[0] != 0xE9 && data[0] != 0x1F) { _error = UPDATE_ERROR_MAGIC_BYTE; return 0; } // not an image, nor a gzipped one
+	if(_progress + len > _size) { _error = UPDATE_ERROR_SPACE; return 0; }
+	_progress += len;
+	br_sha256_update(&_sha, data, len);
+	Sim::stats.flash_bytes_written += len;
+	delay(len / 64); // flash erase/write time, roughly 64KB/s
+	return len;
+}
+
+bool UpdaterClass::end(bool evenIfRemaining) {
+	if(!_running) return false;
+	_running = false;
+	if(hasError() || (!evenIfRemaining && _progress != _size)) {
+		if(!hasError()) _error = UPDATE_ERROR_SIZE;
+		return false;
+	}
+	_size = _progress;
+	_finished = _progress > 0;
+	if(_finished) {
+		uint8_t digest[br_sha256_SIZE];
+		char hex[2*br_sha256_SIZE+1];
+		br_sha256_out(&_sha, digest);
+		for(int i = 0; i < br_sha256_SIZE; i++) sprintf(hex+2*i, "%02x", digest[i]);
+		Sim::HeapPause p;
+		Sim::ota_image = hex;
+	}
+	return _finished;
+}
+
+/* HTTP request parsing shared by both servers */
+
+static int hexval(char c) {
+	if(c >= '0' && c <= '9') return c - '0';
+	if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+// decodes %xx and '+' in place
+static void url_decode(char *s) {
+	char *o = s;
+	for(; *s; s++) {
+		if(*s == '+') *o++ = ' ';
+		else if(*s == '%' && hexval(s[1]) >= 0 && hexval(s[2]) >= 0) { *o++ = (char)(hexval(s[1])*16 + hexval(s[2])); s += 2; }
+		else *o++ = *s;
+	}
+	*o = 0;
+}
+
+// wall clock of the host, for timing handlers (the virtual clock stands still while they run)
+static uint64_t host_ns() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void print_request(uint16_t port, const Sim::HttpRequest &req) {
+	if(Sim::print_http) printf(">>> %s :%u%s\n", req.method.c_str(), port, req.url.c_str());
+}
+
+static void print_response(const char *data, size_t len) {
+	if(!Sim::print_http) return;
+	const char *body = strstr(data, "\r\n\r\n");
+	const char *enc = strstr(data, "Content-Encoding:");
+	const char *bin = strstr(data, "application/octet-stream");
+	bool binary = (enc && enc < body) || (bin && bin < body);
+	if(binary && body) {
+		fwrite(data, 1, body - data, stdout);
+		printf("\n<%zu bytes encoded body>\n", len - (body + 4 - data));
+	} else {
+		fwrite(data, 1, len, stdout);
+		printf("\n");
+	}
+}
+
+/* OpenThingsFramework */
+
+namespace OTF {
+
+char *Request::getQueryParameter(const char *key) const {
+	for(uint8_t i = 0; i < _nquery; i++) {
+		if(strcmp(_query[i].key, key) == 0) return _query[i].value;
+	}
+	return nullptr;
+}
+
+char *Request::getHeader(const char *key) const {
+	for(uint8_t i = 0; i < _nheaders; i++) {
+		if(strcasecmp(_headers[i].key, key) == 0) return _headers[i].value;
+	}
+	return nullptr;
+}
+
+void Response::append(const char *data, size_t length) {
+	if(!_valid) return;
+	if(_len + length >= MAX_RESPONSE_LENGTH) { _valid = false; return; }
+	memcpy(_buf + _len, data, length);
+	_len += length;
+	_buf[_len] = 0;
+	if(!_firstSegmentNs && _len >= SEGMENT_LENGTH) _firstSegmentNs = host_ns();
+}
+
+void Response::beginBody() {
+	if(_bodyStarted) return;
+	_bodyStarted = true;
+	append("\r\n", 2);
+}
+
+void Response::writeStatus(uint16_t statusCode, const String &statusMessage) {
+	writeStatus(statusCode, (const __FlashStringHelper *)statusMessage.c_str());
+}
+
+void Response::writeStatus(uint16_t statusCode, const __FlashStringHelper *statusMessage) {
+	char line[64];
+	_status = statusCode;
+	int n = snprintf(line, sizeof(line), "HTTP/1.1 %u %s\r\n", statusCode, (const char *)statusMessage);
+	append(line, n);
+}
+
+void Response::writeHeader(const __FlashStringHelper *name, const char *value) {
+	append((const char *)name, strlen((const char *)name));
+	append(": ", 2);
+	append(value, strlen(value));
+	append("\r\n", 2);
+}
+
+void Response::writeHeader(const __FlashStringHelper *name, const __FlashStringHelper *value) { writeHeader(name, (const char *)value); }
+void Response::writeHeader(const __FlashStringHelper *name, const String &value) { writeHeader(name, value.c_str()); }
+void Response::writeHeader(const __FlashStringHelper *name, int value) { writeHeader(name, (long)value); }
+void Response::writeHeader(const __FlashStringHelper *name, unsigned int value) { writeHeader(name, (unsigned long)value); }
+
+void Response::writeHeader(const __FlashStringHelper *name, long value) {
+	char buf[24];
+	snprintf(buf, sizeof(buf), "%ld", value);
+	writeHeader(name, buf);
+}
+
+void Response::writeHeader(const __FlashStringHelper *name, unsigned long value) {
+	char buf[24];
+	snprintf(buf, sizeof(buf), "%lu", value);
+	writeHeader(name, buf);
+}
+
+void Response::writeBodyData(const char *data, size_t length) {
+	beginBody();
+	append(data, length);
+}
+
+size_t Response::write(const uint8_t *buffer, size_t size) {
+	writeBodyData((const char *)buffer, size);
+	return _valid ? size : 0;
+}
+
+size_t Response::bprintf(const char *format, ...) {
+	char buf[1024];
+	va_list ap;
+	va_start(ap, format);
+	int n = vsnprintf(buf, sizeof(buf), format, ap);
+	va_end(ap);
+	if(n < 0) return 0;
+	if((size_t)n >= sizeof(buf)) { _valid = false; return 0; }
+	append(buf, n);
+	return n;
+}
+
+size_t Response::bprintf(const __FlashStringHelper *format, ...) {
+	char buf[1024];
+	va_list ap;
+	va_start(ap, format);
+	int n = vsnprintf(buf, sizeof(buf), (const char *)format, ap);
+	va_end(ap);
+	if(n < 0) return 0;
+	if((size_t)n >= sizeof(buf)) { _valid = false; return 0; }
+	append(buf, n);
+	return n;
+}
+
+OpenThingsFramework::OpenThingsFramework(uint16_t webServerPort, Print *hwSerial)
+	: _missing(nullptr), _port(webServerPort), _cloud(false) { (void)hwSerial; }
+
+OpenThingsFramework::OpenThingsFramework(uint16_t webServerPort, const String &webSocketHost, uint16_t webSocketPort,
+                                         const String &deviceKey, bool useSsl, Print *hwSerial)
+	: _missing(nullptr), _port(webServerPort), _cloud(true) {
+	(void)webSocketHost; (void)webSocketPort; (void)deviceKey; (void)useSsl; (void)hwSerial;
+}
+
+void OpenThingsFramework::on(const char *path, callback_t callback, HTTPMethod method) {
+	Sim::HeapPause p;
+	_routes.push_back(Route{String(path), callback, method});
+}
+
+void OpenThingsFramework::loop() {
+	Sim::HttpRequest hr;
+	if(!Sim::take_http_request(_port, hr)) return;
+	Sim::stats.http_requests++;
+	Sim::stats.http_connections++; // the library closes every connection after one request
+	print_request(_port, hr);
+
+	// both objects live in static storage, like the library's single request buffer
+	static Request req;
+	static Response res;
+	req = Request();
+	res._len = 0; res._valid = true; res._status = 0; res._bodyStarted = false; res._buf[0] = 0; res._firstSegmentNs = 0;
+
+	req._method = hr.method == "POST" ? HTTP_POST : hr.method == "PUT" ? HTTP_PUT :
+	              hr.method == "DELETE" ? HTTP_DELETE : hr.method == "OPTIONS" ? HTTP_OPTIONS : HTTP_GET;
+	snprintf(req._buf, sizeof(req._buf), "%s%c%s", hr.url.c_str(), 0, hr.headers.c_str());
+	char *hdrs = req._buf + strlen(req._buf) + 1;
+	req._path = req._buf;
+	char *q = strchr(req._buf, '?');
+	if(q) {
+		*q++ = 0;
+		while(q && *q && req._nquery < Request::MAX_PAIRS) {
+			char *next = strchr(q, '&');
+			if(next) *next++ = 0;
+			char *eq = strchr(q, '=');
+			if(eq) *eq++ = 0;
+			url_decode(q);
+			if(eq) url_decode(eq);
+			req._query[req._nquery++] = Request::Pair{q, eq ? eq : q + strlen(q)};
+			q = next;
+		}
+	}
+	url_decode(req._path);
+	while(hdrs && *hdrs && req._nheaders < Request::MAX_PAIRS) {
+		char *next = strchr(hdrs, '\n');
+		if(next) *next++ = 0;
+		char *colon = strchr(hdrs, ':');
+		if(colon) {
+			*colon++ = 0;
+			while(*colon == ' ') colon++;
+			req._headers[req._nheaders++] = Request::Pair{hdrs, colon};
+		}
+		hdrs = next;
+	}
+
+	callback_t cb = _missing;
+	for(const Route &r : _routes) {
+		if(r.path == req._path && (r.method == HTTP_ANY || r.method == req._method)) { cb = r.cb; break; }
+	}
+	int64_t heap_start = Sim::heap.live;
+	uint64_t allocs_start = Sim::heap.allocs;
+	Sim::heap_reset_peak();
+	uint64_t start_ns = host_ns();
+	if(cb) {
+		cb(req, res);
+	} else {
+		res.writeStatus(404, F("Not found"));
+		res.writeHeader(F("Content-Length"), 0);
+		res.writeBodyData("", 0);
+	}
+	if(!res._valid) {
+		if(Sim::print_http) printf("<response overflowed %u bytes>\n", (unsigned)Response::MAX_RESPONSE_LENGTH);
+		return;
+	}
+	uint64_t end_ns = host_ns();
+	Sim::stats.http_response_bytes += res._len;
+	print_response(res._buf, res._len);
+	Sim::http_response_done(_port);
+	if(Sim::print_http) {
+		printf("--- %u bytes, first segment after %.1f us, done after %.1f us, heap peak +%lld bytes, %llu allocs\n",
+		       (unsigned)res._len, ((res._firstSegmentNs ? res._firstSegmentNs : end_ns) - start_ns) / 1e3,
+		       (end_ns - start_ns) / 1e3, (long long)(Sim::heap.peak - heap_start),
+		       (unsigned long long)(Sim::heap.allocs - allocs_start));
+	}
+}
+
+} // namespace OTF
+
+/* ESP8266WebServer */
+
+ESP8266WebServer::ESP8266WebServer(int port) : _port(port), _started(false), _method(HTTP_GET) {}
+ESP8266WebServer::~ESP8266WebServer() {}
+
+void ESP8266WebServer::on(const String &uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn) {
+	Sim::HeapPause p;
+	_routes.push_back(Route{uri, method, fn, ufn});
+}
+
+const ESP8266WebServer::Route *ESP8266WebServer::find(const String &uri, HTTPMethod method) const {
+	for(const Route &r : _routes) {
+		if(r.uri == uri && (r.method == HTTP_ANY || r.method == method)) return &r;
+	}
+	return nullptr;
+}
+
+bool ESP8266WebServer::hasArg(const String &name) const {
+	for(const Arg &a : _args) if(a.key == name) return true;
+	return false;
+}
+
+String ESP8266WebServer::arg(const String &name) const {
+	for(const Arg &a : _args) if(a.key == name) return a.value;
+	return String();
+}
+
+String ESP8266WebServer::header(const String &name) const {
+	for(const Arg &h : _requestHeaders) if(h.key.equalsIgnoreCase(name)) return h.value;
+	return String();
+}
+
+bool ESP8266WebServer::hasHeader(const String &name) const {
+	for(const Arg &h : _requestHeaders) if(h.key.equalsIgnoreCase(name)) return true;
+	return false;
+}
+
+void ESP8266WebServer::sendHeader(const String &name, const String &value, bool first) {
+	String line = name + ": " + value + "\r\n";
+	if(first) _headers = line + _headers;
+	else _headers += line;
+}
+
+void ESP8266WebServer::send(int code, const char *content_type, const char *content, size_t contentLength) {
+	Sim::HeapPause p; // the core writes straight to the socket
+	std::string out = "HTTP/1.1 " + std::to_string(code) + "\r\n";
+	if(content_type) out += std::string("Content-Type: ") + content_type + "\r\n";
+	out += _headers.c_str();
+	out += "Content-Length: " + std::to_string(contentLength) + "\r\n\r\n";
+	out.append(content, contentLength);
+	_headers = "";
+	Sim::stats.http_response_bytes += out.size();
+	print_response(out.c_str(), out.size());
+	Sim::http_response_done(_port);
+}
+
+void ESP8266WebServer::send(int code, const char *content_type, const String &content) {
+	send(code, content_type, content.c_str(), content.length());
+}
+
+/* The core reads the whole request, upload included, inside one
+ * handleClient() call; the body arrives at roughly 50KB/s over WiFi. */
+void ESP8266WebServer::handleClient() {
+	if(!_started) return;
+	Sim::HttpRequest hr;
+	if(!Sim::take_http_request(_port, hr)) return;
+	Sim::stats.http_requests++;
+	Sim::stats.http_connections++;
+	print_request(_port, hr);
+	{
+		Sim::HeapPause p;
+		_client._peer = new Sim::BrowserPeer(_port);
+		_client._peer->refs = 1;
+	}
+	dispatch(hr);
+	_client.stop(); // the connection stays up if the handler kept a copy
+}
+
+void ESP8266WebServer::dispatch(const Sim::HttpRequest &hr) {
+	_requestHeaders.clear();
+	size_t start = 0;
+	while(start < hr.headers.size()) {
+		size_t end = hr.headers.find('\n', start);
+		if(end == std::string::npos) end = hr.headers.size();
+		std::string line = hr.headers.substr(start, end-start);
+		size_t colon = line.find(':');
+		if(colon != std::string::npos) {
+			size_t v = line.find_first_not_of(' ', colon+1);
+			_requestHeaders.push_back(Arg{String(line.substr(0, colon).c_str()), String(v == std::string::npos ? "" : line.substr(v).c_str())});
+		}
+		start = end + 1;
+	}
+
+	_method = hr.method == "POST" ? HTTP_POST : hr.method == "OPTIONS" ? HTTP_OPTIONS : HTTP_GET;
+	_args.clear();
+	auto add_args = [this](const std::string &q) {
+		size_t start = 0;
+		while(start <= q.size()) {
+			size_t end = q.find('&', start);
+			if(end == std::string::npos) end = q.size();
+			std::string kv = q.substr(start, end-start);
+			size_t eq = kv.find('=');
+			std::string k = kv.substr(0, eq), v = eq == std::string::npos ? "" : kv.substr(eq+1);
+			std::vector<char> kb(k.begin(), k.end()), vb(v.begin(), v.end());
+			kb.push_back(0); vb.push_back(0);
+			url_decode(kb.data()); url_decode(vb.data());
+			if(!k.empty()) _args.push_back(Arg{String(kb.data()), String(vb.data())});
+			start = end + 1;
+		}
+	};
+	// the core keeps form fields read before the file part (_postArgs) and looks them up first
+	if(!hr.fields.empty()) add_args(hr.fields);
+	std::string url = hr.url;
+	size_t qpos = url.find('?');
+	_uri = url.substr(0, qpos).c_str();
+	if(qpos != std::string::npos) add_args(url.substr(qpos+1));
+
+	const Route *r = find(_uri, _method);
+	if(!r) {
+		if(_notFound) _notFound();
+		else send(404, "text/plain", "Not found");
+		return;
+	}
+	if(r->ufn && !hr.filename.empty()) {
+		_upload.filename = hr.filename.c_str();
+		_upload.name = "update";
+		_upload.type = "application/octet-stream";
+		_upload.totalSize = 0;
+		_upload.currentSize = 0;
+		_upload.contentLength = hr.body.size();
+		_upload.status = UPLOAD_FILE_START;
+		r->ufn();
+		size_t pos = 0;
+		while(pos < hr.body.size()) {
+			if(!_client.connected()) {  // the handler hung up, the core stops reading
+				Sim::stats.upload_bytes_refused += hr.body.size() - pos;
+				_upload.status = UPLOAD_FILE_ABORTED;
+				r->ufn();
+				return;
+			}
+			size_t n = hr.body.size() - pos;
+			if(n > HTTP_UPLOAD_BUFLEN) n = HTTP_UPLOAD_BUFLEN;
+			delay(n / 50);
+			memcpy(_upload.buf, &hr.body[pos], n);
+			_upload.currentSize = n;
+			_upload.totalSize += n;
+			_upload.status = UPLOAD_FILE_WRITE;
+			r->ufn();
+			pos += n;
+		}
+		_upload.currentSize = 0;
+		_upload.status = UPLOAD_FILE_END;
+		r->ufn();
+	}
+	r->fn();
+}
@@ -0,0 +1,298 @@
+/* OpenGarage Firmware
+ *
+ * Host simulator: Arduino String implementation
+ * Oct 2026 @ OpenGarage.io
+ *
+ * This file is part of the OpenGarage library
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "sim.h"
+
+static void format_number(char *out, unsigned long long v, bool neg, unsigned char base) {
+	char tmp[72];
+	int i = 0;
+	if(base < 2) base = 10;
+	do {
+		unsigned d = v % base;
+		tmp[i++] = d < 10 ? '0'+d : 'a'+d-10;
+		v /= base;
+	} while(v);
+	if(neg) tmp[i++] = '-';
+	int j = 0;
+	while(i) out[j++] = tmp[--i];
+	out[j] = 0;
+}
+
+static void format_float(char *out, size_t size, double v, unsigned char decimals) {
+	if(isnan(v)) { snprintf(out, size, "nan"); return; }
+	if(isinf(v)) { snprintf(out, size, "inf"); return; }
+	snprintf(out, size, "%.*f", decimals, v);
+}
+
+void String::init() {
+	heap = nullptr;
+	cap = SSOSIZE-1;
+	len = 0;
+	sso[0] = 0;
+}
+
+void String::invalidate() {
+	if(heap) {
+		free(heap);
+		Sim::heap_note(-(int64_t)(cap+1), 0, 1);
+	}
+	init();
+}
+
+bool String::changeBuffer(unsigned int maxStrLen) {
+	if(maxStrLen < SSOSIZE) {
+		if(heap) { // shrink back into the object
+			memcpy(sso, heap, len < SSOSIZE-1 ? len+1 : (unsigned int)SSOSIZE);
+			sso[SSOSIZE-1] = 0;
+			free(heap);
+			Sim::heap_note(-(int64_t)(cap+1), 0, 1);
+			heap = nullptr;
+			cap = SSOSIZE-1;
+		}
+		return true;
+	}
+	unsigned int newCap = ((maxStrLen + 16) & ~0xf) - 1;
+	char *nb = (char *)realloc(heap, newCap+1);
+	if(!nb) return false;
+	if(!heap) {
+		memcpy(nb, sso, len+1);
+		Sim::heap_note(newCap+1, 1, 0);
+	} else {
+		Sim::heap_note((int64_t)newCap - (int64_t)cap, 1, 1); // a growing realloc usually moves
+	}
+	heap = nb;
+	cap = newCap;
+	return true;
+}
+
+bool String::reserve(unsigned int size) {
+	if(cap >= size) return true;
+	return changeBuffer(size);
+}
+
+String &String::copy(const char *cstr, unsigned int length) {
+	if(!reserve(length)) { invalidate(); return *this; }
+	char *b = wbuf();
+	memmove(b, cstr, length);
+	b[length] = 0;
+	len = length;
+	return *this;
+}
+
+void String::move(String &rhs) {
+	invalidate();
+	if(rhs.heap) {
+		heap = rhs.heap;
+		cap = rhs.cap;
+		len = rhs.len;
+		rhs.init();
+	} else {
+		memcpy(sso, rhs.sso, SSOSIZE);
+		len = rhs.len;
+		rhs.len = 0;
+		rhs.sso[0] = 0;
+	}
+}
+
+String::String(const char *cstr) { init(); if(cstr) copy(cstr, strlen(cstr)); }
+String::String(const String &str) { init(); copy(str.c_str(), str.len); }
+String::String(String &&rval) noexcept { init(); move(rval); }
+String::String(const __FlashStringHelper *str) { init(); if(str) copy((const char *)str, strlen((const char *)str)); }
+String::String(char c) { init(); char b[2] = {c, 0}; copy(b, 1); }
+String::String(unsigned char value, unsigned char base) { init(); char b[72]; format_number(b, value, false, base); copy(b, strlen(b)); }
+String::String(int value, unsigned char base) { init(); char b[72]; format_number(b, value<0 && base==10 ? -(long long)value : (unsigned)value, value<0 && base==10, base); copy(b, strlen(b)); }
+String::String(unsigned int value, unsigned char base) { init(); char b[72]; format_number(b, value, false, base); copy(b, strlen(b)); }
+String::String(long value, unsigned char base) { init(); char b[72]; format_number(b, value<0 && base==10 ? -(long long)value : (unsigned long)value, value<0 && base==10, base); copy(b, strlen(b)); }
+String::String(unsigned long value, unsigned char base) { init(); char b[72]; format_number(b, value, false, base); copy(b, strlen(b)); }
+String::String(long long value, unsigned char base) { init(); char b[72]; format_number(b, value<0 && base==10 ? -(unsigned long long)value : (unsigned long long)value, value<0 && base==10, base); copy(b, strlen(b)); }
+String::String(unsigned long long value, unsigned char base) { init(); char b[72]; format_number(b, value, false, base); copy(b, strlen(b)); }
+String::String(float value, unsigned char decimalPlaces) { init(); char b[64]; format_float(b, sizeof(b), value, decimalPlaces); copy(b, strlen(b)); }
+String::String(double value, unsigned char decimalPlaces) { init(); char b[64]; format_float(b, sizeof(b), value, decimalPlaces); copy(b, strlen(b)); }
+String::~String() { invalidate(); }
+
+String &String::operator =(const String &rhs) { if(this != &rhs) copy(rhs.c_str(), rhs.len); return *this; }
+String &String::operator =(String &&rval) noexcept { if(this != &rval) move(rval); return *this; }
+String &String::operator =(const char *cstr) { if(cstr) copy(cstr, strlen(cstr)); else { len = 0; wbuf()[0] = 0; } return *this; }
+String &String::operator =(const __FlashStringHelper *str) { return operator=((const char *)str); }
+String &String::operator =(char c) { char b[2] = {c, 0}; return copy(b, 1); }
+
+bool String::concat(const char *cstr, unsigned int length) {
+	if(!cstr) return false;
+	if(length == 0) return true;
+	unsigned int newlen = len + length;
+	if(cstr >= buf() && cstr < buf() + len) { // appending part of ourselves
+		unsigned int offset = cstr - buf();
+		if(!reserve(newlen)) return false;
+		memmove(wbuf() + len, buf() + offset, length);
+	} else {
+		if(!reserve(newlen)) return false;
+		memmove(wbuf() + len, cstr, length);
+	}
+	len = newlen;
+	wbuf()[len] = 0;
+	return true;
+}
+
+bool String::concat(const char *cstr) { return cstr ? concat(cstr, strlen(cstr)) : false; }
+bool String::concat(const __FlashStringHelper *str) { return concat((const char *)str); }
+bool String::concat(char c) { return concat(&c, 1); }
+bool String::concatNumber(const char *digits) { return concat(digits, strlen(digits)); }
+bool String::concat(unsigned char num) { char b[8]; format_number(b, num, false, 10); return concatNumber(b); }
+bool String::concat(int num) { char b[24]; format_number(b, num<0 ? -(long long)num : num, num<0, 10); return concatNumber(b); }
+bool String::concat(unsigned int num) { char b[24]; format_number(b, num, false, 10); return concatNumber(b); }
+bool String::concat(long num) { char b[24]; format_number(b, num<0 ? -(unsigned long long)num : num, num<0, 10); return concatNumber(b); }
+bool String::concat(unsigned long num) { char b[24]; format_number(b, num, false, 10); return concatNumber(b); }
+bool String::concat(long long num) { char b[24]; format_number(b, num<0 ? -(unsigned long long)num : num, num<0, 10); return concatNumber(b); }
+bool String::concat(unsigned long long num) { char b[24]; format_number(b, num, false, 10); return concatNumber(b); }
+bool String::concat(float num) { char b[64]; format_float(b, sizeof(b), num, 2); return concatNumber(b); }
+bool String::concat(double num) { char b[64]; format_float(b, sizeof(b), num, 2); return concatNumber(b); }
+
+int String::compareTo(const String &s) const { return strcmp(buf(), s.buf()); }
+
+bool String::equals(const String &s) const {
+	return len == s.len && strcmp(buf(), s.buf()) == 0;
+}
+
+bool String::equals(const char *cstr) const {
+	if(len == 0) return cstr == nullptr || *cstr == 0;
+	if(cstr == nullptr) return false;
+	return strcmp(buf(), cstr) == 0;
+}
+
+bool String::equalsIgnoreCase(const String &s) const {
+	return len == s.len && strcasecmp(buf(), s.buf()) == 0;
+}
+
+bool String::startsWith(const String &prefix) const {
+	return prefix.len <= len && strncmp(buf(), prefix.buf(), prefix.len) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+	return suffix.len <= len && strcmp(buf() + len - suffix.len, suffix.buf()) == 0;
+}
+
+char String::charAt(unsigned int index) const { return index < len ? buf()[index] : 0; }
+void String::setCharAt(unsigned int index, char c) { if(index < len) wbuf()[index] = c; }
+
+char &String::operator [](unsigned int index) {
+	static char dummy;
+	if(index >= len) { dummy = 0; return dummy; }
+	return wbuf()[index];
+}
+
+void String::toCharArray(char *out, unsigned int bufsize, unsigned int index) const {
+	if(!bufsize || !out) return;
+	if(index >= len) { out[0] = 0; return; }
+	unsigned int n = bufsize - 1;
+	if(n > len - index) n = len - index;
+	memcpy(out, buf() + index, n);
+	out[n] = 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+	if(fromIndex >= len) return -1;
+	const char *p = strchr(buf() + fromIndex, ch);
+	return p ? p - buf() : -1;
+}
+
+int String::indexOf(const char *str, unsigned int fromIndex) const {
+	if(!str || fromIndex >= len) return -1;
+	const char *p = strstr(buf() + fromIndex, str);
+	return p ? p - buf() : -1;
+}
+
+int String::lastIndexOf(char ch) const {
+	const char *p = strrchr(buf(), ch);
+	return p ? p - buf() : -1;
+}
+
+String String::substring(unsigned int left, unsigned int right) const {
+	if(left > right) { unsigned int t = left; left = right; right = t; }
+	String out;
+	if(left >= len) return out;
+	if(right > len) right = len;
+	out.copy(buf() + left, right - left);
+	return out;
+}
+
+void String::replace(char find, char repl) {
+	char *b = wbuf();
+	for(unsigned int i=0;i<len;i++) if(b[i] == find) b[i] = repl;
+}
+
+void String::replace(const String &find, const String &repl) {
+	if(len == 0 || find.len == 0) return;
+	String out;
+	const char *p = buf();
+	const char *hit;
+	while((hit = strstr(p, find.buf())) != nullptr) {
+		out.concat(p, hit - p);
+		out.concat(repl);
+		p = hit + find.len;
+	}
+	out.concat(p);
+	*this = static_cast<String &&>(out);
+}
+
+void String::remove(unsigned int index) { remove(index, (unsigned int)-1); }
+
+void String::remove(unsigned int index, unsigned int count) {
+	if(index >= len || count == 0) return;
+	if(count > len - index) count = len - index;
+	char *b = wbuf();
+	memmove(b + index, b + index + count, len - index - count + 1);
+	len -= count;
+}
+
+void String::toLowerCase() { char *b = wbuf(); for(unsigned int i=0;i<len;i++) b[i] = tolower(b[i]); }
+void String::toUpperCase() { char *b = wbuf(); for(unsigned int i=0;i<len;i++) b[i] = toupper(b[i]); }
+
+void String::trim() {
+	if(len == 0) return;
+	char *b = wbuf();
+	unsigned int s = 0, e = len;
+	while(s < e && isspace((unsigned char)b[s])) s++;
+	while(e > s && isspace((unsigned char)b[e-1])) e--;
+	len = e - s;
+	if(s) memmove(b, b + s, len);
+	b[len] = 0;
+}
+
+long String::toInt() const { return atol(buf()); }
+float String::toFloat() const { return atof(buf()); }
+double String::toDouble() const { return atof(buf()); }
+
+String operator +(const String &lhs, const String &rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator +(const String &lhs, const char *rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator +(const char *lhs, const String &rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator +(const String &lhs, const __FlashStringHelper *rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator +(const String &lhs, char rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator +(const String &lhs, int rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator +(const String &lhs, unsigned int rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator +(const String &lhs, long rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator +(const String &lhs, unsigned long rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator +(const String &lhs, float rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator +(const String &lhs, double rhs) { String s(lhs); s.concat(rhs); return s; }